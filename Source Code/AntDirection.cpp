@@ -0,0 +1,77 @@
+#include "AntDirection.h"
+
+// built once before main(), so the ants only ever read them
+struct AntDirectionTables {
+	glm::ivec3 steps[NUM_ANT_DIRECTIONS];
+	AntMovementCone cones[NUM_ANT_DIRECTIONS];
+	AntMovementConeArrays coneArrays;
+
+	AntDirectionTables()
+	{
+		for (int code = 0; code < NUM_ANT_DIRECTIONS; code++) {
+			glm::ivec3 d(code % 3 - 1, (code / 3) % 3 - 1, code / 9 - 1);
+			steps[code] = d;
+
+			AntMovementCone& cone = cones[code];
+			for (int axis = 0; axis < 3; axis++) {
+				cone.minCorner[axis] = (d[axis] == 0) ? -1 : glm::min(d[axis], 0);
+				cone.maxCorner[axis] = (d[axis] == 0) ? 1 : glm::max(d[axis], 0);
+			}
+
+			cone.numSteps = 0;
+			for (int i = cone.minCorner.x; i <= cone.maxCorner.x; i++) {
+				for (int j = cone.minCorner.y; j <= cone.maxCorner.y; j++) {
+					for (int k = cone.minCorner.z; k <= cone.maxCorner.z; k++) {
+						if (i != 0 || j != 0 || k != 0) {
+							cone.steps[cone.numSteps++] = glm::ivec3(i, j, k);
+						}
+					}
+				}
+			}
+			for (int s = cone.numSteps; s < MAX_ANT_CONE_STEPS; s++) {
+				cone.steps[s] = glm::ivec3(0, 0, 0);
+			}
+
+			coneArrays.numSteps[code] = cone.numSteps;
+			for (int s = 0; s < MAX_ANT_CONE_STEPS; s++) {
+				coneArrays.stepX[code * MAX_ANT_CONE_STEPS + s] = cone.steps[s].x;
+				coneArrays.stepY[code * MAX_ANT_CONE_STEPS + s] = cone.steps[s].y;
+				coneArrays.stepZ[code * MAX_ANT_CONE_STEPS + s] = cone.steps[s].z;
+			}
+		}
+	}
+};
+
+static const AntDirectionTables antDirectionTables;
+
+glm::ivec3 antDirectionStep(int directionCode)
+{
+	return antDirectionTables.steps[directionCode];
+}
+
+const AntMovementCone& antMovementCone(int directionCode)
+{
+	return antDirectionTables.cones[directionCode];
+}
+
+const AntMovementConeArrays& antMovementConeArrays()
+{
+	return antDirectionTables.coneArrays;
+}
+
+std::vector<glm::ivec4> antMovementConeUniformBlock()
+{
+	std::vector<glm::ivec4> block(NUM_ANT_DIRECTIONS * (2 + MAX_ANT_CONE_STEPS));
+
+	for (int code = 0; code < NUM_ANT_DIRECTIONS; code++) {
+		const AntMovementCone& cone = antDirectionTables.cones[code];
+
+		block[code] = glm::ivec4(cone.minCorner, cone.numSteps);
+		block[NUM_ANT_DIRECTIONS + code] = glm::ivec4(cone.maxCorner, 0);
+		for (int s = 0; s < MAX_ANT_CONE_STEPS; s++) {
+			block[2 * NUM_ANT_DIRECTIONS + code * MAX_ANT_CONE_STEPS + s] = glm::ivec4(cone.steps[s], 0);
+		}
+	}
+
+	return block;
+}
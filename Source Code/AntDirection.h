@@ -0,0 +1,69 @@
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+
+// An ant heads in one of 27 directions, a step of -1, 0 or 1 along each axis (all zero when it has no heading).
+// The direction is kept as a code 0..26 in the ant state, and every code has a precomputed movement cone: the range
+// of steps allowed along each axis and the list of steps in front of the ant, in the order they are scored. Moving an
+// ant is then a loop over a fixed list instead of decoding direction bits and rebuilding the cone every tick.
+// simulation_ant_fragment.glsl reads the same tables from the AntMovementCones uniform block.
+
+static const int NUM_ANT_DIRECTIONS = 27;
+static const int ANT_DIRECTION_NONE = 13;	// code of the zero step
+static const int MAX_ANT_CONE_STEPS = 26;	// the zero step is never part of a cone
+
+// ant state: bit 0 = has food, bits 1-5 = direction code; same layout as the alpha channel in simulation_ant_fragment.glsl
+static const unsigned int ANT_STATE_HAS_FOOD = 1u << 0;
+static const unsigned int ANT_STATE_DIRECTION_SHIFT = 1;
+
+struct AntMovementCone {
+	// per axis, [min(d,0), max(d,0)], or [-1,1] if the ant isn't heading along that axis
+	glm::ivec3 minCorner;
+	glm::ivec3 maxCorner;
+
+	int numSteps;
+	glm::ivec3 steps[MAX_ANT_CONE_STEPS];	// x outermost, z innermost; ties in the scoring go to the first step
+};
+
+inline int antDirectionCode(glm::ivec3 step)
+{
+	return (step.x + 1) + 3 * (step.y + 1) + 9 * (step.z + 1);
+}
+
+inline int reverseAntDirectionCode(int directionCode)
+{
+	return (NUM_ANT_DIRECTIONS - 1) - directionCode;	// negating every axis mirrors the code
+}
+
+inline bool antStateHasFood(unsigned int antState)
+{
+	return (antState & ANT_STATE_HAS_FOOD) != 0;
+}
+
+inline int antStateDirectionCode(unsigned int antState)
+{
+	return (int)(antState >> ANT_STATE_DIRECTION_SHIFT);
+}
+
+inline unsigned int makeAntState(int directionCode, bool hasFood)
+{
+	return ((unsigned int)directionCode << ANT_STATE_DIRECTION_SHIFT) | (hasFood ? ANT_STATE_HAS_FOOD : 0u);
+}
+
+// the same cones as flat arrays indexed by code * MAX_ANT_CONE_STEPS + step, for kernels that gather the steps of
+// several ants at once (see AntScoringKernel.h)
+struct AntMovementConeArrays {
+	int numSteps[NUM_ANT_DIRECTIONS];
+	int stepX[NUM_ANT_DIRECTIONS * MAX_ANT_CONE_STEPS];
+	int stepY[NUM_ANT_DIRECTIONS * MAX_ANT_CONE_STEPS];
+	int stepZ[NUM_ANT_DIRECTIONS * MAX_ANT_CONE_STEPS];
+};
+
+glm::ivec3 antDirectionStep(int directionCode);
+const AntMovementCone& antMovementCone(int directionCode);
+const AntMovementConeArrays& antMovementConeArrays();
+
+// the cones packed as the std140 AntMovementCones uniform block: the minimum corners (w = number of steps), the
+// maximum corners, then MAX_ANT_CONE_STEPS steps per direction code
+std::vector<glm::ivec4> antMovementConeUniformBlock();
@@ -0,0 +1,71 @@
+#include "AntPopulation.h"
+#include <math.h>
+
+AntPopulation::AntPopulation() : _numAnts(0), _numRetiredAnts(0), _numSpawnedAnts(0), _firstAntId(0), _spawnCredit(0.0)
+{
+}
+
+void AntPopulation::reset(int numAnts)
+{
+	_cohorts.clear();
+	if (numAnts > 0) {
+		Cohort initialAnts = { 0, numAnts };
+		_cohorts.push_back(initialAnts);
+	}
+
+	_numAnts = numAnts;
+	_numRetiredAnts = 0;
+	_numSpawnedAnts = 0;
+	_firstAntId = 0;
+	_spawnCredit = 0.0;
+}
+
+void AntPopulation::beginTick(const SimulationParameters& parameters, unsigned int tick)
+{
+	_numRetiredAnts = 0;
+	if (parameters.antLifetime > 0) {
+		while (!_cohorts.empty() && tick - _cohorts.front().birthTick >= (unsigned int)parameters.antLifetime) {
+			_numRetiredAnts += _cohorts.front().numAnts;
+			_cohorts.pop_front();
+		}
+	}
+	_numAnts -= _numRetiredAnts;
+	_firstAntId += _numRetiredAnts;
+
+	// in double on the host, so every backend spawns on the same ticks
+	_spawnCredit += glm::max((double)parameters.antSpawnRate, 0.0);
+	double wholeAnts = floor(_spawnCredit);
+	_spawnCredit -= wholeAnts;
+
+	_numSpawnedAnts = (int)glm::min(wholeAnts, (double)(MAX_NUM_ANTS - _numAnts));
+	if (_numSpawnedAnts > 0) {
+		Cohort spawnedAnts = { tick, _numSpawnedAnts };
+		_cohorts.push_back(spawnedAnts);
+		_numAnts += _numSpawnedAnts;
+	}
+}
+
+int AntPopulation::numAnts() const
+{
+	return _numAnts;
+}
+
+int AntPopulation::numRetiredAnts() const
+{
+	return _numRetiredAnts;
+}
+
+int AntPopulation::numSpawnedAnts() const
+{
+	return _numSpawnedAnts;
+}
+
+unsigned int AntPopulation::firstAntId() const
+{
+	return _firstAntId;
+}
+
+unsigned int AntPopulation::nextAntId() const
+{
+	return _firstAntId + (unsigned int)_numAnts;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "SimulationBackend.h"
+#include <deque>
+
+// Which ants are alive on each tick. The run starts with SimulationParameters::numAnts ants; every tick the nest
+// spawns antSpawnRate new ones (fractions carry over to the next tick) and the ants that have lived antLifetime
+// ticks retire. Ants get consecutive ids in the order they are born, and they all live equally long, so the oldest
+// ants always retire first and the live ants are exactly the ids [firstAntId, nextAntId). Every backend plans its
+// ticks with this class, so they all spawn and retire the same ants on the same ticks; the id keys an ant's random
+// draws (see Random.h), so it must follow the ant wherever a backend stores it.
+class AntPopulation
+{
+public:
+	AntPopulation();
+
+	// numAnts ants born at tick 0, with ids 0 to numAnts - 1
+	void reset(int numAnts);
+
+	// retires the ants that reach their lifetime on this tick, then spawns the new ones (never more than MAX_NUM_ANTS alive)
+	void beginTick(const SimulationParameters& parameters, unsigned int tick);
+
+	int numAnts() const;	// alive after beginTick: the ants from before minus numRetiredAnts, plus numSpawnedAnts
+	int numRetiredAnts() const;	// by the last beginTick, all from the oldest end
+	int numSpawnedAnts() const;	// by the last beginTick, with the highest ids
+
+	unsigned int firstAntId() const;	// oldest live ant
+	unsigned int nextAntId() const;	// one past the youngest live ant
+
+private:
+	// ants born on the same tick, which retire together
+	struct Cohort {
+		unsigned int birthTick;
+		int numAnts;
+	};
+
+	std::deque<Cohort> _cohorts;	// oldest first
+
+	int _numAnts;
+	int _numRetiredAnts;
+	int _numSpawnedAnts;
+
+	unsigned int _firstAntId;
+
+	double _spawnCredit;	// fraction of an ant owed to the next tick
+};
@@ -0,0 +1,143 @@
+#include "AntScoringKernel.h"
+#include <immintrin.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define AVX2_FUNCTION
+#else
+#define AVX2_FUNCTION __attribute__((target("avx2")))
+#endif
+
+static const float EXCLUDED_CELL_SCORE = -1000.0f;	// same as CpuSimulationBackend
+
+bool antScoringKernelSupported()
+{
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) {
+		return false;
+	}
+
+	__cpuid(info, 1);
+	bool osSavesAvxState = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+
+	__cpuidex(info, 7, 0);
+	return osSavesAvxState && (info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+
+AVX2_FUNCTION void scoreAntConesAvx2(const AntScoringInput& input, const int* x, const int* y, const int* z, const unsigned char* hasFood,
+	const int* coneDirectionCode, float* highestScore, int* bestStepDirectionCode)
+{
+	const AntMovementConeArrays& cones = antMovementConeArrays();
+	const int* cellWords = reinterpret_cast<const int*>(input.cells);	// two words per cell: trail/ants | tick << 16, food | terrain << 16
+
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i one = _mm256_set1_epi32(1);
+	const __m256i lowHalf = _mm256_set1_epi32(0xFFFF);
+	const __m256i brickMask = _mm256_set1_epi32(WORLD_BRICK_SIZE - 1);
+	const __m256i haloOffset = _mm256_set1_epi32(WORLD_HALO_BRICKS * WORLD_BRICK_SIZE);
+	const __m256i pageRowSize = _mm256_set1_epi32(input.pageTableSize.x);
+	const __m256i pageSliceSize = _mm256_set1_epi32(input.pageTableSize.x * input.pageTableSize.y);
+	const __m256i wallBrick = _mm256_set1_epi32(WALL_BRICK);
+	const __m256i wallFood = _mm256_set1_epi32(WORLD_CELL_WALL_FOOD);
+	const __m256i tickMask = _mm256_set1_epi32(WORLD_CELL_TICK_MASK);
+	const __m256i tick = _mm256_set1_epi32(input.tick & WORLD_CELL_TICK_MASK);
+
+	const __m256 zeroScore = _mm256_setzero_ps();
+	const __m256 oneScore = _mm256_set1_ps(1.0f);
+	const __m256 excludedScore = _mm256_set1_ps(EXCLUDED_CELL_SCORE);
+	const __m256 foodScale = _mm256_set1_ps(WORLD_CELL_FOOD_SCALE);
+	const __m256 trailScale = _mm256_set1_ps(WORLD_CELL_TRAIL_SCALE);
+	const __m256 trailDissipationPerFrame = _mm256_set1_ps(input.trailDissipationPerFrame);
+	const __m256 trailScoreMultiplier = _mm256_set1_ps(input.trailScoreMultiplier);
+	const __m256 foodNestScoreMultiplier = _mm256_set1_ps(input.foodNestScoreMultiplier);
+	const __m256 crowdingScoreMultiplier = _mm256_set1_ps(input.crowdingScoreMultiplier);
+	const __m256i antsMask = _mm256_set1_epi32(WORLD_CELL_MAX_ANTS);
+	const __m256i antsFlag = _mm256_set1_epi32(WORLD_CELL_ANTS);
+	const __m256i nestMask = _mm256_set1_epi32(WORLD_CELL_NEST << 16);
+
+	__m256i antX = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x));
+	__m256i antY = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(y));
+	__m256i antZ = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(z));
+	__m256i carrying = _mm256_cmpgt_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(hasFood))), zero);
+
+	__m256i coneCode = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(coneDirectionCode));
+	__m256i numSteps = _mm256_i32gather_epi32(cones.numSteps, coneCode, 4);
+	__m256i firstStep = _mm256_mullo_epi32(coneCode, _mm256_set1_epi32(MAX_ANT_CONE_STEPS));
+
+	__m256 highest = zeroScore;
+	__m256i best = _mm256_set1_epi32(ANT_DIRECTION_NONE);
+
+	for (int s = 0; s < MAX_ANT_CONE_STEPS; s++) {
+		__m256i active = _mm256_cmpgt_epi32(numSteps, _mm256_set1_epi32(s));
+		if (_mm256_testz_si256(active, active)) {
+			break;	// every lane is past the end of its cone
+		}
+
+		__m256i stepIndex = _mm256_add_epi32(firstStep, _mm256_set1_epi32(s));
+		__m256i stepX = _mm256_i32gather_epi32(cones.stepX, stepIndex, 4);
+		__m256i stepY = _mm256_i32gather_epi32(cones.stepY, stepIndex, 4);
+		__m256i stepZ = _mm256_i32gather_epi32(cones.stepZ, stepIndex, 4);
+
+		__m256i voxelX = _mm256_add_epi32(antX, stepX);
+		__m256i voxelY = _mm256_add_epi32(antY, stepY);
+		__m256i voxelZ = _mm256_add_epi32(antZ, stepZ);
+
+		// page table entry, shifted by the halo like BrickedWorld::slotOfVoxel
+		__m256i entry = _mm256_add_epi32(
+			_mm256_srai_epi32(_mm256_add_epi32(voxelX, haloOffset), 3),
+			_mm256_add_epi32(
+				_mm256_mullo_epi32(_mm256_srai_epi32(_mm256_add_epi32(voxelY, haloOffset), 3), pageRowSize),
+				_mm256_mullo_epi32(_mm256_srai_epi32(_mm256_add_epi32(voxelZ, haloOffset), 3), pageSliceSize)));
+		__m256i slot = _mm256_i32gather_epi32(input.pageTable, entry, 4);
+
+		__m256i atlasIndex = _mm256_or_si256(_mm256_and_si256(voxelX, brickMask),
+			_mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(voxelY, brickMask), 3), _mm256_slli_epi32(_mm256_and_si256(voxelZ, brickMask), 6)));
+		__m256i indexInBrick = _mm256_i32gather_epi32(input.voxelIndexInBrick, atlasIndex, 4);
+
+		// non-resident lanes keep an empty cell, or a wall cell in the halo
+		__m256i resident = _mm256_cmpgt_epi32(slot, _mm256_set1_epi32(-1));
+		__m256i wall = _mm256_cmpeq_epi32(slot, wallBrick);
+		__m256i cellWord = _mm256_slli_epi32(_mm256_add_epi32(_mm256_mullo_epi32(slot, _mm256_set1_epi32(WORLD_BRICK_VOXELS)), indexInBrick), 1);
+		__m256i trailTick = _mm256_mask_i32gather_epi32(zero, cellWords, cellWord, resident, 4);
+		__m256i foodTerrain = _mm256_mask_i32gather_epi32(_mm256_and_si256(wall, wallFood), cellWords + 1, cellWord, resident, 4);
+
+		// worldCellFood, worldCellTrailStrength, worldCellHasNest and worldCellAnts (only counted in the tick that stamped the cell)
+		__m256 food = _mm256_div_ps(_mm256_cvtepi32_ps(_mm256_srai_epi32(_mm256_slli_epi32(foodTerrain, 16), 16)), foodScale);
+		__m256i age = _mm256_and_si256(_mm256_sub_epi32(tick, _mm256_srli_epi32(trailTick, 16)), tickMask);
+		__m256i hasAnts = _mm256_cmpeq_epi32(_mm256_and_si256(trailTick, antsFlag), antsFlag);
+		__m256 storedTrail = _mm256_blendv_ps(
+			_mm256_div_ps(_mm256_cvtepi32_ps(_mm256_and_si256(trailTick, lowHalf)), trailScale), oneScore, _mm256_castsi256_ps(hasAnts));
+		__m256 trail = _mm256_max_ps(_mm256_sub_ps(storedTrail, _mm256_mul_ps(trailDissipationPerFrame, _mm256_cvtepi32_ps(age))), zeroScore);
+		__m256 nest = _mm256_blendv_ps(zeroScore, oneScore, _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(foodTerrain, nestMask), nestMask)));
+		__m256i ants = _mm256_and_si256(_mm256_and_si256(trailTick, antsMask), _mm256_and_si256(hasAnts, _mm256_cmpeq_epi32(age, zero)));
+
+		__m256 trailScore = _mm256_mul_ps(trail, trailScoreMultiplier);
+		__m256 foodScore = _mm256_mul_ps(food, foodNestScoreMultiplier);
+		__m256 nestScore = _mm256_mul_ps(nest, foodNestScoreMultiplier);
+		__m256 crowdingScore = _mm256_mul_ps(_mm256_cvtepi32_ps(ants), crowdingScoreMultiplier);
+
+		// no food when already carrying food, no nest when empty-handed
+		__m256 carryingScore = _mm256_castsi256_ps(carrying);
+		foodScore = _mm256_blendv_ps(foodScore, excludedScore, _mm256_and_ps(_mm256_cmp_ps(foodScore, zeroScore, _CMP_GT_OQ), carryingScore));
+		nestScore = _mm256_blendv_ps(nestScore, excludedScore, _mm256_andnot_ps(carryingScore, _mm256_cmp_ps(nestScore, zeroScore, _CMP_GT_OQ)));
+
+		__m256 total = _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(trailScore, foodScore), nestScore), crowdingScore);
+		total = _mm256_blendv_ps(total, excludedScore, _mm256_castsi256_ps(wall));
+
+		// strictly greater, so ties go to the earlier step like the scalar loop
+		__m256 better = _mm256_and_ps(_mm256_cmp_ps(highest, total, _CMP_LT_OQ), _mm256_castsi256_ps(active));
+		__m256i stepCode = _mm256_add_epi32(_mm256_add_epi32(stepX, one),
+			_mm256_add_epi32(_mm256_mullo_epi32(_mm256_add_epi32(stepY, one), _mm256_set1_epi32(3)), _mm256_mullo_epi32(_mm256_add_epi32(stepZ, one), _mm256_set1_epi32(9))));
+
+		highest = _mm256_blendv_ps(highest, total, better);
+		best = _mm256_blendv_epi8(best, stepCode, _mm256_castps_si256(better));
+	}
+
+	_mm256_storeu_ps(highestScore, highest);
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(bestStepDirectionCode), best);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "BrickedWorld.h"
+#include "AntDirection.h"
+
+// Scores the movement cones of ANT_SCORING_LANES ants at once with AVX2: for every step of the cones it gathers the
+// page table entries and packed cells of all lanes, decodes trail, food and nest, applies the -1000 exclusions and keeps
+// a running argmax. Same arithmetic in the same order as CpuSimulationBackend::scoreAntCone, so the chosen steps are
+// bit-identical to the scalar path (and to the shader). Used only when the CPU supports AVX2; the build needs no flags.
+
+static const int ANT_SCORING_LANES = 8;
+
+// what the kernel reads, taken from the BrickedWorld and SimulationParameters once per batch of ants
+struct AntScoringInput {
+	const int* pageTable;
+	glm::ivec3 pageTableSize;
+	const WorldCell* cells;	// BrickedWorld::poolCells()
+	const int* voxelIndexInBrick;	// BrickedWorld::voxelIndexInBrickTable()
+
+	unsigned int tick;
+	float trailDissipationPerFrame;
+	float trailScoreMultiplier;
+	float foodNestScoreMultiplier;
+	float crowdingScoreMultiplier;
+};
+
+bool antScoringKernelSupported();	// AVX2 on this CPU, with the OS saving the YMM registers
+
+// x, y, z and hasFood are the ants' fields (see CpuAnts), coneDirectionCode the direction each ant is heading after
+// turning this tick; writes the highest score of each ant (0 if no step beats 0) and the direction code of its step
+void scoreAntConesAvx2(const AntScoringInput& input, const int* x, const int* y, const int* z, const unsigned char* hasFood,
+	const int* coneDirectionCode, float* highestScore, int* bestStepDirectionCode);
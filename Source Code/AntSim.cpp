@@ -1,29 +1,44 @@
 #include "AntSim.h"
 #include "Utils.h"
+#include "FragmentSimulationBackend.h"
+#include "CpuSimulationBackend.h"
+#include "ComputeSimulationBackend.h"
+#include "BrickedWorld.h"
+#include "Random.h"
 #include <iostream>
 #include <fstream>
-#include <time.h>
+
+static const int MAX_CATCH_UP_TICKS_PER_FRAME = 8;	// ticks a frame runs back to back when the simulation has fallen behind
 
 extern int triangleTable[256][16];
 
-AntSim::AntSim(int w, int h) : _initialized(0), width(w), height(h)
+AntSim::AntSim(int w, int h, int seed, SimulationBackendType backendType) : width(w), height(h), _surfaceMesh(0), _simulationBackend(0), _worldSnapshot(0), _displayedTick(0),
+	_tickScheduler(MAX_CATCH_UP_TICKS_PER_FRAME), _timingWindowStartTick(0), _framesInTimingWindow(0), _ticksPerSecond(0.0f), _framesPerSecond(0.0f)
 {
 	// set adjustable controls (don't want them resetting when restarting)
 	updateIntervalSeconds = 0.01f;
+	targetFramesPerSecond = 60.0f;
+	simulationPaused = 0;
+	fastForward = 0;
+	ticksPerFrame = 100;
 	trailOpacity = 0.5f;
 	cameraDistance = 3.0f;
 	numAnts = 4;
+	antSpawnRate = 0.0;
+	antLifetime = 0;
 	cubeLength = 32;
 	randomMovementProbability = 0.1;
 	trailDissipationPerFrame = 0.001;
 	_initialFoodRatio = 0.005;
 	foodNestScoreMultiplier = 10.0;
 	trailScoreMultiplier = 1.0;
+	crowdingScoreMultiplier = 0.0;
+	simulationBackendType = backendType;
+	simulationThreads = 0;
+	randomSeed = (seed >= 0) ? seed : (int)(randomRunSeed() & 0x7fffffffu);	// kept positive for the GUI's integer field
 
 	simulationRunning = true;
 
-	_quadVbo = Utils::initializeQuadVBO();
-
 	glEnable(GL_TEXTURE_3D);
 
 	glDisable(GL_DEPTH_TEST);
@@ -35,14 +50,16 @@ AntSim::AntSim(int w, int h) : _initialized(0), width(w), height(h)
 	_worldSize = glm::ivec3(cubeLength, cubeLength, cubeLength);
 	_voxelSize = glm::vec3(2.0f/_worldSize.x, 2.0f/_worldSize.y, 2.0f/_worldSize.z);
 
-	_worldPingPong = Utils::createPingPong(_worldSize);
-
-	_antPingPong = Utils::createPingPong(glm::ivec3(numAnts, 1, 1));
+	_hostWorldTrailVolume = Utils::createVolume(glm::ivec3(1, 1, 1), WORLD_TRAIL_TEXTURE_FORMAT);
+	_hostWorldFoodVolume = Utils::createVolume(glm::ivec3(1, 1, 1), WORLD_FOOD_TEXTURE_FORMAT);
+	_hostWorldTerrainVolume = Utils::createVolume(glm::ivec3(1, 1, 1), WORLD_TERRAIN_TEXTURE_FORMAT);
+	_hostWorldPageTextureId = Utils::createPageTexture(glm::ivec3(1, 1, 1));
 
 	_visualizationProgramId = glCreateProgram();
 	Utils::initializeShader(_visualizationProgramId, "visualization_vertex.glsl", GL_VERTEX_SHADER);
 	Utils::initializeShader(_visualizationProgramId, "visualization_geometry.glsl", GL_GEOMETRY_SHADER);
-	Utils::initializeShader(_visualizationProgramId, "visualization_fragment.glsl", GL_FRAGMENT_SHADER);
+
+	SurfaceMesh::captureVaryings(_visualizationProgramId);	// no fragment shader, the triangles are only captured
 
 	glLinkProgram(_visualizationProgramId);
 
@@ -52,8 +69,11 @@ AntSim::AntSim(int w, int h) : _initialized(0), width(w), height(h)
 
 	printf("assigning samplers to textures\n");
 
-	glUniform1i(glGetUniformLocation(_visualizationProgramId, "worldTexture"), 0);
+	glUniform1i(glGetUniformLocation(_visualizationProgramId, "worldTrailTexture"), 0);
 	glUniform1i(glGetUniformLocation(_visualizationProgramId, "antTexture"), 1);
+	glUniform1i(glGetUniformLocation(_visualizationProgramId, "worldPageTexture"), 4);
+	glUniform1i(glGetUniformLocation(_visualizationProgramId, "worldFoodTexture"), 5);
+	glUniform1i(glGetUniformLocation(_visualizationProgramId, "worldTerrainTexture"), 6);
 
 	printf("set up triangle table texture for marching cubes...\n");
 
@@ -77,18 +97,16 @@ AntSim::AntSim(int w, int h) : _initialized(0), width(w), height(h)
 
 	Utils::logProgramValidationError(_visualizationProgramId);
 
+	_surfaceMesh = new SurfaceMesh(_visualizationProgramId);
+	_surfaceMeshTrailOpacity = trailOpacity;
+	_surfaceMeshTrailDissipationPerFrame = trailDissipationPerFrame;
+
 	printf("assigning initial uniforms\n");
 
 	printf("any errors? %s\n", gluErrorString(glGetError()));
 
 	printf("now to initialize the simulation\n");
 
-	_simulationWorldProgramId = Utils::createSimulationProgram("simulation_vertex.glsl", "simulation_geometry.glsl", "simulation_world_fragment.glsl");
-	printf("_simulationWorldProgramId: %d\n", _simulationWorldProgramId);
-
-	_simulationAntProgramId = Utils::createSimulationProgram("simulation_vertex.glsl", "simulation_geometry.glsl", "simulation_ant_fragment.glsl");
-	printf("_simulationAntProgramId: %d\n", _simulationAntProgramId);
-
 	restart();
 }
 
@@ -97,11 +115,43 @@ float* AntSim::view_rotate()
 	return _view_rotate;
 }
 
-void AntSim::restart()
+GLuint AntSim::visualizationProgramId() const
+{
+	return _visualizationProgramId;
+}
+
+SimulationParameters AntSim::simulationParameters() const
+{
+	SimulationParameters parameters;
+	parameters.seed = (unsigned int)randomSeed;
+	parameters.worldSize = _worldSize;
+	parameters.numAnts = numAnts;
+	parameters.antSpawnRate = antSpawnRate;
+	parameters.antLifetime = antLifetime;
+	parameters.initialFoodRatio = _initialFoodRatio;
+	parameters.foodPickupRate = _foodPickupRate;
+	parameters.trailDissipationPerFrame = trailDissipationPerFrame;
+	parameters.foodNestScoreMultiplier = foodNestScoreMultiplier;
+	parameters.trailScoreMultiplier = trailScoreMultiplier;
+	parameters.crowdingScoreMultiplier = crowdingScoreMultiplier;
+	parameters.randomMovementProbability = randomMovementProbability;
+	return parameters;
+}
+
+SimulationThreadSettings AntSim::simulationThreadSettings() const
 {
-	srand (static_cast <unsigned> (time(0)));
+	SimulationThreadSettings settings;
+	settings.parameters = simulationParameters();
+	settings.tickIntervalSeconds = fastForward ? 0.0f : updateIntervalSeconds;
+	settings.paused = (simulationPaused != 0);
+	return settings;
+}
 
-	_lastUpdateTime = 0;
+void AntSim::restart()
+{
+	// the backend belongs to the simulation thread while it runs
+	_simulationThread.stop();
+	_worldSnapshot = 0;
 
 	_view_rotate[0] = 1;
 	_view_rotate[1] = 0;
@@ -127,13 +177,65 @@ void AntSim::restart()
 	
 	simulationRunning = false;
 
-	_initialized = 0;
-
 	_worldSize = glm::ivec3(cubeLength, cubeLength, cubeLength);
 	_voxelSize = glm::vec3(2.0f/_worldSize.x, 2.0f/_worldSize.y, 2.0f/_worldSize.z);
 
-	_worldPingPong = Utils::updatePingPongSize(_worldPingPong, glm::ivec3(_worldSize.x, _worldSize.y, _worldSize.z));
-	_antPingPong = Utils::updatePingPongSize(_antPingPong, glm::ivec3(numAnts, 1, 1));
+	if (_simulationBackend == 0 || _simulationBackendTypeInUse != simulationBackendType) {
+		delete _simulationBackend;
+
+		if (simulationBackendType == BackendCompute && !GLEW_VERSION_4_3) {
+			printf("the compute backend needs OpenGL 4.3, using the fragment backend instead\n");
+			simulationBackendType = BackendFragmentShader;
+		}
+
+		if (simulationBackendType == BackendCpu) {
+			_simulationBackend = new CpuSimulationBackend(simulationThreads);
+		} else if (simulationBackendType == BackendCompute) {
+			_simulationBackend = new ComputeSimulationBackend();
+		} else {
+			_simulationBackend = new FragmentSimulationBackend();
+		}
+		_simulationBackendTypeInUse = simulationBackendType;
+
+		printf("using %s simulation backend\n", _simulationBackend->name());
+	}
+
+	printf("restarting with seed %u\n", (unsigned int)randomSeed);
+
+	_simulationBackend->restart(simulationParameters());
+
+	_displayedTick = 0;
+	_worldAtlasSizeInBricks = _simulationBackend->world().atlasSizeInBricks();
+
+	_tickScheduler.reset(TickScheduler::Clock::now());	// the first tick is due right away
+
+	_timingWindowStart = TickScheduler::Clock::now();
+	_timingWindowStartTick = 0;
+	_framesInTimingWindow = 0;
+	_ticksPerSecond = 0.0f;
+	_framesPerSecond = 0.0f;
+
+	if (_simulationBackend->worldTrailTextureId() == 0) {
+		const BrickedWorld& world = _simulationBackend->world();
+
+		Utils::updateTextureSize(_hostWorldTrailVolume.textureId, world.atlasSize(), WORLD_TRAIL_TEXTURE_FORMAT);
+		_hostWorldTrailVolume.volumeSize = world.atlasSize();
+
+		Utils::updateTextureSize(_hostWorldFoodVolume.textureId, world.atlasSize(), WORLD_FOOD_TEXTURE_FORMAT);
+		_hostWorldFoodVolume.volumeSize = world.atlasSize();
+
+		Utils::updateTextureSize(_hostWorldTerrainVolume.textureId, world.atlasSize(), WORLD_TERRAIN_TEXTURE_FORMAT);
+		_hostWorldTerrainVolume.volumeSize = world.atlasSize();
+
+		Utils::updatePageTextureSize(_hostWorldPageTextureId, world.pageTableSize());
+
+		_hostWorldUploadedTick = 0;
+		_hostWorldPageTableVersion = world.pageTableVersion() - 1;	// force the first upload
+		_hostWorldRestampVersion = world.restampVersion();
+
+		_simulationThread.start(_simulationBackend, simulationThreadSettings());
+		_worldSnapshot = &_simulationThread.acquireSnapshot();
+	}
 
 	glUseProgram(_visualizationProgramId);
 
@@ -148,102 +250,201 @@ void AntSim::restart()
 	glUniform3f(glGetUniformLocation(_visualizationProgramId, "cubeVertexDecals[6]"), _voxelSize.x,	_voxelSize.y,	_voxelSize.z);
 	glUniform3f(glGetUniformLocation(_visualizationProgramId, "cubeVertexDecals[7]"), 0.0f,			_voxelSize.y,	_voxelSize.z);
 
+	_surfaceMesh->reset(_worldSize);
+
 	simulationRunning = true;
 }
 
-void AntSim::updateWorld() {
-	updateSimulation(_simulationWorldProgramId, &_worldPingPong, GL_TEXTURE0, &_antPingPong, GL_TEXTURE1);
-}
+void AntSim::bindWorldTexturesForDisplay()
+{
+	if (_simulationBackend->worldTrailTextureId() != 0) {
+		glActiveTexture(GL_TEXTURE4);
+		glBindTexture(GL_TEXTURE_3D, _simulationBackend->worldPageTextureId());
+
+		glActiveTexture(GL_TEXTURE5);
+		glBindTexture(GL_TEXTURE_3D, _simulationBackend->worldFoodTextureId());
+
+		glActiveTexture(GL_TEXTURE6);
+		glBindTexture(GL_TEXTURE_3D, _simulationBackend->worldTerrainTextureId());
+
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_3D, _simulationBackend->worldTrailTextureId());
+		return;
+	}
+
+	// the backend simulates in host memory, so copy the bricks that changed since the last frame into our own atlas;
+	// the snapshot has every brick, so it doesn't matter how many ticks went by since
+	const WorldSnapshot& snapshot = *_worldSnapshot;
+
+	if (snapshot.pageTableVersion != _hostWorldPageTableVersion) {
+		Utils::uploadPageTable(_hostWorldPageTextureId, snapshot.pageTableSize, &snapshot.pageTable[0]);
+		_hostWorldPageTableVersion = snapshot.pageTableVersion;
+	}
+
+	bool restamped = snapshot.restampVersion != _hostWorldRestampVersion;
+	for (int slot = 0; slot < (int)snapshot.slotBrick.size(); slot++) {
+		if (snapshot.slotBrick[slot] != EMPTY_BRICK && (restamped || snapshot.slotTouchedTick[slot] >= _hostWorldUploadedTick)) {
+			Utils::uploadBrick(_hostWorldTrailVolume.textureId, _hostWorldFoodVolume.textureId, _hostWorldTerrainVolume.textureId, snapshot.atlasBrickCoord(slot), snapshot.brickCells(slot));
+		}
+	}
+	_hostWorldUploadedTick = snapshot.tick;
+	_hostWorldRestampVersion = snapshot.restampVersion;
+
+	glActiveTexture(GL_TEXTURE4);
+	glBindTexture(GL_TEXTURE_3D, _hostWorldPageTextureId);
+
+	glActiveTexture(GL_TEXTURE5);
+	glBindTexture(GL_TEXTURE_3D, _hostWorldFoodVolume.textureId);
+
+	glActiveTexture(GL_TEXTURE6);
+	glBindTexture(GL_TEXTURE_3D, _hostWorldTerrainVolume.textureId);
 
-void AntSim::updateAnts() {
-	updateSimulation(_simulationAntProgramId, &_antPingPong, GL_TEXTURE1, &_worldPingPong, GL_TEXTURE0);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_3D, _hostWorldTrailVolume.textureId);
 }
 
-void AntSim::updateSimulation(GLuint simulationShaderProgramId, PingPong *pingPong, GLuint activeTextureUnit, PingPong *supportPingPong, GLuint supportTextureUnit) {
-	glBindBuffer(GL_ARRAY_BUFFER, _quadVbo);
-	glVertexAttribPointer(SlotPosition, 2, GL_SHORT, GL_FALSE, 2 * sizeof(short), 0);
-	glViewport(0, 0, pingPong->current.volumeSize.x, pingPong->current.volumeSize.y);
-
-	glUseProgram(simulationShaderProgramId);
-
-	// set uniforms here...
-
-	float r = static_cast <float> (rand()) / static_cast <float> (RAND_MAX);
-	glUniform1f(glGetUniformLocation(simulationShaderProgramId, "randomSeed"), r);
-	glUniform1f(glGetUniformLocation(simulationShaderProgramId, "initialFoodRatio"), _initialFoodRatio);
-	glUniform1f(glGetUniformLocation(simulationShaderProgramId, "trailDissipationPerFrame"), trailDissipationPerFrame);
-	glUniform1f(glGetUniformLocation(simulationShaderProgramId, "freeWillThreshold"), 1.0 - randomMovementProbability);
-	glUniform1f(glGetUniformLocation(simulationShaderProgramId, "foodNestScoreMultiplier"), foodNestScoreMultiplier);
-	glUniform1f(glGetUniformLocation(simulationShaderProgramId, "trailScoreMultiplier"), trailScoreMultiplier);
-	glUniform1f(glGetUniformLocation(simulationShaderProgramId, "foodPickupRate"), _foodPickupRate);
-	glUniform1i(glGetUniformLocation(simulationShaderProgramId, "initialized"), _initialized);
-	glUniform1i(glGetUniformLocation(simulationShaderProgramId, "worldTexture"), 0);	// set to GL_TEXTURE0
-	glUniform1i(glGetUniformLocation(simulationShaderProgramId, "antTexture"), 1);	// set to GL_TEXTURE1
-	glUniform3f(glGetUniformLocation(simulationShaderProgramId, "inverseWorldTextureSize"), 
-		1.0f / _worldPingPong.current.volumeSize.x,
-		1.0f / _worldPingPong.current.volumeSize.y,
-		1.0f / _worldPingPong.current.volumeSize.z);
-	glUniform3f(glGetUniformLocation(simulationShaderProgramId, "inverseAntTextureSize"), 
-		1.0f / _antPingPong.current.volumeSize.x,
-		1.0f / _antPingPong.current.volumeSize.y,
-		1.0f / _antPingPong.current.volumeSize.z);
-
-	// bind textures
-
-	glBindFramebuffer(GL_FRAMEBUFFER, pingPong->current.fboId);
-
-	// note: we have both the active and support texture units here, because each shader program requires not only its own texture, but the other one too
-	// e.g. the world needs to read from ant, ant needs to read from world
-	
-	glActiveTexture(supportTextureUnit);
-	glBindTexture(GL_TEXTURE_3D, supportPingPong->previous.textureId);
+// extracts the triangles of whatever can have changed since the mesh was last updated; nothing at all while the
+// displayed tick and the settings the triangles depend on stay the same, so a world that doesn't tick is only drawn
+void AntSim::updateSurfaceMesh()
+{
+	if (trailOpacity != _surfaceMeshTrailOpacity || trailDissipationPerFrame != _surfaceMeshTrailDissipationPerFrame) {
+		_surfaceMesh->invalidate();	// every trail triangle has the opacity in its colour, and the fading in its shape
+		_surfaceMeshTrailOpacity = trailOpacity;
+		_surfaceMeshTrailDissipationPerFrame = trailDissipationPerFrame;
+	}
 
+	bool everything = _surfaceMesh->beginUpdate();
+	if (!everything && _surfaceMesh->tick() == _displayedTick) {
+		return;
+	}
 
-	glActiveTexture(activeTextureUnit);
-	glBindTexture(GL_TEXTURE_3D, pingPong->previous.textureId);
+	extractSurface(_surfaceMesh, everything);
+}
 
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_ONE, GL_ZERO);
-	glBlendEquation(GL_FUNC_ADD);
+void AntSim::extractWholeSurface(SurfaceMesh* surfaceMesh)
+{
+	bindWorldTexturesForDisplay();
 
-	glDisable(GL_CULL_FACE);
+	surfaceMesh->invalidate();
+	extractSurface(surfaceMesh, surfaceMesh->beginUpdate());
+}
 
-	glClearColor(0.0, 0.0, 0.0, 0.0);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+// a brick only reads differently than when the mesh was extracted if it was touched since, or its trails were still
+// fading then (see BrickedWorld::brickSettled); the bricks that were released had settled long before
+void AntSim::extractSurface(SurfaceMesh* surfaceMesh, bool everything)
+{
+	unsigned int meshTick = surfaceMesh->tick();
+	if (_simulationBackend->worldTrailTextureId() != 0) {
+		const BrickedWorld& world = _simulationBackend->world();
+		for (int slot = 0; slot < world.numSlotsInUse(); slot++) {
+			int brick = world.slotBrick(slot);
+			if (brick != EMPTY_BRICK && (everything || !BrickedWorld::brickSettled(world.slotTouchedTick(slot), meshTick, trailDissipationPerFrame))) {
+				surfaceMesh->markBrickChanged(world.brickCoord(brick));
+			}
+		}
+	} else {
+		const WorldSnapshot& snapshot = *_worldSnapshot;
+		for (int slot = 0; slot < (int)snapshot.slotBrick.size(); slot++) {
+			int brick = snapshot.slotBrick[slot];
+			if (brick != EMPTY_BRICK && (everything || !BrickedWorld::brickSettled(snapshot.slotTouchedTick[slot], meshTick, trailDissipationPerFrame))) {
+				surfaceMesh->markBrickChanged(snapshot.brickCoord(brick));
+			}
+		}
+	}
 
-	// draw arrays instanced
+	glUseProgram(_visualizationProgramId);
 
-	glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, pingPong->current.volumeSize.z);
+	glUniform1i(glGetUniformLocation(_visualizationProgramId, "worldTrailTexture"), 0);	// set to GL_TEXTURE0
+	glUniform1i(glGetUniformLocation(_visualizationProgramId, "worldFoodTexture"), 5);	// set to GL_TEXTURE5
+	glUniform1i(glGetUniformLocation(_visualizationProgramId, "worldTerrainTexture"), 6);	// set to GL_TEXTURE6
+	glUniform1i(glGetUniformLocation(_visualizationProgramId, "antTexture"), 1);	// set to GL_TEXTURE1
+	glUniform1f(glGetUniformLocation(_visualizationProgramId, "trailOpacity"), trailOpacity);
+	glUniform1f(glGetUniformLocation(_visualizationProgramId, "trailDissipationPerFrame"), trailDissipationPerFrame);
+	glUniform1ui(glGetUniformLocation(_visualizationProgramId, "worldTick"), _displayedTick);	// trails decay lazily from this
 
-	Utils::swapPingPong(pingPong);
+	glUniform3f(glGetUniformLocation(_visualizationProgramId, "inverseWorldTextureSize"), 
+		1.0f / _worldSize.x,
+		1.0f / _worldSize.y,
+		1.0f / _worldSize.z);
 
-	glActiveTexture(activeTextureUnit);
-	glBindTexture(GL_TEXTURE_3D, 0);
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glUniform3i(glGetUniformLocation(_visualizationProgramId, "worldAtlasSizeInBricks"), _worldAtlasSizeInBricks.x, _worldAtlasSizeInBricks.y, _worldAtlasSizeInBricks.z);
 
 	glUseProgram(0);
+
+	surfaceMesh->update(_worldAtlasSizeInBricks, _displayedTick, trailOpacity, trailDissipationPerFrame);
 }
 
 void AntSim::update()
 {
-	if (simulationRunning) {
-		clock_t currentClock = clock();
-		clock_t elapsedTime = currentClock - _lastUpdateTime;
-		float secondsSinceUpdate = (float)elapsedTime / CLOCKS_PER_SEC;
-		if (_initialized != 1 || secondsSinceUpdate >= updateIntervalSeconds) {
-			updateAnts();
-			updateWorld();
+	if (simulationRunning && _simulationThread.running()) {
+		// the simulation ticks on its own; hand it the current settings and take the newest world it has published
+		_simulationThread.post(simulationThreadSettings());
+
+		_worldSnapshot = &_simulationThread.acquireSnapshot();
+		_displayedTick = _worldSnapshot->tick;
+
+		updateTimingStatistics();
+	} else if (simulationRunning) {
+		if (simulationPaused) {
+			_tickScheduler.reset(TickScheduler::Clock::now());	// carry on right away once unpaused, without making up for the pause
+		} else if (fastForward) {
+			// no waiting between ticks, and only the state after the last of them gets displayed
+			SimulationParameters parameters = simulationParameters();
+			for (int i = 0; i < glm::max(ticksPerFrame, 1); i++) {
+				_simulationBackend->step(parameters);
+			}
+		} else {
+			// the ticks that fell due since the last frame, so the tick rate doesn't depend on the frame rate
+			SimulationParameters parameters = simulationParameters();
+			for (int i = 0; i < MAX_CATCH_UP_TICKS_PER_FRAME && _tickScheduler.tickDue(updateIntervalSeconds, TickScheduler::Clock::now()); i++) {
+				_simulationBackend->step(parameters);
+				_tickScheduler.tickDone(updateIntervalSeconds, TickScheduler::Clock::now());
+			}
+		}
 
-			_initialized = 1;
+		_displayedTick = _simulationBackend->tick();
 
-			_lastUpdateTime = currentClock;
-		}
+		updateTimingStatistics();
 	}
 }
 
+float AntSim::ticksPerSecond() const
+{
+	return _ticksPerSecond;
+}
+
+float AntSim::framesPerSecond() const
+{
+	return _framesPerSecond;
+}
+
+// measured in wall time over windows of about a second
+void AntSim::updateTimingStatistics()
+{
+	TickScheduler::Clock::time_point now = TickScheduler::Clock::now();
+	double elapsedSeconds = std::chrono::duration<double>(now - _timingWindowStart).count();
+	if (elapsedSeconds < 1.0) {
+		return;
+	}
+
+	unsigned int currentTick = _displayedTick;
+	_ticksPerSecond = (float)((currentTick - _timingWindowStartTick) / elapsedSeconds);
+	_framesPerSecond = (float)(_framesInTimingWindow / elapsedSeconds);
+
+	if (fastForward) {
+		printf("tick %u: %.1f ticks/s, %.1f frames/s\n", currentTick, _ticksPerSecond, _framesPerSecond);
+	}
+
+	_timingWindowStart = now;
+	_timingWindowStartTick = currentTick;
+	_framesInTimingWindow = 0;
+}
+
 void AntSim::display()
 {
 	if (simulationRunning) {
+		_framesInTimingWindow++;
+
 		glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
 		glViewport(0, 0, width, height);
@@ -267,71 +468,12 @@ void AntSim::display()
 
 		glMultMatrixf(_view_rotate);
 
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_3D, _worldPingPong.current.textureId);
-	
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_3D, _antPingPong.current.textureId);
-
-		glUseProgram(_visualizationProgramId);
-
-		// change any uniforms here if neded
-
-		glUniform1i(glGetUniformLocation(_visualizationProgramId, "worldTexture"), 0);	// set to GL_TEXTURE0
-		glUniform1i(glGetUniformLocation(_visualizationProgramId, "antTexture"), 1);	// set to GL_TEXTURE1
-		glUniform1f(glGetUniformLocation(_visualizationProgramId, "trailOpacity"), trailOpacity);
-
-		glUniform3f(glGetUniformLocation(_visualizationProgramId, "inverseWorldTextureSize"), 
-			1.0f / _worldPingPong.current.volumeSize.x,
-			1.0f / _worldPingPong.current.volumeSize.y,
-			1.0f / _worldPingPong.current.volumeSize.z);
+		bindWorldTexturesForDisplay();
+		updateSurfaceMesh();
 
 		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 
-		glBegin(GL_POINTS);
-
-		bool cameraAtPositiveX = (_view_rotate[8] >= 0.0f);
-		bool cameraAtPositiveY = (_view_rotate[9] >= 0.0f);
-		bool cameraAtPositiveZ = (_view_rotate[10] >= 0.0f);
-
-		bool shouldNotAdjustDrawOrder = true;
-
-		/*
-		if (shouldNotAdjustDrawOrder && cameraAtPositiveZ) {
-			// camera is in front of the cube
-
-			for(float k = -1; k < 1.0f; k += _voxelSize.z) {
-				for(float j = -1; j < 1.0f; j += _voxelSize.y) {
-					for(float i = -1; i < 1.0f; i += _voxelSize.x) {
-						glVertex3f(i, j, k);	
-					}
-				}
-			}
-		} else {
-			// camera is behind the cube
-
-			for(float k = 1-_voxelSize.z; k >= -1.0f; k -= _voxelSize.z) {
-				for(float j = 1-_voxelSize.y; j >= -1.0f; j -= _voxelSize.y) {
-					for(float i = 1-_voxelSize.x; i >= -1.0f; i -= _voxelSize.x) {
-						glVertex3f(i, j, k);	
-					}
-				}
-			}
-		}
-		*/
-
-		for(float k = -1; k < 1.0f; k += _voxelSize.z) {
-				for(float j = -1; j < 1.0f; j += _voxelSize.y) {
-					for(float i = -1; i < 1.0f; i += _voxelSize.x) {
-						glVertex3f(i, j, k);	
-					}
-				}
-			}
-
-		glEnd();
-
-
-		glUseProgram(0);
+		_surfaceMesh->draw();
 
 		glPopMatrix();
 	
@@ -8,13 +8,16 @@
 #include <glm/gtc/type_ptr.hpp>
 #include "Utils.h"
 #include "MarchingCubesConstants.h"
-#include <time.h>
+#include "SimulationBackend.h"
+#include "SimulationThread.h"
+#include "TickScheduler.h"
+#include "SurfaceMesh.h"
 
 class AntSim
 {
 
 public:
-	AntSim(int w, int h);
+	AntSim(int w, int h, int seed = -1, SimulationBackendType backendType = BackendFragmentShader);	// seed < 0 picks a fresh one
 
 	void restart();
 	void update();
@@ -22,62 +25,100 @@ public:
 	
 	float* view_rotate();
 
-	float updateIntervalSeconds;	// number of ms to wait between simulation updates
+	float updateIntervalSeconds;	// wall time between simulation ticks, 0 = as fast as possible
+	float targetFramesPerSecond;	// the main loop redraws at this rate while the simulation runs
+	int simulationPaused;	// no ticks while nonzero, and the window is only redrawn when something changes
+	int fastForward;	// if nonzero, run ticksPerFrame ticks per displayed frame without waiting (an int for the GUI checkbox)
+	int ticksPerFrame;	// while fast-forwarding; the ticks in between are never visualized. The CPU backend runs on
+						// its own thread instead, which fast-forwarding only stops from waiting between ticks
 	float trailOpacity;	// how opaque to show the trails in the visualization
 	float cameraDistance; // how far away to have the camera
 	float trailDissipationPerFrame;	// how much a trail fades each time the simulation updates
 
 	float foodNestScoreMultiplier;	// how much importance to place on food or nest when choosing where to move ant
 	float trailScoreMultiplier;	// how much importance to place on trail when choosing where to move ant
+	float crowdingScoreMultiplier;	// how much ants avoid cells that other ants are in
 
 	int width;	// width of the screen
 	int height;	// height of the screen
 
-	int numAnts;
+	int numAnts;	// at restart
+	float antSpawnRate;	// ants the nest spawns per tick
+	int antLifetime;	// ticks an ant lives, 0 = forever
 	int cubeLength;
 
 	bool simulationRunning;
 
 	float randomMovementProbability;	// between 0 and 1, probability that ant will choose to move randomly rather than selecting the cell with highest score
 
-private:		
-	int _initialized;		// if the cells are initialized (=1) or not (=0)
+	SimulationBackendType simulationBackendType;	// which backend to create on the next restart()
+
+	int simulationThreads;	// number of threads for the CPU backend (0 = one per core)
+
+	int randomSeed;	// seed of the next restart(); the same seed and settings replay the same run
+
+	SimulationParameters simulationParameters() const;
+	SimulationThreadSettings simulationThreadSettings() const;
+
+	float ticksPerSecond() const;	// achieved, over the last second
+	float framesPerSecond() const;
+
+	// extracts the whole surface of the displayed world into the mesh, which has to be reset() for this world and
+	// made with visualizationProgramId(); for timing the extraction (see MarchingCubesBenchmark.h)
+	void extractWholeSurface(SurfaceMesh* surfaceMesh);
+	GLuint visualizationProgramId() const;
 
-	GLuint _initializedLoc;
-    GLuint _texUnitLoc;
-    
+private:		
 	//----------------
 
-	GLuint _visualizationProgramId;	// program used for drawing the volume to the screen
+	GLuint _visualizationProgramId;	// program that extracts the surfaces of the volume into the mesh
+	SurfaceMesh* _surfaceMesh;	// what gets drawn to the screen, kept until the world or the settings it depends on change
+	float _surfaceMeshTrailOpacity;
+	float _surfaceMeshTrailDissipationPerFrame;
 
 	glm::ivec3 _worldSize;	// the size of the ant world
 	glm::vec3 _voxelSize;	// how big in each dimension a voxel should be
 
-	GLuint _worldTextureId;
-
 	float _view_rotate[16];
 
-	GLuint _simulationWorldProgramId;
-	GLuint _simulationAntProgramId;
+	SimulationBackend *_simulationBackend;
+	SimulationBackendType _simulationBackendTypeInUse;
 
-	void updateSimulation(GLuint simulationShaderProgramId, PingPong *pingPong, GLuint activeTextureUnit, PingPong *supportPingPong, GLuint supportTextureUnit);
+	// backends that simulate in host memory run on this thread; everything the display needs of them comes from
+	// the snapshot taken at the start of the frame, and the settings reach them through post()
+	SimulationThread _simulationThread;
+	const WorldSnapshot* _worldSnapshot;
 
-	void updateWorld();
-	void updateAnts();
+	unsigned int _displayedTick;	// the tick this frame shows
+	glm::ivec3 _worldAtlasSizeInBricks;
 
-	GLuint _quadVbo;
+	// world atlas and page table for display, uploaded from backends that simulate in host memory
+	Volume _hostWorldTrailVolume;	// one atlas per layer of the cells (see WorldCell.h)
+	Volume _hostWorldFoodVolume;
+	Volume _hostWorldTerrainVolume;
+	GLuint _hostWorldPageTextureId;
+	unsigned int _hostWorldUploadedTick;	// bricks touched before this tick are already in the atlas
+	unsigned int _hostWorldPageTableVersion;
+	unsigned int _hostWorldRestampVersion;	// all bricks are uploaded again after a restamp (see BrickedWorld::restampCells)
 
-	PingPong _worldPingPong;
-	
-	PingPong _antPingPong;
+	void bindWorldTexturesForDisplay();
+	void updateSurfaceMesh();
+	void extractSurface(SurfaceMesh* surfaceMesh, bool everything);
 
-	
 	float _foodPickupRate;	// when an ant picks up some food, how much does that diminish the food supply of a cell
 
 	float _initialFoodRatio;	// amount of food to put in world; e.g. 0.2 = 20% of tiles have food
 
 	
 
-	clock_t _lastUpdateTime;
+	TickScheduler _tickScheduler;	// for the backends that tick inside the frame
+
+	void updateTimingStatistics();
+
+	TickScheduler::Clock::time_point _timingWindowStart;
+	unsigned int _timingWindowStartTick;
+	int _framesInTimingWindow;
+	float _ticksPerSecond;
+	float _framesPerSecond;
 };
 
@@ -0,0 +1,165 @@
+#include "BrickLayoutBenchmark.h"
+#include "BrickedWorld.h"
+#include "Random.h"
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+
+static const int CELLS_PER_CACHE_LINE = 64 / sizeof(WorldCell);
+
+struct GatherResult {
+	double nanosecondsPerGather;
+	double cacheLinesPerGather;	// distinct 64-byte lines, counting from a 64-byte aligned start of the cells
+	unsigned int checksum;	// sum of the trails read, so the gathers can't be optimized away (and the layouts can be compared)
+};
+
+// cell(voxel) reads a cell, cellIndex(voxel) is where it lives in its array; both clamp to the world like the simulation
+template <typename CellFunction, typename IndexFunction>
+static GatherResult timeGathers(const std::vector<glm::ivec3>& positions, CellFunction cell, IndexFunction cellIndex)
+{
+	GatherResult result;
+	result.checksum = 0;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	for (size_t p = 0; p < positions.size(); p++) {
+		for (int dz = -1; dz <= 1; dz++) {
+			for (int dy = -1; dy <= 1; dy++) {
+				for (int dx = -1; dx <= 1; dx++) {
+					result.checksum += cell(positions[p] + glm::ivec3(dx, dy, dz)).trailAnts;
+				}
+			}
+		}
+	}
+
+	result.nanosecondsPerGather = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / positions.size();
+
+	// a separate pass, so counting doesn't slow down the timed one
+	size_t totalLines = 0;
+	for (size_t p = 0; p < positions.size(); p++) {
+		size_t lines[27];
+		int numLines = 0;
+		for (int dz = -1; dz <= 1; dz++) {
+			for (int dy = -1; dy <= 1; dy++) {
+				for (int dx = -1; dx <= 1; dx++) {
+					lines[numLines++] = cellIndex(positions[p] + glm::ivec3(dx, dy, dz)) / CELLS_PER_CACHE_LINE;
+				}
+			}
+		}
+		std::sort(lines, lines + numLines);
+		totalLines += std::unique(lines, lines + numLines) - lines;
+	}
+	result.cacheLinesPerGather = (double)totalLines / positions.size();
+
+	return result;
+}
+
+// the same made-up cell for a voxel in every layout
+static WorldCell benchmarkCell(glm::ivec3 voxel, int cubeLength)
+{
+	WorldCell cell = { 0, 0, 0, 0 };
+	cell.trailAnts = (unsigned short)hashUint((unsigned int)(voxel.x + cubeLength * (voxel.y + cubeLength * voxel.z)));
+	return cell;
+}
+
+static void fillBrickedWorld(BrickedWorld& world, int cubeLength)
+{
+	glm::ivec3 sizeInBricks = world.sizeInBricks();
+	for (int b = 0; b < sizeInBricks.x * sizeInBricks.y * sizeInBricks.z; b++) {
+		glm::ivec3 brickCoord(b % sizeInBricks.x, (b / sizeInBricks.x) % sizeInBricks.y, b / (sizeInBricks.x * sizeInBricks.y));
+		int slot = world.allocateBrick(world.brickIndex(brickCoord), true, 0);
+		WorldCell* cells = world.brickCells(slot);
+		glm::ivec3 origin = brickCoord * WORLD_BRICK_SIZE;
+
+		for (int z = 0; z < WORLD_BRICK_SIZE; z++) {
+			for (int y = 0; y < WORLD_BRICK_SIZE; y++) {
+				for (int x = 0; x < WORLD_BRICK_SIZE; x++) {
+					glm::ivec3 voxel = origin + glm::ivec3(x, y, z);
+					cells[world.voxelIndexInBrick(voxel)] = benchmarkCell(voxel, cubeLength);
+				}
+			}
+		}
+	}
+	world.clearChanges();
+}
+
+static void printResult(const char* layout, const char* pattern, const GatherResult& result)
+{
+	printf("%-22s %-10s %10.1f %14.2f   %08x\n", layout, pattern, result.nanosecondsPerGather, result.cacheLinesPerGather, result.checksum);
+}
+
+int runBrickLayoutBenchmark(int cubeLength, int numGathers)
+{
+	cubeLength = glm::max(cubeLength / WORLD_BRICK_SIZE, 1) * WORLD_BRICK_SIZE;
+	glm::ivec3 worldSize(cubeLength, cubeLength, cubeLength);
+
+	int numBricks = (cubeLength / WORLD_BRICK_SIZE) * (cubeLength / WORLD_BRICK_SIZE) * (cubeLength / WORLD_BRICK_SIZE);
+	if (numBricks > MAX_RESIDENT_BRICKS) {
+		printf("layout benchmark: a %d^3 world doesn't fit in the brick pool, use a cube length of at most 320\n", cubeLength);
+		return 1;
+	}
+
+	printf("layout benchmark: world %dx%dx%d, %d gathers of 3x3x3 voxels per pattern\n", cubeLength, cubeLength, cubeLength, numGathers);
+
+	// scattered: every gather somewhere else, like the first gather of each ant in a tick;
+	// walk: one voxel per step in a random direction, like a single ant over successive ticks;
+	// both stay off the edge, where the bricked world reads its halo instead of clamping
+	std::vector<glm::ivec3> scattered(numGathers);
+	std::vector<glm::ivec3> walk(numGathers);
+	glm::ivec3 walker = worldSize / 2;
+	for (int i = 0; i < numGathers; i++) {
+		unsigned int h = hashUint((unsigned int)i);
+		scattered[i] = 1 + glm::ivec3(hashUint(h ^ 1u) % (cubeLength - 2), hashUint(h ^ 2u) % (cubeLength - 2), hashUint(h ^ 3u) % (cubeLength - 2));
+
+		walker += glm::ivec3((int)(h % 3) - 1, (int)((h >> 8) % 3) - 1, (int)((h >> 16) % 3) - 1);
+		walker = glm::clamp(walker, glm::ivec3(1, 1, 1), worldSize - 2);
+		walk[i] = walker;
+	}
+
+	printf("%-22s %-10s %10s %14s   %s\n", "layout", "pattern", "ns/gather", "lines/gather", "checksum");
+
+	{
+		std::vector<WorldCell> dense((size_t)cubeLength * cubeLength * cubeLength);
+		for (int z = 0; z < cubeLength; z++) {
+			for (int y = 0; y < cubeLength; y++) {
+				for (int x = 0; x < cubeLength; x++) {
+					dense[(size_t)x + cubeLength * ((size_t)y + cubeLength * z)] = benchmarkCell(glm::ivec3(x, y, z), cubeLength);
+				}
+			}
+		}
+
+		auto denseIndex = [&](glm::ivec3 voxel) {
+			voxel = glm::clamp(voxel, glm::ivec3(0, 0, 0), worldSize - 1);
+			return (size_t)voxel.x + cubeLength * ((size_t)voxel.y + cubeLength * voxel.z);
+		};
+		auto denseCell = [&](glm::ivec3 voxel) -> const WorldCell& {
+			return dense[denseIndex(voxel)];
+		};
+
+		printResult("dense x-fastest", "scattered", timeGathers(scattered, denseCell, denseIndex));
+		printResult("dense x-fastest", "walk", timeGathers(walk, denseCell, denseIndex));
+	}
+
+	const BrickVoxelOrder orders[] = { BrickVoxelOrderLinear, BrickVoxelOrderMorton };
+	const char* orderNames[] = { "bricked x-fastest", "bricked morton" };
+
+	for (int o = 0; o < 2; o++) {
+		BrickedWorld world;
+		world.reset(worldSize, true, orders[o]);
+		fillBrickedWorld(world, cubeLength);
+
+		auto brickedIndex = [&](glm::ivec3 voxel) {
+			voxel = glm::clamp(voxel, glm::ivec3(0, 0, 0), worldSize - 1);
+			return (size_t)world.slotOfVoxel(voxel) * WORLD_BRICK_VOXELS + world.voxelIndexInBrick(voxel);
+		};
+		auto brickedCell = [&](glm::ivec3 voxel) -> const WorldCell& {
+			return world.cell(voxel);
+		};
+
+		printResult(orderNames[o], "scattered", timeGathers(scattered, brickedCell, brickedIndex));
+		printResult(orderNames[o], "walk", timeGathers(walk, brickedCell, brickedIndex));
+	}
+
+	return 0;
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+// Compares the world layouts for the 3x3x3 neighbourhood reads the ants do every tick: a dense x-fastest volume, and
+// the bricked world with its voxels in x-fastest and in Morton order. Prints the time per gather and the number of
+// distinct 64-byte cache lines each gather touches, for scattered gathers and for gathers along an ant-like walk.
+// usage: myproject --benchmark-layout [--cube-length N] [--gathers N]
+int runBrickLayoutBenchmark(int cubeLength, int numGathers);
@@ -0,0 +1,532 @@
+#include "BrickedWorld.h"
+#include "Random.h"
+#include "Morton.h"
+#include <algorithm>
+#include <stdio.h>
+
+static const int MAX_SINGLE_VOXEL_FOOD_WORLD_SIZE = 128;	// the largest world before sparse storage; keeps its scenarios
+
+// edge length of the cubes food is placed in: single voxels up to 128^3, so those worlds start out as they always did,
+// and whole bricks from 256^3 up, so that most bricks of a large world start out empty
+static int foodPatchSize(glm::ivec3 worldSize)
+{
+	if (glm::max(worldSize.x, glm::max(worldSize.y, worldSize.z)) <= MAX_SINGLE_VOXEL_FOOD_WORLD_SIZE) {
+		return 1;
+	}
+	return WORLD_BRICK_SIZE;
+}
+
+static const WorldCell EMPTY_CELL = { 0, 0, 0, 0 };
+
+static const WorldCell NON_RESIDENT_CELLS[] = { WALL_WORLD_CELL, EMPTY_CELL };	// indexed by slot - WALL_BRICK
+
+BrickedWorld::BrickedWorld() : _worldSize(0, 0, 0), _sizeInBricks(0, 0, 0), _pageTableSize(0, 0, 0), _atlasSizeInBricks(0, 0, 0), _capacity(0), _storeCells(false), _voxelOrder(BrickVoxelOrderLinear), _pageTableVersion(0), _restampVersion(0), _numResidentBricks(0), _reportedPoolFull(false)
+{
+}
+
+void BrickedWorld::reset(glm::ivec3 worldSize, bool storeCells, BrickVoxelOrder voxelOrder)
+{
+	_worldSize = worldSize;
+	_sizeInBricks = (worldSize + WORLD_BRICK_SIZE - 1) / WORLD_BRICK_SIZE;
+	_pageTableSize = _sizeInBricks + 2 * WORLD_HALO_BRICKS;
+	_storeCells = storeCells;
+	_voxelOrder = voxelOrder;
+
+	for (int i = 0; i < WORLD_BRICK_VOXELS; i++) {
+		glm::ivec3 local(i % WORLD_BRICK_SIZE, (i / WORLD_BRICK_SIZE) % WORLD_BRICK_SIZE, i / (WORLD_BRICK_SIZE * WORLD_BRICK_SIZE));
+		_voxelIndexInBrick[i] = (voxelOrder == BrickVoxelOrderMorton) ? (int)mortonEncode(local) : i;
+	}
+
+	int numBricks = _sizeInBricks.x * _sizeInBricks.y * _sizeInBricks.z;
+	_capacity = glm::min(numBricks, MAX_RESIDENT_BRICKS);
+
+	// roughly cubic atlas, so that no side goes past GL_MAX_3D_TEXTURE_SIZE
+	int side = 1;
+	while (side * side * side < _capacity) {
+		side++;
+	}
+	_atlasSizeInBricks = glm::ivec3(side, side, (_capacity + side * side - 1) / (side * side));
+
+	_pageTable.assign(_pageTableSize.x * _pageTableSize.y * _pageTableSize.z, WALL_BRICK);
+	for (int bz = 0; bz < _sizeInBricks.z; bz++) {
+		for (int by = 0; by < _sizeInBricks.y; by++) {
+			for (int bx = 0; bx < _sizeInBricks.x; bx++) {
+				_pageTable[brickIndex(glm::ivec3(bx, by, bz))] = EMPTY_BRICK;
+			}
+		}
+	}
+	_pageTableVersion++;
+
+	_slotBrick.clear();
+	_slotPinned.clear();
+	_slotTouchedTick.clear();
+	_freeSlots.clear();
+	_cells.clear();
+	_numResidentBricks = 0;
+
+	_changedBricks.clear();
+	_allocatedSlots.clear();
+
+	_reportedPoolFull = false;
+
+	printf("bricked world: %d x %d x %d bricks, pool of %d bricks\n", _sizeInBricks.x, _sizeInBricks.y, _sizeInBricks.z, _capacity);
+}
+
+glm::ivec3 BrickedWorld::worldSize() const
+{
+	return _worldSize;
+}
+
+glm::ivec3 BrickedWorld::sizeInBricks() const
+{
+	return _sizeInBricks;
+}
+
+glm::ivec3 BrickedWorld::pageTableSize() const
+{
+	return _pageTableSize;
+}
+
+glm::ivec3 BrickedWorld::atlasSizeInBricks() const
+{
+	return _atlasSizeInBricks;
+}
+
+glm::ivec3 BrickedWorld::atlasSize() const
+{
+	return _atlasSizeInBricks * WORLD_BRICK_SIZE;
+}
+
+int BrickedWorld::numBrickRequestWords() const
+{
+	return (_sizeInBricks.x * _sizeInBricks.y * _sizeInBricks.z + BRICK_REQUESTS_PER_WORD - 1) / BRICK_REQUESTS_PER_WORD;
+}
+
+int BrickedWorld::capacity() const
+{
+	return _capacity;
+}
+
+int BrickedWorld::numResidentBricks() const
+{
+	return _numResidentBricks;
+}
+
+int BrickedWorld::numSlotsInUse() const
+{
+	return (int)_slotBrick.size();
+}
+
+bool BrickedWorld::storesCells() const
+{
+	return _storeCells;
+}
+
+BrickVoxelOrder BrickedWorld::voxelOrder() const
+{
+	return _voxelOrder;
+}
+
+const int* BrickedWorld::pageTable() const
+{
+	return _pageTable.empty() ? 0 : &_pageTable[0];
+}
+
+unsigned int BrickedWorld::pageTableVersion() const
+{
+	return _pageTableVersion;
+}
+
+int BrickedWorld::brickIndex(glm::ivec3 brickCoord) const
+{
+	glm::ivec3 entry = brickCoord + WORLD_HALO_BRICKS;
+	return entry.x + _pageTableSize.x * (entry.y + _pageTableSize.y * entry.z);
+}
+
+glm::ivec3 BrickedWorld::brickCoord(int brickIndex) const
+{
+	return pageTableCoord(brickIndex) - WORLD_HALO_BRICKS;
+}
+
+glm::ivec3 BrickedWorld::pageTableCoord(int brickIndex) const
+{
+	return glm::ivec3(
+		brickIndex % _pageTableSize.x,
+		(brickIndex / _pageTableSize.x) % _pageTableSize.y,
+		brickIndex / (_pageTableSize.x * _pageTableSize.y));
+}
+
+int BrickedWorld::slotOfVoxel(glm::ivec3 voxel) const
+{
+	// shifted by the halo first, so that voxels just outside the world don't round towards brick 0
+	glm::ivec3 entry = (voxel + WORLD_HALO_BRICKS * WORLD_BRICK_SIZE) / WORLD_BRICK_SIZE;
+	return _pageTable[entry.x + _pageTableSize.x * (entry.y + _pageTableSize.y * entry.z)];
+}
+
+glm::ivec3 BrickedWorld::atlasBrickCoord(int slot) const
+{
+	return glm::ivec3(
+		slot % _atlasSizeInBricks.x,
+		(slot / _atlasSizeInBricks.x) % _atlasSizeInBricks.y,
+		slot / (_atlasSizeInBricks.x * _atlasSizeInBricks.y));
+}
+
+int BrickedWorld::slotBrick(int slot) const
+{
+	return _slotBrick[slot];
+}
+
+unsigned int BrickedWorld::slotTouchedTick(int slot) const
+{
+	return _slotTouchedTick[slot];
+}
+
+int BrickedWorld::voxelIndexInBrick(glm::ivec3 voxel) const
+{
+	return _voxelIndexInBrick[atlasVoxelIndexInBrick(voxel)];
+}
+
+const int* BrickedWorld::voxelIndexInBrickTable() const
+{
+	return _voxelIndexInBrick;
+}
+
+int BrickedWorld::atlasVoxelIndexInBrick(glm::ivec3 voxel)
+{
+	glm::ivec3 local = voxel & (WORLD_BRICK_SIZE - 1);
+	return local.x + WORLD_BRICK_SIZE * (local.y + WORLD_BRICK_SIZE * local.z);
+}
+
+int BrickedWorld::allocateBrick(int brickIndex, bool pinned, unsigned int tick)
+{
+	int slot;
+	if (!_freeSlots.empty()) {
+		slot = _freeSlots.back();
+		_freeSlots.pop_back();
+	} else if ((int)_slotBrick.size() < _capacity) {
+		slot = (int)_slotBrick.size();
+		_slotBrick.push_back(EMPTY_BRICK);
+		_slotPinned.push_back(0);
+		_slotTouchedTick.push_back(0);
+		if (_storeCells) {
+			_cells.resize(_cells.size() + WORLD_BRICK_VOXELS);
+		}
+	} else {
+		if (!_reportedPoolFull) {
+			printf("bricked world: pool of %d bricks is full, trails outside it are dropped\n", _capacity);
+			_reportedPoolFull = true;
+		}
+		return EMPTY_BRICK;
+	}
+
+	_slotBrick[slot] = brickIndex;
+	_slotPinned[slot] = pinned ? 1 : 0;
+	_slotTouchedTick[slot] = tick;
+	if (_storeCells) {
+		std::fill(_cells.begin() + (size_t)slot * WORLD_BRICK_VOXELS, _cells.begin() + (size_t)(slot + 1) * WORLD_BRICK_VOXELS, EMPTY_CELL);
+	}
+
+	_pageTable[brickIndex] = slot;
+	_pageTableVersion++;
+	_numResidentBricks++;
+
+	_changedBricks.push_back(brickIndex);
+	_allocatedSlots.push_back(slot);
+
+	return slot;
+}
+
+void BrickedWorld::touchNeighborhood(glm::ivec3 voxel, unsigned int tick, int radius)
+{
+	glm::ivec3 antBrick = glm::clamp(voxel, glm::ivec3(0, 0, 0), _worldSize - 1) / WORLD_BRICK_SIZE;
+	bool antInWorld = (voxel == glm::clamp(voxel, glm::ivec3(0, 0, 0), _worldSize - 1));
+
+	// the neighbourhood spans at most two bricks along each axis
+	glm::ivec3 minBrick = glm::max(voxel - radius, glm::ivec3(0, 0, 0)) / WORLD_BRICK_SIZE;
+	glm::ivec3 maxBrick = glm::min(voxel + radius, _worldSize - 1) / WORLD_BRICK_SIZE;
+
+	for (int bz = minBrick.z; bz <= maxBrick.z; bz++) {
+		for (int by = minBrick.y; by <= maxBrick.y; by++) {
+			for (int bx = minBrick.x; bx <= maxBrick.x; bx++) {
+				glm::ivec3 brick(bx, by, bz);
+				touchBrick(brickIndex(brick), antInWorld && brick == antBrick, tick);
+			}
+		}
+	}
+}
+
+void BrickedWorld::touchRequestedBricks(int firstBrick, unsigned int requests, unsigned int tick)
+{
+	static const unsigned int requestMask = (1u << BRICK_REQUEST_BITS) - 1;
+
+	for (int brick = firstBrick; requests != 0; brick++, requests >>= BRICK_REQUEST_BITS) {
+		unsigned int request = requests & requestMask;
+		if ((request & BRICK_REQUEST_TOUCH) == 0) {
+			continue;
+		}
+
+		glm::ivec3 coord(brick % _sizeInBricks.x, (brick / _sizeInBricks.x) % _sizeInBricks.y, brick / (_sizeInBricks.x * _sizeInBricks.y));
+		touchBrick(brickIndex(coord), (request & BRICK_REQUEST_PIN) != 0, tick);
+	}
+}
+
+void BrickedWorld::requestNeighborhood(glm::ivec3 voxel, int radius, std::atomic<unsigned int>* requests) const
+{
+	glm::ivec3 antBrick = glm::clamp(voxel, glm::ivec3(0, 0, 0), _worldSize - 1) / WORLD_BRICK_SIZE;
+	bool antInWorld = (voxel == glm::clamp(voxel, glm::ivec3(0, 0, 0), _worldSize - 1));
+
+	glm::ivec3 minBrick = glm::max(voxel - radius, glm::ivec3(0, 0, 0)) / WORLD_BRICK_SIZE;
+	glm::ivec3 maxBrick = glm::min(voxel + radius, _worldSize - 1) / WORLD_BRICK_SIZE;
+
+	for (int bz = minBrick.z; bz <= maxBrick.z; bz++) {
+		for (int by = minBrick.y; by <= maxBrick.y; by++) {
+			for (int bx = minBrick.x; bx <= maxBrick.x; bx++) {
+				glm::ivec3 brick(bx, by, bz);
+				int request = bx + _sizeInBricks.x * (by + _sizeInBricks.y * bz);
+
+				unsigned int bits = (antInWorld && brick == antBrick) ? (BRICK_REQUEST_TOUCH | BRICK_REQUEST_PIN) : BRICK_REQUEST_TOUCH;
+				bits <<= BRICK_REQUEST_BITS * (request % BRICK_REQUESTS_PER_WORD);
+
+				// ants next to each other mark the same bricks, so most of the time the bits are there already and
+				// the cache line stays shared
+				std::atomic<unsigned int>& word = requests[request / BRICK_REQUESTS_PER_WORD];
+				if ((word.load(std::memory_order_relaxed) & bits) != bits) {
+					word.fetch_or(bits, std::memory_order_relaxed);
+				}
+			}
+		}
+	}
+}
+
+void BrickedWorld::touchBrick(int brickIndex, bool pin, unsigned int tick)
+{
+	int slot = _pageTable[brickIndex];
+	if (slot == EMPTY_BRICK) {
+		slot = allocateBrick(brickIndex, false, tick);
+	} else {
+		_slotTouchedTick[slot] = tick;
+	}
+
+	if (slot != EMPTY_BRICK && pin) {
+		_slotPinned[slot] = 1;
+	}
+}
+
+void BrickedWorld::releaseFadedBricks(unsigned int tick, float trailDissipationPerFrame)
+{
+	if (trailDissipationPerFrame <= 0.0f) {
+		return;	// trails never fade
+	}
+
+	for (int slot = 0; slot < (int)_slotBrick.size(); slot++) {
+		if (_slotBrick[slot] == EMPTY_BRICK || _slotPinned[slot]) {
+			continue;
+		}
+
+		if (brickSettled(_slotTouchedTick[slot], tick, trailDissipationPerFrame)) {
+			_pageTable[_slotBrick[slot]] = EMPTY_BRICK;
+			_pageTableVersion++;
+			_changedBricks.push_back(_slotBrick[slot]);
+
+			_slotBrick[slot] = EMPTY_BRICK;
+			_freeSlots.push_back(slot);
+			_numResidentBricks--;
+		}
+	}
+}
+
+bool BrickedWorld::brickSettled(unsigned int touchedTick, unsigned int tick, float trailDissipationPerFrame)
+{
+	// the cells were last stamped at touched tick + 1, and their ants only count at that very tick
+	if (tick <= touchedTick + 1) {
+		return false;
+	}
+
+	// with a strength of at most 1
+	return trailDissipationPerFrame <= 0.0f || (float)(tick - touchedTick - 1) * trailDissipationPerFrame > 1.0f;
+}
+
+void BrickedWorld::restampCells(unsigned int tick, float trailDissipationPerFrame)
+{
+	if (!_storeCells) {
+		return;
+	}
+
+	bool restamped = false;
+	for (int slot = 0; slot < (int)_slotBrick.size(); slot++) {
+		if (_slotBrick[slot] == EMPTY_BRICK) {
+			continue;
+		}
+
+		WorldCell* cells = brickCells(slot);
+		for (int i = 0; i < WORLD_BRICK_VOXELS; i++) {
+			restamped = restampWorldCell(&cells[i], tick, trailDissipationPerFrame) || restamped;
+		}
+	}
+
+	if (restamped) {
+		_restampVersion++;
+	}
+}
+
+unsigned int BrickedWorld::restampVersion() const
+{
+	return _restampVersion;
+}
+
+const std::vector<int>& BrickedWorld::changedBricks() const
+{
+	return _changedBricks;
+}
+
+const std::vector<int>& BrickedWorld::allocatedSlots() const
+{
+	return _allocatedSlots;
+}
+
+void BrickedWorld::clearChanges()
+{
+	_changedBricks.clear();
+	_allocatedSlots.clear();
+}
+
+const WorldCell& BrickedWorld::cell(glm::ivec3 voxel) const
+{
+	int slot = slotOfVoxel(voxel);
+	if (slot < 0) {
+		return NON_RESIDENT_CELLS[slot - WALL_BRICK];
+	}
+	return _cells[(size_t)slot * WORLD_BRICK_VOXELS + voxelIndexInBrick(voxel)];
+}
+
+const WorldCell* BrickedWorld::poolCells() const
+{
+	return _cells.empty() ? 0 : &_cells[0];
+}
+
+WorldCell* BrickedWorld::brickCells(int slot)
+{
+	return &_cells[(size_t)slot * WORLD_BRICK_VOXELS];
+}
+
+const WorldCell* BrickedWorld::brickCells(int slot) const
+{
+	return &_cells[(size_t)slot * WORLD_BRICK_VOXELS];
+}
+
+void BrickedWorld::brickCellsInAtlasOrder(int slot, WorldCell* cells) const
+{
+	const WorldCell* poolCells = brickCells(slot);
+	if (_voxelOrder == BrickVoxelOrderLinear) {
+		std::copy(poolCells, poolCells + WORLD_BRICK_VOXELS, cells);
+		return;
+	}
+	for (int i = 0; i < WORLD_BRICK_VOXELS; i++) {
+		cells[i] = poolCells[_voxelIndexInBrick[i]];
+	}
+}
+
+bool BrickedWorld::initialBrickCells(const SimulationParameters& parameters, glm::ivec3 brickCoord, WorldCell* cells)
+{
+	glm::vec3 centerOfWorld = glm::vec3(parameters.worldSize) / 2.0f;	// if world size is 16x16x16, this gets element 8,8,8
+	int patchSize = foodPatchSize(parameters.worldSize);
+	glm::ivec3 patchesPerAxis = (parameters.worldSize + patchSize - 1) / patchSize;
+	glm::ivec3 brickOrigin = brickCoord * WORLD_BRICK_SIZE;
+
+	// the nest is the ball of radius 2 around the center of the world
+	glm::vec3 closestToCenter = glm::clamp(centerOfWorld, glm::vec3(brickOrigin), glm::vec3(brickOrigin + WORLD_BRICK_SIZE - 1));
+	bool hasNest = glm::distance(centerOfWorld, closestToCenter) < 2.0f;
+
+	// each food patch is filled with probability initialFoodRatio, so the expected share of food voxels stays the same
+	int patchesPerBrick = WORLD_BRICK_SIZE / patchSize;
+	bool patchHasFood[WORLD_BRICK_SIZE][WORLD_BRICK_SIZE][WORLD_BRICK_SIZE];
+	bool hasFood = false;
+	for (int pz = 0; pz < patchesPerBrick; pz++) {
+		for (int py = 0; py < patchesPerBrick; py++) {
+			for (int px = 0; px < patchesPerBrick; px++) {
+				glm::ivec3 patch = brickCoord * patchesPerBrick + glm::ivec3(px, py, pz);
+				unsigned int patchIndex = (unsigned int)(patch.x + patchesPerAxis.x * (patch.y + patchesPerAxis.y * patch.z));
+				float r = randomUniform(parameters.seed, RANDOM_STREAM_FOOD, 0, patchIndex, 0);
+				patchHasFood[pz][py][px] = r < parameters.initialFoodRatio;
+				hasFood = hasFood || patchHasFood[pz][py][px];
+			}
+		}
+	}
+
+	if (!hasNest && !hasFood) {
+		return false;
+	}
+
+	for (int z = 0; z < WORLD_BRICK_SIZE; z++) {
+		for (int y = 0; y < WORLD_BRICK_SIZE; y++) {
+			for (int x = 0; x < WORLD_BRICK_SIZE; x++) {
+				glm::ivec3 voxel = brickOrigin + glm::ivec3(x, y, z);
+				WorldCell& cell = cells[atlasVoxelIndexInBrick(voxel)];
+
+				if (glm::distance(centerOfWorld, glm::vec3(voxel)) < 2.0f) {
+					cell = packWorldCell(true, 0.0f, 0.0f, 0, 0);	// establish the nest at the center of the world
+				} else if (patchHasFood[z / patchSize][y / patchSize][x / patchSize]) {
+					cell = packWorldCell(false, 1.0f, 0.0f, 0, 0);	// put food here
+				} else {
+					cell = EMPTY_CELL;	// default; nothing here
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+void BrickedWorld::initializeBrick(const SimulationParameters& parameters, glm::ivec3 brickCoord, const BrickFunction& uploadBrick)
+{
+	int index = brickIndex(brickCoord);
+	if (_pageTable[index] != EMPTY_BRICK) {
+		return;
+	}
+
+	WorldCell cells[WORLD_BRICK_VOXELS];
+	if (!initialBrickCells(parameters, brickCoord, cells)) {
+		return;	// empty space costs nothing
+	}
+
+	int slot = allocateBrick(index, true, 0);
+	if (slot == EMPTY_BRICK) {
+		return;
+	}
+
+	if (_storeCells) {
+		WorldCell* poolCells = brickCells(slot);
+		for (int i = 0; i < WORLD_BRICK_VOXELS; i++) {
+			poolCells[_voxelIndexInBrick[i]] = cells[i];
+		}
+	}
+	uploadBrick(slot, cells);
+}
+
+void BrickedWorld::initialize(const SimulationParameters& parameters, const BrickFunction& uploadBrick)
+{
+	// the nest is within 2 voxels of the center
+	glm::ivec3 centerOfWorld = _worldSize / 2;
+	glm::ivec3 minNestBrick = glm::max(centerOfWorld - 2, glm::ivec3(0, 0, 0)) / WORLD_BRICK_SIZE;
+	glm::ivec3 maxNestBrick = glm::min(centerOfWorld + 2, _worldSize - 1) / WORLD_BRICK_SIZE;
+
+	for (int bz = minNestBrick.z; bz <= maxNestBrick.z; bz++) {
+		for (int by = minNestBrick.y; by <= maxNestBrick.y; by++) {
+			for (int bx = minNestBrick.x; bx <= maxNestBrick.x; bx++) {
+				initializeBrick(parameters, glm::ivec3(bx, by, bz), uploadBrick);
+			}
+		}
+	}
+
+	for (int bz = 0; bz < _sizeInBricks.z; bz++) {
+		for (int by = 0; by < _sizeInBricks.y; by++) {
+			for (int bx = 0; bx < _sizeInBricks.x; bx++) {
+				initializeBrick(parameters, glm::ivec3(bx, by, bz), uploadBrick);
+			}
+		}
+	}
+
+	clearChanges();
+
+	printf("initial world: %d of %d bricks resident\n", _numResidentBricks, _sizeInBricks.x * _sizeInBricks.y * _sizeInBricks.z);
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <functional>
+#include <glm/glm.hpp>
+#include "SimulationBackend.h"
+#include "WorldCell.h"
+
+// The world is stored as 8x8x8 bricks that are only allocated where there is something (nest, food or trail).
+// A page table maps every brick of the world to a slot in a pool of resident bricks, or to EMPTY_BRICK, which
+// reads as all-zero cells. The GPU uses the same layout: the page table is an integer 3D texture and the pool is
+// a 3D atlas texture in which slot s is the 8x8x8 block at atlasBrickCoord(s), with the voxels of a brick in the
+// x-fastest order (see lookupWorldCell in the simulation and visualization shaders). The host pool can keep the voxels
+// of each brick in Morton order instead, which keeps the 3x3x3 neighbourhood of a voxel in fewer cache lines.
+// The page table has a halo one brick wide around the world whose entries are all WALL_BRICK: those read as wall
+// cells (see WorldCell.h), so the neighbourhood of an ant can be read without clamping or bounds checks, on the
+// host and in the shaders, as long as the ant is within a brick of the world (it never gets more than one voxel out).
+
+static const int WORLD_BRICK_SIZE = 8;	// voxels along each edge of a brick
+static const int WORLD_BRICK_VOXELS = WORLD_BRICK_SIZE * WORLD_BRICK_SIZE * WORLD_BRICK_SIZE;
+static const int EMPTY_BRICK = -1;	// page table entry of a brick that isn't resident
+static const int WALL_BRICK = -2;	// page table entry of the halo around the world
+static const int WORLD_HALO_BRICKS = 1;	// bricks of halo on each side of the world
+static const int MAX_RESIDENT_BRICKS = 65536;	// pool capacity; 256 MB of packed 64-bit cells, a few percent of a 1024^3 world
+
+// brick requests: what the ants need of each brick of the world on the next tick, BRICK_REQUEST_BITS per brick over the
+// bricks of the world in x-fastest order (no halo). A GPU backend marks them in a pass over the ants and reads them
+// back a tick later, so the host never reads the ants themselves (see touchRequestedBricks). The fragment backend keeps
+// one request per byte, the compute backend packs them into words, and so does the CPU backend, whose threads mark
+// them for their own ants (see requestNeighborhood)
+static const unsigned int BRICK_REQUEST_TOUCH = 1;	// within two voxels of an ant
+static const unsigned int BRICK_REQUEST_PIN = 2;	// an ant stands in it; only set along with BRICK_REQUEST_TOUCH
+static const int BRICK_REQUEST_BITS = 2;
+static const int BRICK_REQUESTS_PER_WORD = 32 / BRICK_REQUEST_BITS;	// where requests are packed into 32-bit words, lowest bits first
+
+// order of the voxels of a brick in the host pool
+enum BrickVoxelOrder {
+	BrickVoxelOrderLinear,	// x-fastest, like the GL atlas; each row of a brick is one 64-byte cache line
+	BrickVoxelOrderMorton	// Z-order (see Morton.h); each 2x2x2 block of a brick is one 64-byte cache line
+};
+
+class BrickedWorld
+{
+public:
+	BrickedWorld();
+
+	// drops all bricks; the pool only keeps cells if storeCells is set (a GPU backend only needs the bookkeeping).
+	// The world size should be a multiple of WORLD_BRICK_SIZE, so that the halo starts right at its edge
+	void reset(glm::ivec3 worldSize, bool storeCells, BrickVoxelOrder voxelOrder = BrickVoxelOrderMorton);
+
+	glm::ivec3 worldSize() const;
+	glm::ivec3 sizeInBricks() const;	// bricks of the world along each axis
+	glm::ivec3 pageTableSize() const;	// page table entries along each axis, halo included
+	glm::ivec3 atlasSizeInBricks() const;	// how the pool slots are laid out in the GL atlas texture
+	glm::ivec3 atlasSize() const;	// atlas texture size in voxels
+	int numBrickRequestWords() const;	// words of BRICK_REQUESTS_PER_WORD requests it takes to cover the world
+	int capacity() const;
+	int numResidentBricks() const;
+	int numSlotsInUse() const;	// slots [0, numSlotsInUse()) have been handed out at least once
+	bool storesCells() const;
+	BrickVoxelOrder voxelOrder() const;
+
+	const int* pageTable() const;
+	unsigned int pageTableVersion() const;	// changes whenever a page table entry changes
+
+	int brickIndex(glm::ivec3 brickCoord) const;	// page table index of a brick of the world
+	glm::ivec3 brickCoord(int brickIndex) const;
+	glm::ivec3 pageTableCoord(int brickIndex) const;	// where the entry is in the page table texture, past the halo
+	int slotOfVoxel(glm::ivec3 voxel) const;	// EMPTY_BRICK if the brick isn't resident, WALL_BRICK outside the world
+	glm::ivec3 atlasBrickCoord(int slot) const;
+	int slotBrick(int slot) const;	// brick index the slot holds, EMPTY_BRICK if the slot is free
+	unsigned int slotTouchedTick(int slot) const;	// last tick the slot was allocated or touched by an ant
+
+	int voxelIndexInBrick(glm::ivec3 voxel) const;	// index into brickCells(), in the pool's voxel order
+	const int* voxelIndexInBrickTable() const;	// the same, indexed by atlasVoxelIndexInBrick()
+	static int atlasVoxelIndexInBrick(glm::ivec3 voxel);	// x-fastest, the order uploads to the GL atlas expect
+
+	// allocates a zeroed brick; pinned bricks are never released. Returns EMPTY_BRICK if the pool is full
+	int allocateBrick(int brickIndex, bool pinned, unsigned int tick);
+
+	// makes every brick overlapping the neighbourhood of an ant (radius voxels along each axis, at most WORLD_BRICK_SIZE / 2)
+	// resident, and stamps them with tick; the brick the ant stands in is pinned, since the world update leaves food
+	// below zero wherever an ant has been
+	void touchNeighborhood(glm::ivec3 voxel, unsigned int tick, int radius = 1);
+
+	// touchNeighborhood() for requests marked by ants: every brick whose request has BRICK_REQUEST_TOUCH set is made
+	// resident and stamped with tick, and pinned with BRICK_REQUEST_PIN. requests holds the requests of the bricks
+	// from firstBrick on (in request order), as many as fit in it
+	void touchRequestedBricks(int firstBrick, unsigned int requests, unsigned int tick);
+
+	// or's the requests touchNeighborhood(voxel, tick, radius) would act on into numBrickRequestWords() words, without
+	// changing the world, so threads can mark the bricks of their own ants at the same time
+	void requestNeighborhood(glm::ivec3 voxel, int radius, std::atomic<unsigned int>* requests) const;
+
+	// releases the unpinned bricks, which only ever held trail, once their trails have faded to zero by tick
+	void releaseFadedBricks(unsigned int tick, float trailDissipationPerFrame);
+
+	// whether a brick last touched at touchedTick reads the same at tick as at every tick after it: its ants are gone
+	// and its trails have faded to zero, or never fade
+	static bool brickSettled(unsigned int touchedTick, unsigned int tick, float trailDissipationPerFrame);
+
+	// runs restampWorldCell (see WorldCell.h) on every resident cell; only if storesCells(). It leaves the touched ticks
+	// alone, so the bricks are released just as in a backend that restamps its own copy of the cells
+	void restampCells(unsigned int tick, float trailDissipationPerFrame);
+	unsigned int restampVersion() const;	// changes whenever restampCells() changes a cell
+
+	// page table entries and newly handed out slots since the last clearChanges(), for backends that mirror the pool in GL
+	const std::vector<int>& changedBricks() const;
+	const std::vector<int>& allocatedSlots() const;
+	void clearChanges();
+
+	// cells; only valid if storesCells()
+	const WorldCell& cell(glm::ivec3 voxel) const;	// zero if not resident, a wall cell outside the world
+	const WorldCell* poolCells() const;	// all slots, WORLD_BRICK_VOXELS per slot; moves when a slot is handed out
+	WorldCell* brickCells(int slot);
+	const WorldCell* brickCells(int slot) const;
+	void brickCellsInAtlasOrder(int slot, WorldCell* cells) const;	// copies a brick out in x-fastest order, for uploading
+
+	typedef std::function<void(int slot, const WorldCell* cells)> BrickFunction;	// cells in x-fastest order
+
+	// allocates the bricks holding the initial nest and food (the nest first, so it always gets a slot), stores their cells
+	// if storesCells(), and passes them to uploadBrick; shared by the backends so they start from the same world
+	void initialize(const SimulationParameters& parameters, const BrickFunction& uploadBrick);
+
+private:
+	glm::ivec3 _worldSize;
+	glm::ivec3 _sizeInBricks;
+	glm::ivec3 _pageTableSize;
+	glm::ivec3 _atlasSizeInBricks;
+	int _capacity;
+	bool _storeCells;
+	BrickVoxelOrder _voxelOrder;
+	int _voxelIndexInBrick[WORLD_BRICK_VOXELS];	// x-fastest index -> index in the pool's voxel order
+
+	std::vector<int> _pageTable;	// brick index -> slot, EMPTY_BRICK or WALL_BRICK
+	unsigned int _pageTableVersion;
+	unsigned int _restampVersion;
+
+	std::vector<int> _slotBrick;	// slot -> brick index, EMPTY_BRICK if free
+	std::vector<unsigned char> _slotPinned;	// nest, food, or visited by an ant
+	std::vector<unsigned int> _slotTouchedTick;
+	std::vector<int> _freeSlots;
+	int _numResidentBricks;
+
+	std::vector<WorldCell> _cells;	// slot-major, WORLD_BRICK_VOXELS per slot
+
+	std::vector<int> _changedBricks;
+	std::vector<int> _allocatedSlots;
+
+	bool _reportedPoolFull;
+
+	void touchBrick(int brickIndex, bool pin, unsigned int tick);
+
+	// returns false (and leaves cells alone) if the brick starts out empty; cells are in x-fastest order
+	static bool initialBrickCells(const SimulationParameters& parameters, glm::ivec3 brickCoord, WorldCell* cells);
+	void initializeBrick(const SimulationParameters& parameters, glm::ivec3 brickCoord, const BrickFunction& uploadBrick);
+};
@@ -0,0 +1,400 @@
+#include "ComputeSimulationBackend.h"
+#include "AntDirection.h"
+
+static const unsigned int BRICK_RELEASE_INTERVAL = 64;	// ticks between sweeps for bricks whose trails have faded
+
+static const GLenum ANT_COUNT_TEXTURE_FORMAT = GL_R32UI;	// imageAtomicAdd needs a 32-bit integer format
+
+static const int ANT_WORKGROUP_SIZE = 128;	// local_size_x of simulation_ant_compute.glsl
+
+// binding points, also given in the layout qualifiers of the compute shaders
+static const GLuint ANTS_BINDING = 0;	// shader storage buffer
+static const GLuint PREVIOUS_ANTS_BINDING = 1;	// shader storage buffer, only read by the ant pass
+static const GLuint BRICK_REQUESTS_BINDING = 2;	// shader storage buffer
+static const GLuint ANT_MOVEMENT_CONES_BINDING = 0;	// uniform buffer
+static const GLuint WORLD_TRAIL_IMAGE_UNIT = 0;
+static const GLuint ANT_COUNT_IMAGE_UNIT = 1;
+static const GLuint NEARBY_ANT_COUNT_IMAGE_UNIT = 2;
+static const GLuint WORLD_FOOD_IMAGE_UNIT = 3;
+
+ComputeSimulationBackend::ComputeSimulationBackend() : _seed(0), _tick(0), _numAnts(0), _numPreviousAnts(0), _currentAntBuffer(0), _brickRequestFence(0), _numBrickRequestWords(0)
+{
+	glGenTextures(1, &_worldTrailTextureId);
+	Utils::updateTextureSize(_worldTrailTextureId, glm::ivec3(1, 1, 1), WORLD_TRAIL_TEXTURE_FORMAT);
+
+	glGenTextures(1, &_worldFoodTextureId);
+	Utils::updateTextureSize(_worldFoodTextureId, glm::ivec3(1, 1, 1), WORLD_FOOD_TEXTURE_FORMAT);
+
+	glGenTextures(1, &_worldTerrainTextureId);
+	Utils::updateTextureSize(_worldTerrainTextureId, glm::ivec3(1, 1, 1), WORLD_TERRAIN_TEXTURE_FORMAT);
+
+	_antCountVolume = Utils::createVolume(glm::ivec3(1, 1, 1), ANT_COUNT_TEXTURE_FORMAT);
+
+	_nearbyAntCountVolume = Utils::createVolume(glm::ivec3(1, 1, 1), ANT_COUNT_TEXTURE_FORMAT);
+
+	_worldPageTextureId = Utils::createPageTexture(glm::ivec3(1, 1, 1));
+
+	glGenBuffers(2, _antBufferIds);
+	_antBufferCapacity[0] = 0;
+	_antBufferCapacity[1] = 0;
+
+	glGenBuffers(1, &_brickRequestBufferId);
+	glGenBuffers(1, &_brickRequestReadbackBufferId);
+
+	_antProgramId = Utils::createComputeProgram("simulation_ant_compute.glsl");
+	printf("_antProgramId: %d\n", _antProgramId);
+
+	_worldProgramId = Utils::createComputeProgram("simulation_world_compute.glsl");
+	printf("_worldProgramId: %d\n", _worldProgramId);
+
+	_restampProgramId = Utils::createComputeProgram("simulation_restamp_compute.glsl");
+	printf("_restampProgramId: %d\n", _restampProgramId);
+
+	// the movement cone of every direction code never changes, so the ant shader gets it once
+	std::vector<glm::ivec4> antMovementCones = antMovementConeUniformBlock();
+	glGenBuffers(1, &_antMovementConeBufferId);
+	glBindBuffer(GL_UNIFORM_BUFFER, _antMovementConeBufferId);
+	glBufferData(GL_UNIFORM_BUFFER, antMovementCones.size() * sizeof(glm::ivec4), &antMovementCones[0], GL_STATIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+const char* ComputeSimulationBackend::name() const
+{
+	return "compute";
+}
+
+unsigned int ComputeSimulationBackend::tick() const
+{
+	return _tick;
+}
+
+int ComputeSimulationBackend::numAnts() const
+{
+	return _numAnts;
+}
+
+const BrickedWorld& ComputeSimulationBackend::world() const
+{
+	return _world;
+}
+
+unsigned int ComputeSimulationBackend::worldTrailTextureId() const
+{
+	return _worldTrailTextureId;
+}
+
+unsigned int ComputeSimulationBackend::worldFoodTextureId() const
+{
+	return _worldFoodTextureId;
+}
+
+unsigned int ComputeSimulationBackend::worldTerrainTextureId() const
+{
+	return _worldTerrainTextureId;
+}
+
+unsigned int ComputeSimulationBackend::worldPageTextureId() const
+{
+	return _worldPageTextureId;
+}
+
+void ComputeSimulationBackend::restart(const SimulationParameters& parameters)
+{
+	_seed = parameters.seed;
+	_tick = 0;
+
+	_population.reset(parameters.numAnts);
+	_numAnts = parameters.numAnts;
+
+	_world.reset(parameters.worldSize, false);
+
+	glm::ivec3 atlasSize = _world.atlasSize();
+
+	Utils::updateTextureSize(_worldTrailTextureId, atlasSize, WORLD_TRAIL_TEXTURE_FORMAT);
+	Utils::updateTextureSize(_worldFoodTextureId, atlasSize, WORLD_FOOD_TEXTURE_FORMAT);
+	Utils::updateTextureSize(_worldTerrainTextureId, atlasSize, WORLD_TERRAIN_TEXTURE_FORMAT);
+
+	Utils::updateTextureSize(_antCountVolume.textureId, atlasSize, ANT_COUNT_TEXTURE_FORMAT);
+	_antCountVolume.volumeSize = atlasSize;
+
+	Utils::updateTextureSize(_nearbyAntCountVolume.textureId, atlasSize, ANT_COUNT_TEXTURE_FORMAT);
+	_nearbyAntCountVolume.volumeSize = atlasSize;
+
+	Utils::updatePageTextureSize(_worldPageTextureId, _world.pageTableSize());
+
+	// the counts are only cleared where the ants were, so start from all-zero textures
+	GLuint zero[4] = { 0, 0, 0, 0 };
+	glBindFramebuffer(GL_FRAMEBUFFER, _antCountVolume.fboId);
+	glClearBufferuiv(GL_COLOR, 0, zero);
+	glBindFramebuffer(GL_FRAMEBUFFER, _nearbyAntCountVolume.fboId);
+	glClearBufferuiv(GL_COLOR, 0, zero);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	// start with room for just the initial ants, reserveAntBuffer() grows the buffers when more are spawned
+	for (int i = 0; i < 2; i++) {
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, _antBufferIds[i]);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, glm::max(_numAnts, 1) * sizeof(glm::ivec4), 0, GL_DYNAMIC_COPY);
+		_antBufferCapacity[i] = glm::max(_numAnts, 1);
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	// requests still on the way are for the previous world
+	if (_brickRequestFence != 0) {
+		glDeleteSync(_brickRequestFence);
+		_brickRequestFence = 0;
+	}
+
+	_numBrickRequestWords = _world.numBrickRequestWords();
+
+	std::vector<GLuint> noRequests(_numBrickRequestWords, 0);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, _brickRequestBufferId);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, _numBrickRequestWords * sizeof(GLuint), &noRequests[0], GL_DYNAMIC_COPY);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, _brickRequestReadbackBufferId);
+	glBufferData(GL_COPY_WRITE_BUFFER, _numBrickRequestWords * sizeof(GLuint), 0, GL_STREAM_READ);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	initWorld(parameters);
+
+	// with no ants before it, the first pass through the ant shader runs init() for every ant; they are counted
+	// into the world on the first tick, after they have moved
+	_numPreviousAnts = 0;
+
+	updateAnts(parameters, false);
+}
+
+void ComputeSimulationBackend::step(const SimulationParameters& parameters)
+{
+	_numPreviousAnts = _numAnts;
+	_population.beginTick(parameters, _tick);
+	_numAnts = _population.numAnts();
+
+	if (_tick > 0 && _tick % WORLD_CELL_RESTAMP_INTERVAL == 0) {
+		restampWorld(parameters);
+	}
+
+	// the ants move and deposit in one pass, so the bricks they can reach have to be resident before it
+	updateResidentBricks(parameters);
+	updateAnts(parameters, true);
+
+	updateTouchedWorld(parameters);
+
+	_tick++;
+}
+
+void ComputeSimulationBackend::initWorld(const SimulationParameters& parameters) {
+	GLuint worldTrailTextureId = _worldTrailTextureId;
+	GLuint worldFoodTextureId = _worldFoodTextureId;
+	GLuint worldTerrainTextureId = _worldTerrainTextureId;
+	const BrickedWorld& world = _world;
+
+	_world.initialize(parameters, [&](int slot, const WorldCell* cells) {
+		Utils::uploadBrick(worldTrailTextureId, worldFoodTextureId, worldTerrainTextureId, world.atlasBrickCoord(slot), cells);
+	});
+
+	Utils::uploadPageTable(_worldPageTextureId, _world.pageTableSize(), _world.pageTable());
+}
+
+// the stamps only hold 16 bits, so every WORLD_CELL_RESTAMP_INTERVAL ticks the cells that have gone that long untouched
+// are restamped (see restampWorldCell), in place, with the same one workgroup per resident slot as updateTouchedWorld
+void ComputeSimulationBackend::restampWorld(const SimulationParameters& parameters) {
+	int numSlotsInUse = _world.numSlotsInUse();
+	if (numSlotsInUse == 0) {
+		return;
+	}
+
+	glm::ivec3 atlasSizeInBricks = _world.atlasSizeInBricks();
+
+	glUseProgram(_restampProgramId);
+
+	glUniform1f(glGetUniformLocation(_restampProgramId, "trailDissipationPerFrame"), parameters.trailDissipationPerFrame);
+	glUniform1ui(glGetUniformLocation(_restampProgramId, "worldTick"), _tick);
+	glUniform3i(glGetUniformLocation(_restampProgramId, "worldAtlasSizeInBricks"), atlasSizeInBricks.x, atlasSizeInBricks.y, atlasSizeInBricks.z);
+	glUniform1i(glGetUniformLocation(_restampProgramId, "numSlotsInUse"), numSlotsInUse);
+
+	glBindImageTexture(WORLD_TRAIL_IMAGE_UNIT, _worldTrailTextureId, 0, GL_TRUE, 0, GL_READ_WRITE, WORLD_TRAIL_TEXTURE_FORMAT);
+
+	int bricksPerLayer = atlasSizeInBricks.x * atlasSizeInBricks.y;
+	glDispatchCompute(atlasSizeInBricks.x, atlasSizeInBricks.y, (numSlotsInUse + bricksPerLayer - 1) / bricksPerLayer);
+
+	// the ant pass fetches from the trail texture, new bricks are cleared with glTexSubImage3D right after this, and the
+	// world pass writes it as an image
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+	glUseProgram(0);
+}
+
+// like FragmentSimulationBackend::updateResidentBricks, except that it runs before the ants move: the last ant pass
+// requested the bricks within two voxels of every ant (an ant moves at most one voxel and then deposits into the 26
+// voxels around it), which also pins the bricks those ants stepped into, including the ones about to retire; and the
+// nest's neighbourhood is made resident if ants are spawned there
+void ComputeSimulationBackend::updateResidentBricks(const SimulationParameters& parameters) {
+	if (_tick % BRICK_RELEASE_INTERVAL == 0) {
+		_world.releaseFadedBricks(_tick, parameters.trailDissipationPerFrame);
+	}
+
+	if (_brickRequestFence != 0) {
+		Utils::waitForFence(_brickRequestFence);
+		_brickRequestFence = 0;
+
+		glBindBuffer(GL_COPY_READ_BUFFER, _brickRequestReadbackBufferId);
+		const GLuint* requests = (const GLuint*)glMapBufferRange(GL_COPY_READ_BUFFER, 0, _numBrickRequestWords * sizeof(GLuint), GL_MAP_READ_BIT);
+		for (int word = 0; word < _numBrickRequestWords; word++) {
+			if (requests[word] != 0) {
+				_world.touchRequestedBricks(word * BRICK_REQUESTS_PER_WORD, requests[word], _tick);
+			}
+		}
+		glUnmapBuffer(GL_COPY_READ_BUFFER);
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	}
+
+	if (_population.numSpawnedAnts() > 0) {
+		_world.touchNeighborhood(_world.worldSize() / 2, _tick);
+	}
+
+	// slots can be handed out again, so clear whatever trail, food and nest the previous brick left in them
+	static const WorldCell emptyCell = { 0, 0, 0, 0 };
+	static const std::vector<WorldCell> emptyBrickCells(WORLD_BRICK_VOXELS, emptyCell);
+
+	const std::vector<int>& allocatedSlots = _world.allocatedSlots();
+	for (size_t i = 0; i < allocatedSlots.size(); i++) {
+		Utils::uploadBrick(_worldTrailTextureId, _worldFoodTextureId, _worldTerrainTextureId, _world.atlasBrickCoord(allocatedSlots[i]), &emptyBrickCells[0]);
+	}
+
+	const std::vector<int>& changedBricks = _world.changedBricks();
+	for (size_t i = 0; i < changedBricks.size(); i++) {
+		Utils::uploadPageTableEntry(_worldPageTextureId, _world.pageTableCoord(changedBricks[i]), _world.pageTable()[changedBricks[i]]);
+	}
+
+	_world.clearChanges();
+}
+
+void ComputeSimulationBackend::setWorldLayoutUniforms(GLuint programId) {
+	glm::ivec3 atlasSizeInBricks = _world.atlasSizeInBricks();
+
+	glUniform1i(glGetUniformLocation(programId, "worldPageTexture"), 4);	// set to GL_TEXTURE4
+	glUniform3i(glGetUniformLocation(programId, "worldAtlasSizeInBricks"), atlasSizeInBricks.x, atlasSizeInBricks.y, atlasSizeInBricks.z);
+	glUniform1ui(glGetUniformLocation(programId, "numAnts"), (GLuint)_numAnts);
+}
+
+// the ant pass writes the buffer after the current one, which has to hold all the live ants; it doubles when it runs
+// out, so a growing colony reallocates now and then instead of every tick
+void ComputeSimulationBackend::reserveAntBuffer() {
+	int antBuffer = 1 - _currentAntBuffer;
+	if (_antBufferCapacity[antBuffer] >= _numAnts) {
+		return;
+	}
+
+	_antBufferCapacity[antBuffer] = glm::min(glm::max(_numAnts, 2 * _antBufferCapacity[antBuffer]), MAX_NUM_ANTS);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, _antBufferIds[antBuffer]);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, _antBufferCapacity[antBuffer] * sizeof(glm::ivec4), 0, GL_DYNAMIC_COPY);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void ComputeSimulationBackend::updateAnts(const SimulationParameters& parameters, bool depositAnts) {
+	glm::ivec3 worldSize = _world.worldSize();
+
+	reserveAntBuffer();
+
+	glUseProgram(_antProgramId);
+
+	setWorldLayoutUniforms(_antProgramId);
+	glUniform1ui(glGetUniformLocation(_antProgramId, "randomSeed"), _seed);
+	glUniform3i(glGetUniformLocation(_antProgramId, "worldSize"), worldSize.x, worldSize.y, worldSize.z);
+	glUniform1f(glGetUniformLocation(_antProgramId, "trailDissipationPerFrame"), parameters.trailDissipationPerFrame);
+	glUniform1f(glGetUniformLocation(_antProgramId, "freeWillThreshold"), 1.0f - parameters.randomMovementProbability);	// same float as the CPU backend compares against
+	glUniform1f(glGetUniformLocation(_antProgramId, "foodNestScoreMultiplier"), parameters.foodNestScoreMultiplier);
+	glUniform1f(glGetUniformLocation(_antProgramId, "trailScoreMultiplier"), parameters.trailScoreMultiplier);
+	glUniform1f(glGetUniformLocation(_antProgramId, "crowdingScoreMultiplier"), parameters.crowdingScoreMultiplier);
+	glUniform1ui(glGetUniformLocation(_antProgramId, "worldTick"), _tick);
+	glUniform1ui(glGetUniformLocation(_antProgramId, "numPreviousAnts"), (GLuint)_numPreviousAnts);
+	glUniform1ui(glGetUniformLocation(_antProgramId, "numRetiredAnts"), (GLuint)_population.numRetiredAnts());
+	glUniform1ui(glGetUniformLocation(_antProgramId, "firstAntId"), _population.firstAntId());
+	glUniform1i(glGetUniformLocation(_antProgramId, "worldTrailTexture"), 0);	// set to GL_TEXTURE0
+	glUniform1i(glGetUniformLocation(_antProgramId, "worldFoodTexture"), 5);	// set to GL_TEXTURE5
+	glUniform1i(glGetUniformLocation(_antProgramId, "worldTerrainTexture"), 6);	// set to GL_TEXTURE6
+	glUniform1i(glGetUniformLocation(_antProgramId, "depositAnts"), depositAnts ? 1 : 0);
+
+	// the ants read the world around them and their previous state, are written to the other buffer, and count
+	// themselves into the count images
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_3D, _worldTrailTextureId);
+
+	glActiveTexture(GL_TEXTURE5);
+	glBindTexture(GL_TEXTURE_3D, _worldFoodTextureId);
+
+	glActiveTexture(GL_TEXTURE6);
+	glBindTexture(GL_TEXTURE_3D, _worldTerrainTextureId);
+
+	glActiveTexture(GL_TEXTURE4);
+	glBindTexture(GL_TEXTURE_3D, _worldPageTextureId);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PREVIOUS_ANTS_BINDING, _antBufferIds[_currentAntBuffer]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ANTS_BINDING, _antBufferIds[1 - _currentAntBuffer]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BRICK_REQUESTS_BINDING, _brickRequestBufferId);
+	glBindBufferBase(GL_UNIFORM_BUFFER, ANT_MOVEMENT_CONES_BINDING, _antMovementConeBufferId);
+
+	glBindImageTexture(ANT_COUNT_IMAGE_UNIT, _antCountVolume.textureId, 0, GL_TRUE, 0, GL_READ_WRITE, ANT_COUNT_TEXTURE_FORMAT);
+	glBindImageTexture(NEARBY_ANT_COUNT_IMAGE_UNIT, _nearbyAntCountVolume.textureId, 0, GL_TRUE, 0, GL_READ_WRITE, ANT_COUNT_TEXTURE_FORMAT);
+
+	if (_numAnts > 0) {
+		glDispatchCompute((_numAnts + ANT_WORKGROUP_SIZE - 1) / ANT_WORKGROUP_SIZE, 1, 1);
+	}
+
+	_currentAntBuffer = 1 - _currentAntBuffer;
+
+	// the next ant pass reads the ants from the buffer, the requests are copied out, the world pass reads the counts
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+	glUseProgram(0);
+
+	readBackBrickRequests();
+}
+
+// copies the requests of the ant pass out and clears them for the next one; the next updateResidentBricks() waits for
+// the copy, by when the world pass after it has long been queued
+void ComputeSimulationBackend::readBackBrickRequests() {
+	glBindBuffer(GL_COPY_READ_BUFFER, _brickRequestBufferId);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, _brickRequestReadbackBufferId);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, _numBrickRequestWords * sizeof(GLuint));
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	GLuint noRequests = 0;
+	glClearBufferData(GL_COPY_READ_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &noRequests);
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+	_brickRequestFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void ComputeSimulationBackend::updateTouchedWorld(const SimulationParameters& parameters) {
+	glm::ivec3 atlasSizeInBricks = _world.atlasSizeInBricks();
+	int numSlotsInUse = _world.numSlotsInUse();
+	if (numSlotsInUse == 0) {
+		return;
+	}
+
+	glUseProgram(_worldProgramId);
+
+	glUniform1f(glGetUniformLocation(_worldProgramId, "trailDissipationPerFrame"), parameters.trailDissipationPerFrame);
+	glUniform1f(glGetUniformLocation(_worldProgramId, "foodPickupRate"), parameters.foodPickupRate);
+	glUniform1ui(glGetUniformLocation(_worldProgramId, "worldTick"), _tick);
+	glUniform3i(glGetUniformLocation(_worldProgramId, "worldAtlasSizeInBricks"), atlasSizeInBricks.x, atlasSizeInBricks.y, atlasSizeInBricks.z);
+	glUniform1i(glGetUniformLocation(_worldProgramId, "numSlotsInUse"), numSlotsInUse);
+
+	glBindImageTexture(WORLD_TRAIL_IMAGE_UNIT, _worldTrailTextureId, 0, GL_TRUE, 0, GL_READ_WRITE, WORLD_TRAIL_TEXTURE_FORMAT);
+	glBindImageTexture(WORLD_FOOD_IMAGE_UNIT, _worldFoodTextureId, 0, GL_TRUE, 0, GL_READ_WRITE, WORLD_FOOD_TEXTURE_FORMAT);
+	glBindImageTexture(ANT_COUNT_IMAGE_UNIT, _antCountVolume.textureId, 0, GL_TRUE, 0, GL_READ_WRITE, ANT_COUNT_TEXTURE_FORMAT);
+	glBindImageTexture(NEARBY_ANT_COUNT_IMAGE_UNIT, _nearbyAntCountVolume.textureId, 0, GL_TRUE, 0, GL_READ_WRITE, ANT_COUNT_TEXTURE_FORMAT);
+
+	// one workgroup per atlas brick, in slot order, up to the highest slot in use
+	int bricksPerLayer = atlasSizeInBricks.x * atlasSizeInBricks.y;
+	glDispatchCompute(atlasSizeInBricks.x, atlasSizeInBricks.y, (numSlotsInUse + bricksPerLayer - 1) / bricksPerLayer);
+
+	// the next ant pass and the display fetch from the world textures, and new bricks are cleared with glTexSubImage3D
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+	glUseProgram(0);
+}
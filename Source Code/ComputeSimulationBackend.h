@@ -0,0 +1,82 @@
+#pragma once
+
+#define GLEW_STATIC 1
+#include <GL/glew.h>
+#include <GL/glut.h>
+#include <glm/glm.hpp>
+#include "SimulationBackend.h"
+#include "Utils.h"
+#include "BrickedWorld.h"
+#include "AntPopulation.h"
+#include <vector>
+
+// The same simulation as FragmentSimulationBackend with OpenGL 4.3 compute shaders instead of rasterization: the ants
+// live in a pair of shader storage buffers (one ivec4 per ant: voxel and state, live ants in id order; each tick reads
+// one and writes the other, skipping the retired ants and appending the spawned ones) and are moved by one invocation each,
+// which then counts its ant into the neighbourhood with imageAtomicAdd; a second pass runs one 8x8x8 workgroup per
+// resident brick of the atlas and updates, in place with imageStore, the voxels that have ants in or around them: the
+// trail layer of each, and the food layer (see WorldCell.h) only where an ant stands or just left.
+// No framebuffers, geometry shaders or copy-back pass. The host keeps the brick bookkeeping as in the fragment
+// backend, except that the ant pass marks the bricks its ants need in a bitmap with atomicOr, which is copied to a
+// readback buffer behind a fence. Needs a current GL 4.3 context (GLEW_VERSION_4_3); Mesa's llvmpipe provides one.
+class ComputeSimulationBackend : public SimulationBackend
+{
+public:
+	ComputeSimulationBackend();
+
+	virtual void restart(const SimulationParameters& parameters);
+	virtual void step(const SimulationParameters& parameters);
+	virtual const char* name() const;
+	virtual unsigned int tick() const;
+	virtual int numAnts() const;
+
+	virtual const BrickedWorld& world() const;
+
+	virtual unsigned int worldTrailTextureId() const;
+	virtual unsigned int worldFoodTextureId() const;
+	virtual unsigned int worldTerrainTextureId() const;
+	virtual unsigned int worldPageTextureId() const;
+
+private:
+	unsigned int _seed;	// run seed, passed to the ant shader for its random draws
+	unsigned int _tick;	// number of completed ticks; the world texture holds this tick
+
+	int _numAnts;	// live ants, at the start of the current ant buffer
+	int _numPreviousAnts;	// ants in the previous ant buffer, before this tick's retirements and spawns
+
+	AntPopulation _population;
+
+	GLuint _antProgramId;
+	GLuint _worldProgramId;
+	GLuint _restampProgramId;
+
+	void setWorldLayoutUniforms(GLuint programId);
+
+	void initWorld(const SimulationParameters& parameters);
+	void restampWorld(const SimulationParameters& parameters);
+	void reserveAntBuffer();
+	void updateAnts(const SimulationParameters& parameters, bool depositAnts);
+	void updateResidentBricks(const SimulationParameters& parameters);
+	void readBackBrickRequests();
+	void updateTouchedWorld(const SimulationParameters& parameters);
+
+	BrickedWorld _world;	// bookkeeping only, the cells are in the atlas textures
+
+	GLuint _worldTrailTextureId;	// brick atlas of the trail layer of the cells, written with imageStore
+	GLuint _worldFoodTextureId;	// and of their food layer
+	GLuint _worldTerrainTextureId;	// and of their terrain layer, only written by brick uploads
+	Volume _antCountVolume;	// ants in each atlas voxel; zero everywhere between ticks (the FBO is only for clearing)
+	Volume _nearbyAntCountVolume;	// ants in the 26 voxels around each atlas voxel
+
+	GLuint _worldPageTextureId;
+
+	GLuint _antBufferIds[2];	// shader storage buffers of the ants, written in turn
+	int _antBufferCapacity[2];	// in ants; doubled when a growing colony runs out
+	int _currentAntBuffer;	// index of the buffer holding the live ants
+	GLuint _antMovementConeBufferId;	// AntMovementCones uniform block of the ant shader
+
+	GLuint _brickRequestBufferId;	// shader storage buffer the ant pass marks the bricks its ants need in, see BrickedWorld.h
+	GLuint _brickRequestReadbackBufferId;	// the requests of the last ant pass, copied out by the GPU
+	GLsync _brickRequestFence;	// signalled once they are there; 0 if none are on the way
+	int _numBrickRequestWords;
+};
@@ -0,0 +1,619 @@
+#include "CpuSimulationBackend.h"
+#include "Random.h"
+#include "Morton.h"
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+
+static const float THRESHOLD_TO_NOT_CHOOSE_RANDOMLY = 0.9f;
+static const float EXCLUDED_CELL_SCORE = -1000.0f;
+
+static const unsigned int BRICK_RELEASE_INTERVAL = 64;	// ticks between sweeps for bricks whose trails have faded
+
+// first item of chunk of count items split into numChunks nearly equal chunks
+static int chunkStart(int count, int chunk, int numChunks)
+{
+	return (int)((long long)count * chunk / numChunks);
+}
+
+int CpuAnts::size() const
+{
+	return (int)x.size();
+}
+
+void CpuAnts::resize(int numAnts)
+{
+	x.resize(numAnts);
+	y.resize(numAnts);
+	z.resize(numAnts);
+	directionCode.resize(numAnts);
+	hasFood.resize(numAnts);
+	id.resize(numAnts);
+}
+
+glm::ivec3 CpuAnts::position(int ant) const
+{
+	return glm::ivec3(x[ant], y[ant], z[ant]);
+}
+
+void CpuAnts::copyAnt(int ant, const CpuAnts& from, int fromAnt)
+{
+	x[ant] = from.x[fromAnt];
+	y[ant] = from.y[fromAnt];
+	z[ant] = from.z[fromAnt];
+	directionCode[ant] = from.directionCode[fromAnt];
+	hasFood[ant] = from.hasFood[fromAnt];
+	id[ant] = from.id[fromAnt];
+}
+
+CpuSimulationBackend::CpuSimulationBackend(int numThreads, bool allowAvx2) : _threadPool(numThreads), _worldSize(0, 0, 0), _useAvx2(allowAvx2 && antScoringKernelSupported()), _antSortInterval(0), _antDepositsSize(0), _numBrickRequestWords(0), _seed(0), _tick(0)
+{
+	AntSortStatistics noSorts = { 0, 0.0, 0.0, 0.0 };
+	_antSortStatistics = noSorts;
+
+	printf("CPU simulation backend using %d threads, %s ant scoring\n", _threadPool.numThreads(), _useAvx2 ? "AVX2" : "scalar");
+}
+
+const char* CpuSimulationBackend::name() const
+{
+	return "cpu";
+}
+
+const BrickedWorld& CpuSimulationBackend::world() const
+{
+	return _world;
+}
+
+glm::ivec3 CpuSimulationBackend::worldSize() const
+{
+	return _worldSize;
+}
+
+const CpuAnts& CpuSimulationBackend::ants() const
+{
+	return _ants;
+}
+
+unsigned int CpuSimulationBackend::tick() const
+{
+	return _tick;
+}
+
+int CpuSimulationBackend::numAnts() const
+{
+	return _ants.size();
+}
+
+int CpuSimulationBackend::numAntsCarryingFood() const
+{
+	int count = 0;
+	for (int i = 0; i < _ants.size(); i++) {
+		count += _ants.hasFood[i];
+	}
+	return count;
+}
+
+int CpuSimulationBackend::numThreads() const
+{
+	return _threadPool.numThreads();
+}
+
+bool CpuSimulationBackend::usesAvx2() const
+{
+	return _useAvx2;
+}
+
+void CpuSimulationBackend::setAntSortInterval(int ticks)
+{
+	_antSortInterval = ticks;
+}
+
+const AntSortStatistics& CpuSimulationBackend::antSortStatistics() const
+{
+	return _antSortStatistics;
+}
+
+int CpuSimulationBackend::scratchIndex(glm::ivec3 voxel) const
+{
+	int slot = _world.slotOfVoxel(voxel);
+	if (slot < 0) {
+		return -1;	// not resident, or in the halo around the world
+	}
+	return slot * WORLD_BRICK_VOXELS + _world.voxelIndexInBrick(voxel);
+}
+
+// uniform in [0,1), the same draw as random() in simulation_ant_fragment.glsl for this tick
+float CpuSimulationBackend::random(unsigned int stream, unsigned int index, unsigned int draw) const
+{
+	return randomUniform(_seed, stream, _tick, index, draw);
+}
+
+void CpuSimulationBackend::restart(const SimulationParameters& parameters)
+{
+	_seed = parameters.seed;
+	_tick = 0;
+
+	_worldSize = parameters.worldSize;
+
+	_world.reset(_worldSize, true);
+	initWorld(parameters);
+
+	_antDeposits.reset();
+	_antDepositsSize = 0;
+
+	_numBrickRequestWords = _world.numBrickRequestWords();
+	_brickRequests.reset(new std::atomic<unsigned int>[_numBrickRequestWords]);
+	for (int word = 0; word < _numBrickRequestWords; word++) {
+		_brickRequests[word].store(0, std::memory_order_relaxed);
+	}
+
+	_population.reset(parameters.numAnts);
+	_ants.resize(parameters.numAnts);
+
+	AntSortStatistics noSorts = { 0, 0.0, 0.0, 0.0 };
+	_antSortStatistics = noSorts;
+
+	_threadPool.parallelFor(_ants.size(), [&](int begin, int end) {
+		initAnts(begin, end, (unsigned int)begin);
+	});
+}
+
+void CpuSimulationBackend::initWorld(const SimulationParameters& parameters)
+{
+	// the cells go straight into our own pool, nothing to upload
+	_world.initialize(parameters, [](int, const WorldCell*) {});
+}
+
+void CpuSimulationBackend::initAnts(int begin, int end, unsigned int firstAntId)
+{
+	glm::ivec3 centerOfWorld = _worldSize / 2;
+
+	for (int i = begin; i < end; i++) {
+		unsigned int antId = firstAntId + (unsigned int)(i - begin);
+		glm::ivec3 initialAntDirection(
+			randomIntBetween(-1, 1, random(RANDOM_STREAM_ANT_INIT, antId, 0)),
+			randomIntBetween(-1, 1, random(RANDOM_STREAM_ANT_INIT, antId, 1)),
+			randomIntBetween(-1, 1, random(RANDOM_STREAM_ANT_INIT, antId, 2)));
+
+		_ants.x[i] = centerOfWorld.x;
+		_ants.y[i] = centerOfWorld.y;
+		_ants.z[i] = centerOfWorld.z;
+		_ants.directionCode[i] = (unsigned char)antDirectionCode(initialAntDirection);
+		_ants.hasFood[i] = 0;
+		_ants.id[i] = antId;
+	}
+}
+
+// drops the ants older than firstAntId (see AntPopulation.h) with a parallel stream compaction: every chunk of the
+// array counts its live ants, a prefix sum over the chunks gives where each chunk's live ants go, and every chunk then
+// copies its live ants there, in order
+void CpuSimulationBackend::retireAnts(unsigned int firstAntId)
+{
+	int numAnts = _ants.size();
+	int numChunks = _threadPool.numThreads();
+
+	_liveAntsPerChunk.assign(numChunks + 1, 0);
+
+	_threadPool.parallelFor(numChunks, [&](int chunkBegin, int chunkEnd) {
+		for (int chunk = chunkBegin; chunk < chunkEnd; chunk++) {
+			int liveAnts = 0;
+			for (int i = chunkStart(numAnts, chunk, numChunks); i < chunkStart(numAnts, chunk + 1, numChunks); i++) {
+				liveAnts += (_ants.id[i] >= firstAntId) ? 1 : 0;
+			}
+			_liveAntsPerChunk[chunk + 1] = liveAnts;
+		}
+	});
+
+	for (int chunk = 0; chunk < numChunks; chunk++) {
+		_liveAntsPerChunk[chunk + 1] += _liveAntsPerChunk[chunk];
+	}
+
+	_scratchAnts.resize(_liveAntsPerChunk[numChunks]);
+	_threadPool.parallelFor(numChunks, [&](int chunkBegin, int chunkEnd) {
+		for (int chunk = chunkBegin; chunk < chunkEnd; chunk++) {
+			int to = _liveAntsPerChunk[chunk];
+			for (int i = chunkStart(numAnts, chunk, numChunks); i < chunkStart(numAnts, chunk + 1, numChunks); i++) {
+				if (_ants.id[i] >= firstAntId) {
+					_scratchAnts.copyAnt(to++, _ants, i);
+				}
+			}
+		}
+	});
+	std::swap(_ants, _scratchAnts);
+}
+
+// new ants go at the end of the array, at the nest; they first move on the next tick
+void CpuSimulationBackend::spawnAnts(int numSpawnedAnts, unsigned int firstAntId)
+{
+	int firstSpawnedAnt = _ants.size();
+	_ants.resize(firstSpawnedAnt + numSpawnedAnts);
+
+	_threadPool.parallelFor(numSpawnedAnts, [&](int begin, int end) {
+		initAnts(firstSpawnedAnt + begin, firstSpawnedAnt + end, firstAntId + (unsigned int)begin);
+	});
+}
+
+void CpuSimulationBackend::step(const SimulationParameters& parameters)
+{
+	if (_antSortInterval > 0 && _tick > 0 && _tick % _antSortInterval == 0) {
+		sortAnts();
+	}
+
+	// bricks only change hands before the parallel parts of the step. An ant moves at most one voxel and then deposits
+	// into the 26 voxels around it, so everything it writes this tick is within two voxels of where it starts. This
+	// also pins the bricks the ants stepped into last tick, so the ants about to retire are touched as well
+	_world.clearChanges();
+
+	if (_tick > 0 && _tick % WORLD_CELL_RESTAMP_INTERVAL == 0) {
+		_world.restampCells(_tick, parameters.trailDissipationPerFrame);
+	}
+
+	if (_tick % BRICK_RELEASE_INTERVAL == 0) {
+		_world.releaseFadedBricks(_tick, parameters.trailDissipationPerFrame);
+	}
+
+	// the threads mark the bricks of their ants, then only the marked ones are visited, one word of requests at a time
+	_threadPool.parallelFor(_ants.size(), [&](int begin, int end) {
+		for (int a = begin; a < end; a++) {
+			_world.requestNeighborhood(_ants.position(a), 2, _brickRequests.get());
+		}
+	});
+
+	for (int word = 0; word < _numBrickRequestWords; word++) {
+		unsigned int requests = _brickRequests[word].load(std::memory_order_relaxed);
+		if (requests != 0) {
+			_world.touchRequestedBricks(word * BRICK_REQUESTS_PER_WORD, requests, _tick);
+			_brickRequests[word].store(0, std::memory_order_relaxed);
+		}
+	}
+
+	_population.beginTick(parameters, _tick);
+	if (_population.numRetiredAnts() > 0) {
+		retireAnts(_population.firstAntId());
+	}
+
+	int numMovingAnts = _ants.size();
+	if (_population.numSpawnedAnts() > 0) {
+		_world.touchNeighborhood(_worldSize / 2, _tick);
+		spawnAnts(_population.numSpawnedAnts(), _population.nextAntId() - (unsigned int)_population.numSpawnedAnts());
+	}
+
+	reserveAntDeposits();
+
+	// same order as FragmentSimulationBackend::step(): the ants read the world from the previous tick, then the world
+	// is updated from the new ant positions; but each ant deposits as soon as it has moved, while it is still in cache,
+	// and only the voxels it deposited into are visited afterwards. The spawned ants don't move on their first tick
+	int numAnts = _ants.size();
+	int numChunks = _threadPool.numThreads();
+	_touchedVoxels.resize(numChunks);
+
+	_threadPool.parallelFor(numChunks, [&](int chunkBegin, int chunkEnd) {
+		for (int chunk = chunkBegin; chunk < chunkEnd; chunk++) {
+			int begin = chunkStart(numAnts, chunk, numChunks);
+			int end = chunkStart(numAnts, chunk + 1, numChunks);
+
+			moveAnts(parameters, begin, glm::min(end, numMovingAnts), &_touchedVoxels[chunk]);
+			for (int i = glm::max(begin, numMovingAnts); i < end; i++) {
+				depositAnt(_ants.position(i), &_touchedVoxels[chunk]);
+			}
+		}
+	});
+
+	_threadPool.parallelFor(numChunks, [&](int chunkBegin, int chunkEnd) {
+		for (int chunk = chunkBegin; chunk < chunkEnd; chunk++) {
+			updateTouchedVoxels(parameters, &_touchedVoxels[chunk]);
+		}
+	});
+
+	_tick++;
+}
+
+// LSD radix sort of the ants by the Morton code of their voxel, 8 bits per pass and only as many passes as the
+// world needs; the ants keep their ids, so their random draws and the world don't change
+void CpuSimulationBackend::sortAnts()
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	int numAnts = _ants.size();
+	double bricksPerBatchBeforeSort = bricksPerAntBatch();
+
+	_antSortKeys.resize(numAnts);
+	_antSortKeysScratch.resize(numAnts);
+	_antSortOrder.resize(numAnts);
+	_antSortOrderScratch.resize(numAnts);
+
+	// ants can stand one voxel past either edge, and Morton codes have 10 bits per axis
+	glm::ivec3 maxVoxel = glm::min(_worldSize + 1, glm::ivec3(1023, 1023, 1023));
+	unsigned int maxKey = mortonEncode(maxVoxel);
+
+	_threadPool.parallelFor(numAnts, [&](int begin, int end) {
+		for (int i = begin; i < end; i++) {
+			_antSortKeys[i] = mortonEncode(glm::min(_ants.position(i) + 1, maxVoxel));
+			_antSortOrder[i] = i;
+		}
+	});
+
+	for (int shift = 0; shift < 32 && (maxKey >> shift) != 0; shift += 8) {
+		int bucketStart[256] = { 0 };
+		for (int i = 0; i < numAnts; i++) {
+			bucketStart[(_antSortKeys[i] >> shift) & 0xff]++;
+		}
+		int total = 0;
+		for (int bucket = 0; bucket < 256; bucket++) {
+			int count = bucketStart[bucket];
+			bucketStart[bucket] = total;
+			total += count;
+		}
+		for (int i = 0; i < numAnts; i++) {
+			int destination = bucketStart[(_antSortKeys[i] >> shift) & 0xff]++;
+			_antSortKeysScratch[destination] = _antSortKeys[i];
+			_antSortOrderScratch[destination] = _antSortOrder[i];
+		}
+		_antSortKeys.swap(_antSortKeysScratch);
+		_antSortOrder.swap(_antSortOrderScratch);
+	}
+
+	_scratchAnts.resize(numAnts);
+	_threadPool.parallelFor(numAnts, [&](int begin, int end) {
+		for (int i = begin; i < end; i++) {
+			_scratchAnts.copyAnt(i, _ants, _antSortOrder[i]);
+		}
+	});
+	std::swap(_ants, _scratchAnts);
+
+	AntSortStatistics& statistics = _antSortStatistics;
+	statistics.bricksPerBatchBeforeSort = (statistics.bricksPerBatchBeforeSort * statistics.numSorts + bricksPerBatchBeforeSort) / (statistics.numSorts + 1);
+	statistics.bricksPerBatchAfterSort = (statistics.bricksPerBatchAfterSort * statistics.numSorts + bricksPerAntBatch()) / (statistics.numSorts + 1);
+	statistics.numSorts++;
+	statistics.sortMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+double CpuSimulationBackend::bricksPerAntBatch() const
+{
+	int numAnts = _ants.size();
+	if (numAnts == 0) {
+		return 0.0;
+	}
+
+	int totalBricks = 0;
+	for (int batchBegin = 0; batchBegin < numAnts; batchBegin += ANT_SCORING_LANES) {
+		int batchEnd = glm::min(batchBegin + ANT_SCORING_LANES, numAnts);
+		for (int i = batchBegin; i < batchEnd; i++) {
+			glm::ivec3 brick = (_ants.position(i) + WORLD_BRICK_SIZE) / WORLD_BRICK_SIZE;	// as in the page table, so the halo counts too
+			bool seenInBatch = false;
+			for (int j = batchBegin; j < i && !seenInBatch; j++) {
+				seenInBatch = ((_ants.position(j) + WORLD_BRICK_SIZE) / WORLD_BRICK_SIZE == brick);
+			}
+			totalBricks += seenInBatch ? 0 : 1;
+		}
+	}
+
+	return (double)totalBricks / ((numAnts + ANT_SCORING_LANES - 1) / ANT_SCORING_LANES);
+}
+
+void CpuSimulationBackend::moveAnts(const SimulationParameters& parameters, int begin, int end, std::vector<int>* touchedVoxels)
+{
+	AntScoringInput scoringInput;
+	scoringInput.pageTable = _world.pageTable();
+	scoringInput.pageTableSize = _world.pageTableSize();
+	scoringInput.cells = _world.poolCells();
+	scoringInput.voxelIndexInBrick = _world.voxelIndexInBrickTable();
+	scoringInput.tick = _tick;
+	scoringInput.trailDissipationPerFrame = parameters.trailDissipationPerFrame;
+	scoringInput.trailScoreMultiplier = parameters.trailScoreMultiplier;
+	scoringInput.crowdingScoreMultiplier = parameters.crowdingScoreMultiplier;
+	scoringInput.foodNestScoreMultiplier = parameters.foodNestScoreMultiplier;
+
+	for (int batchBegin = begin; batchBegin < end; batchBegin += ANT_SCORING_LANES) {
+		int batchSize = glm::min(ANT_SCORING_LANES, end - batchBegin);
+
+		int coneDirectionCode[ANT_SCORING_LANES];
+		bool hasFoodAfterTurn[ANT_SCORING_LANES];
+		float highestScore[ANT_SCORING_LANES];
+		int bestStepDirectionCode[ANT_SCORING_LANES];
+
+		for (int lane = 0; lane < batchSize; lane++) {
+			turnAnt(batchBegin + lane, &coneDirectionCode[lane], &hasFoodAfterTurn[lane]);
+		}
+
+		// like the shader, the scoring uses the has-food flag from before this tick's pickup/drop-off
+		if (_useAvx2 && batchSize == ANT_SCORING_LANES) {
+			scoreAntConesAvx2(scoringInput, &_ants.x[batchBegin], &_ants.y[batchBegin], &_ants.z[batchBegin], &_ants.hasFood[batchBegin],
+				coneDirectionCode, highestScore, bestStepDirectionCode);
+		} else {
+			for (int lane = 0; lane < batchSize; lane++) {
+				int i = batchBegin + lane;
+				scoreAntCone(parameters, _ants.position(i), _ants.hasFood[i] != 0, coneDirectionCode[lane], &highestScore[lane], &bestStepDirectionCode[lane]);
+			}
+		}
+
+		for (int lane = 0; lane < batchSize; lane++) {
+			int i = batchBegin + lane;
+			glm::ivec3 displacement = chooseDisplacement(parameters, i, coneDirectionCode[lane], highestScore[lane], bestStepDirectionCode[lane]);
+
+			_ants.x[i] += displacement.x;
+			_ants.y[i] += displacement.y;
+			_ants.z[i] += displacement.z;
+			_ants.directionCode[i] = (unsigned char)antDirectionCode(displacement);
+			_ants.hasFood[i] = hasFoodAfterTurn[lane] ? 1 : 0;
+
+			depositAnt(_ants.position(i), touchedVoxels);
+		}
+	}
+}
+
+// a random step can still take an ant one voxel into the halo; along every axis where its next step would leave the
+// world, it heads back in. Selects instead of branches, so this is the same few instructions for every ant
+glm::ivec3 CpuSimulationBackend::handleEdgeBoundaries(const glm::ivec3& initialAntDirection, const glm::ivec3& antPositionInWorld) const
+{
+	glm::ivec3 nextPosition = antPositionInWorld + initialAntDirection;
+	glm::ivec3 below(glm::lessThan(nextPosition, glm::ivec3(0, 0, 0)));
+	glm::ivec3 above(glm::greaterThan(nextPosition, _worldSize - 1));
+
+	return initialAntDirection + below * (1 - initialAntDirection) + above * (-1 - initialAntDirection);
+}
+
+void CpuSimulationBackend::turnAnt(int antIndex, int* coneDirectionCode, bool* hasFoodAfterTurn) const
+{
+	glm::ivec3 position = _ants.position(antIndex);
+	bool hasFood = _ants.hasFood[antIndex] != 0;
+	int directionCode = _ants.directionCode[antIndex];
+	glm::ivec3 antDirection = antDirectionStep(directionCode);
+
+	// get the state of the world where the ant is
+	const WorldCell& worldCell = _world.cell(position);
+
+	glm::ivec3 antDirectionAfterEdgeHandling = handleEdgeBoundaries(antDirection, position);
+
+	if (antDirectionAfterEdgeHandling != antDirection) {
+		directionCode = antDirectionCode(antDirectionAfterEdgeHandling);
+	} else if (worldCellHasNest(worldCell) && hasFood) {
+		// drop any food that is carried, and turn around
+		hasFood = false;
+		directionCode = reverseAntDirectionCode(directionCode);
+	} else if (worldCellFood(worldCell) > 0.0f && !hasFood) {
+		// pick up some food here, and turn around
+		hasFood = true;
+		directionCode = reverseAntDirectionCode(directionCode);
+	}
+
+	*coneDirectionCode = directionCode;
+	*hasFoodAfterTurn = hasFood;
+}
+
+// the scalar version of scoreAntConesAvx2, for CPUs without AVX2 and the ants left over after the full batches
+void CpuSimulationBackend::scoreAntCone(const SimulationParameters& parameters, glm::ivec3 position, bool hasFood, int coneDirectionCode, float* highestScore, int* bestStepDirectionCode) const
+{
+	const AntMovementCone& cone = antMovementCone(coneDirectionCode);
+
+	*highestScore = 0.0f;
+	*bestStepDirectionCode = ANT_DIRECTION_NONE;
+
+	// go through each possible cell in front of the ant and see which one has the strongest trail
+	for (int s = 0; s < cone.numSteps; s++) {
+		// no bounds checks: past the edge of the world this reads the wall cells of the halo
+		const WorldCell& worldCell = _world.cell(position + cone.steps[s]);
+
+		float trailScoreAtThisCell = worldCellTrailStrength(worldCell, _tick, parameters.trailDissipationPerFrame) * parameters.trailScoreMultiplier;
+		float foodScoreAtThisCell = worldCellFood(worldCell) * parameters.foodNestScoreMultiplier;
+		float nestScoreAtThisCell = (worldCellHasNest(worldCell) ? 1.0f : 0.0f) * parameters.foodNestScoreMultiplier;
+		float crowdingScoreAtThisCell = (float)worldCellAnts(worldCell, _tick) * parameters.crowdingScoreMultiplier;
+
+		if (foodScoreAtThisCell > 0.0f && hasFood) {
+			// we don't want to go to a cell that has food if we already have food
+			foodScoreAtThisCell = EXCLUDED_CELL_SCORE;
+		}
+
+		if (nestScoreAtThisCell > 0.0f && !hasFood) {
+			// we don't want to go to a cell that has the nest when we are empty-handed
+			nestScoreAtThisCell = EXCLUDED_CELL_SCORE;
+		}
+
+		float totalScoreAtThisCell = trailScoreAtThisCell + foodScoreAtThisCell + nestScoreAtThisCell - crowdingScoreAtThisCell;
+
+		if (worldCellIsWall(worldCell)) {
+			totalScoreAtThisCell = EXCLUDED_CELL_SCORE;	// never follow a trail out of the world
+		}
+
+		if (*highestScore < totalScoreAtThisCell) {
+			*highestScore = totalScoreAtThisCell;
+			*bestStepDirectionCode = antDirectionCode(cone.steps[s]);
+		}
+	}
+}
+
+glm::ivec3 CpuSimulationBackend::chooseDisplacement(const SimulationParameters& parameters, int antIndex, int coneDirectionCode, float highestScore, int bestStepDirectionCode) const
+{
+	unsigned int antId = _ants.id[antIndex];
+	float strengthOfFreeWill = random(RANDOM_STREAM_ANT_MOVE, antId, 0);
+
+	if (highestScore <= THRESHOLD_TO_NOT_CHOOSE_RANDOMLY || strengthOfFreeWill >= 1.0f - parameters.randomMovementProbability) {
+		// no strong trail in front, just return some random displacement
+		const AntMovementCone& cone = antMovementCone(coneDirectionCode);
+		return glm::ivec3(
+			randomIntBetween(cone.minCorner.x, cone.maxCorner.x, random(RANDOM_STREAM_ANT_MOVE, antId, 1)),
+			randomIntBetween(cone.minCorner.y, cone.maxCorner.y, random(RANDOM_STREAM_ANT_MOVE, antId, 2)),
+			randomIntBetween(cone.minCorner.z, cone.maxCorner.z, random(RANDOM_STREAM_ANT_MOVE, antId, 3)));
+	}
+
+	return antDirectionStep(bestStepDirectionCode);
+}
+
+// the scratch only has to cover the slots handed out so far; it is all zero between steps, so a bigger one can start
+// over. It doubles when it runs out, so a growing world reallocates now and then instead of every few ticks
+void CpuSimulationBackend::reserveAntDeposits()
+{
+	size_t scratchSize = (size_t)_world.numSlotsInUse() * WORLD_BRICK_VOXELS;
+	if (_antDepositsSize >= scratchSize) {
+		return;
+	}
+
+	_antDepositsSize = glm::max(scratchSize, 2 * _antDepositsSize);
+	_antDeposits.reset(new std::atomic<unsigned long long>[_antDepositsSize]);
+
+	_threadPool.parallelFor((int)_antDepositsSize, [&](int begin, int end) {
+		for (int i = begin; i < end; i++) {
+			_antDeposits[i].store(0, std::memory_order_relaxed);
+		}
+	});
+}
+
+// counts an ant into its own voxel and the 26 around it (distance < 1 and distance < 2 in the shader); ants of other
+// threads can deposit into the same voxels, hence the atomic adds. The parts of the neighbourhood that are outside the
+// world land in the halo, which has no slot
+void CpuSimulationBackend::depositAnt(glm::ivec3 position, std::vector<int>* touchedVoxels)
+{
+	for (int dz = -1; dz <= 1; dz++) {
+		for (int dy = -1; dy <= 1; dy++) {
+			for (int dx = -1; dx <= 1; dx++) {
+				int index = scratchIndex(position + glm::ivec3(dx, dy, dz));
+				if (index < 0) {
+					continue;	// the halo around the world, or the brick pool is full
+				}
+
+				unsigned long long deposit = (dx == 0 && dy == 0 && dz == 0) ? 1ull : (1ull << 32);
+				if (_antDeposits[index].fetch_add(deposit, std::memory_order_relaxed) == 0) {
+					touchedVoxels->push_back(index);	// the first deposit this tick
+				}
+			}
+		}
+	}
+}
+
+// commits the deposits of the voxels in touchedVoxels to the world and clears them, so the scratch is all zero between
+// ticks; every other voxel keeps decaying lazily from its stamp
+void CpuSimulationBackend::updateTouchedVoxels(const SimulationParameters& parameters, std::vector<int>* touchedVoxels)
+{
+	for (size_t i = 0; i < touchedVoxels->size(); i++) {
+		int index = (*touchedVoxels)[i];
+
+		unsigned long long deposit = _antDeposits[index].load(std::memory_order_relaxed);
+		_antDeposits[index].store(0, std::memory_order_relaxed);
+
+		unsigned int antCount = (unsigned int)(deposit & 0xFFFFFFFFull);
+		unsigned int nearbyAntCount = (unsigned int)(deposit >> 32);
+
+		WorldCell& worldCell = _world.brickCells(index / WORLD_BRICK_VOXELS)[index % WORLD_BRICK_VOXELS];
+
+		float trailStrength = worldCellTrailStrength(worldCell, _tick, parameters.trailDissipationPerFrame);
+
+		if (antCount > 0) {
+			// ant is right on this location
+			trailStrength = 1.0f;	// turn trail up to full strength
+
+			// the food layer only changes where an ant stands
+			packFoodLayer(&worldCell, worldCellFood(worldCell) - parameters.foodPickupRate);	// assume ant has picked up some food
+		} else {
+			// each nearby ant adds 0.1, clamped to [0,1] after every addition (same closed form as the world shader)
+			trailStrength = glm::min(glm::max(trailStrength + 0.1f, 0.0f) + 0.1f * (nearbyAntCount - 1), 1.0f);
+
+			// dissipate trail for this tick right away, as it would have been for an untouched cell
+			trailStrength = glm::max(trailStrength - parameters.trailDissipationPerFrame, 0.0f);
+		}
+
+		// the new stamp drops the count of a voxel an ant just left along with the rest of its trail layer
+		packTrailLayer(&worldCell, trailStrength, antCount, _tick + 1);	// saturates the count
+	}
+
+	touchedVoxels->clear();
+}
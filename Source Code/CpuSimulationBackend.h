@@ -0,0 +1,138 @@
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <glm/glm.hpp>
+#include "SimulationBackend.h"
+#include "ThreadPool.h"
+#include "BrickedWorld.h"
+#include "AntDirection.h"
+#include "AntScoringKernel.h"
+#include "AntPopulation.h"
+
+// host-side equivalent of the ant texture, as a structure of arrays so that a field of ANT_SCORING_LANES consecutive
+// ants loads as one vector (see AntScoringKernel.h)
+struct CpuAnts {
+	std::vector<int> x;	// voxel the ant is in, in values [-1,0,1,...,N] (ants can step one voxel past the edge, like in the shader)
+	std::vector<int> y;
+	std::vector<int> z;
+	std::vector<unsigned char> directionCode;	// see AntDirection.h
+	std::vector<unsigned char> hasFood;
+	std::vector<unsigned int> id;	// see AntPopulation.h; keys the ant's random draws, so it follows the ant through sorts and compaction
+
+	int size() const;
+	void resize(int numAnts);
+	glm::ivec3 position(int ant) const;
+	void copyAnt(int ant, const CpuAnts& from, int fromAnt);	// every field
+};
+
+// how much sorting the ants by Morton code helped: the number of distinct bricks the ants of a batch of
+// ANT_SCORING_LANES stand in (1 = all in the same brick, ANT_SCORING_LANES = all in different bricks), averaged over
+// the batches and over the sorts
+struct AntSortStatistics {
+	int numSorts;
+	double bricksPerBatchBeforeSort;
+	double bricksPerBatchAfterSort;
+	double sortMilliseconds;	// total
+};
+
+// Runs the same world and ant rules as simulation_world_fragment.glsl and simulation_ant_fragment.glsl,
+// without a GL context. A tick is one pass over the ants, split into a contiguous range per thread, in which every ant
+// moves (reading the world as it was at the start of the tick) and then deposits itself into a per-voxel scratch,
+// followed by a pass over just the voxels that got deposits, which commits them to the world. The world is never
+// written while ants read it, so the ants can be moved in any order; the bricks within reach of the ants are
+// allocated before either pass, after the threads have marked them for their own ants.
+// The ants move in batches of ANT_SCORING_LANES, whose cones are scored together by the AVX2 kernel if the CPU has it.
+class CpuSimulationBackend : public SimulationBackend
+{
+public:
+	CpuSimulationBackend(int numThreads = 0, bool allowAvx2 = true);	// 0 = one thread per hardware core
+
+	virtual void restart(const SimulationParameters& parameters);
+	virtual void step(const SimulationParameters& parameters);
+	virtual const char* name() const;
+
+	virtual unsigned int tick() const;
+	virtual int numAnts() const;
+
+	virtual const BrickedWorld& world() const;
+
+	glm::ivec3 worldSize() const;
+	const CpuAnts& ants() const;
+	int numAntsCarryingFood() const;
+	int numThreads() const;
+	bool usesAvx2() const;
+
+	// every this many ticks, radix-sort the ants by the Morton code of their voxel, so that ants next to each other
+	// in the arrays read the same bricks; 0 (the default) never sorts. Doesn't change the simulation, only its speed
+	void setAntSortInterval(int ticks);
+	const AntSortStatistics& antSortStatistics() const;
+
+private:
+	void initWorld(const SimulationParameters& parameters);
+	void initAnts(int begin, int end, unsigned int firstAntId);	// ants begin to end - 1 get consecutive ids from firstAntId
+	void retireAnts(unsigned int firstAntId);
+	void spawnAnts(int numSpawnedAnts, unsigned int firstAntId);
+
+	void reserveAntDeposits();
+	void moveAnts(const SimulationParameters& parameters, int begin, int end, std::vector<int>* touchedVoxels);
+	void depositAnt(glm::ivec3 position, std::vector<int>* touchedVoxels);
+	void updateTouchedVoxels(const SimulationParameters& parameters, std::vector<int>* touchedVoxels);
+
+	// the three parts of moving an ant: picking up or dropping food and turning, scoring the cone in front of it,
+	// and choosing the step (the strongest cell, or a random one)
+	void turnAnt(int antIndex, int* coneDirectionCode, bool* hasFoodAfterTurn) const;
+	void scoreAntCone(const SimulationParameters& parameters, glm::ivec3 position, bool hasFood, int coneDirectionCode, float* highestScore, int* bestStepDirectionCode) const;
+	glm::ivec3 chooseDisplacement(const SimulationParameters& parameters, int antIndex, int coneDirectionCode, float highestScore, int bestStepDirectionCode) const;
+	glm::ivec3 handleEdgeBoundaries(const glm::ivec3& initialAntDirection, const glm::ivec3& antPositionInWorld) const;
+
+	int scratchIndex(glm::ivec3 voxel) const;	// index into the per-voxel scratch, -1 if the voxel's brick isn't resident
+
+	float random(unsigned int stream, unsigned int index, unsigned int draw) const;
+
+	void sortAnts();
+	double bricksPerAntBatch() const;
+
+	ThreadPool _threadPool;
+
+	glm::ivec3 _worldSize;
+
+	BrickedWorld _world;	// packed cells, see WorldCell.h
+
+	CpuAnts _ants;
+
+	bool _useAvx2;
+
+	int _antSortInterval;
+	AntSortStatistics _antSortStatistics;
+
+	// scratch of sortAnts(), kept between sorts
+	std::vector<unsigned int> _antSortKeys;
+	std::vector<unsigned int> _antSortKeysScratch;
+	std::vector<int> _antSortOrder;
+	std::vector<int> _antSortOrderScratch;
+	CpuAnts _scratchAnts;	// sortAnts() and retireAnts() write the reordered ants here, then swap
+
+	AntPopulation _population;
+
+	// scratch of retireAnts(): live ants in each chunk of the array, then where that chunk's live ants go
+	std::vector<int> _liveAntsPerChunk;
+
+	// per-voxel scratch the ants deposit into while they move, zero again once the step is done; laid out like the
+	// brick pool, so it only covers resident bricks. Ants in this voxel in the low 32 bits, ants in the surrounding
+	// 26 voxels in the high 32 bits, so one atomic add counts an ant either way
+	std::unique_ptr<std::atomic<unsigned long long>[]> _antDeposits;
+	size_t _antDepositsSize;
+
+	// the bricks the ants need this tick (see BrickedWorld::requestNeighborhood), all zero between ticks
+	std::unique_ptr<std::atomic<unsigned int>[]> _brickRequests;
+	int _numBrickRequestWords;
+
+	// for each chunk of ants, the scratch indices of the voxels whose deposit that chunk took from zero, so the world
+	// update visits every touched voxel exactly once
+	std::vector<std::vector<int> > _touchedVoxels;
+
+	unsigned int _seed;
+	unsigned int _tick;
+};
@@ -0,0 +1,653 @@
+#include "FragmentSimulationBackend.h"
+#include "AntDirection.h"
+
+static const int NUM_NEIGHBORHOOD_VOXELS = 27;	// an ant's own voxel and the 26 around it
+
+static const unsigned int BRICK_RELEASE_INTERVAL = 64;	// ticks between sweeps for bricks whose trails have faded
+
+static const GLenum DEPOSIT_TEXTURE_FORMAT = GL_RG16F;	// ant counts, blended additively; exact up to 2048 ants per voxel
+
+static const GLuint ANT_MOVEMENT_CONES_BINDING = 0;	// uniform buffer binding point of the AntMovementCones block
+
+// the ants are laid out row by row in a square, so a million of them need a 1024 x 1024 texture rather than a
+// texture a million texels wide; the last row may be partly empty, and so may the texels kept for a growing colony
+static glm::ivec3 antTextureSize(int numAnts)
+{
+	int width = glm::max((int)glm::ceil(glm::sqrt((double)numAnts)), 1);
+	int height = glm::max((numAnts + width - 1) / width, 1);
+
+	return glm::ivec3(width, height, 1);
+}
+
+FragmentSimulationBackend::FragmentSimulationBackend() : _seed(0), _tick(0), _numAnts(0), _numPreviousAnts(0), _brickRequestFence(0)
+{
+	_quadVbo = Utils::initializeQuadVBO();
+
+	_worldTrailVolume = Utils::createVolume(glm::ivec3(1, 1, 1), WORLD_TRAIL_TEXTURE_FORMAT);
+	_worldFoodVolume = Utils::createVolume(glm::ivec3(1, 1, 1), WORLD_FOOD_TEXTURE_FORMAT);
+
+	glGenTextures(1, &_worldTerrainTextureId);
+	Utils::updateTextureSize(_worldTerrainTextureId, glm::ivec3(1, 1, 1), WORLD_TERRAIN_TEXTURE_FORMAT);
+
+	_updatedTrailVolume = Utils::createVolume(glm::ivec3(1, 1, 1), WORLD_TRAIL_TEXTURE_FORMAT);
+	_updatedFoodVolume = Utils::createVolume(glm::ivec3(1, 1, 1), WORLD_FOOD_TEXTURE_FORMAT);
+
+	_depositVolume = Utils::createVolume(glm::ivec3(1, 1, 1), DEPOSIT_TEXTURE_FORMAT);
+
+	_worldPageTextureId = Utils::createPageTexture(glm::ivec3(1, 1, 1));
+
+	_brickRequestVolume = Utils::createVolume(glm::ivec3(1, 1, 1), GL_R8);
+	glGenBuffers(1, &_brickRequestPackBufferId);
+
+	_antPingPong = Utils::createPingPong(glm::ivec3(1, 1, 1));
+
+	glGenFramebuffers(1, &_commitFboId);
+	glBindFramebuffer(GL_FRAMEBUFFER, _commitFboId);
+	glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, _worldTrailVolume.textureId, 0);
+	glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, _depositVolume.textureId, 0);
+	GLenum commitDrawBuffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glDrawBuffers(2, commitDrawBuffers);
+	Utils::doOpenGLErrorCheck(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE, "failed to create commit FBO");
+
+	// the food commit leaves the deposit counts to the trail commit, which clears them
+	glGenFramebuffers(1, &_commitFoodFboId);
+	glBindFramebuffer(GL_FRAMEBUFFER, _commitFoodFboId);
+	glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, _worldFoodVolume.textureId, 0);
+	GLenum commitFoodDrawBuffers[] = { GL_COLOR_ATTACHMENT0, GL_NONE };
+	glDrawBuffers(2, commitFoodDrawBuffers);
+	Utils::doOpenGLErrorCheck(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE, "failed to create food commit FBO");
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	_simulationWorldProgramId = Utils::createSimulationProgram("simulation_scatter_vertex.glsl", "simulation_scatter_geometry.glsl", "simulation_world_fragment.glsl");
+	printf("_simulationWorldProgramId: %d\n", _simulationWorldProgramId);
+
+	_simulationAntProgramId = Utils::createSimulationProgram("simulation_vertex.glsl", "simulation_geometry.glsl", "simulation_ant_fragment.glsl");
+	printf("_simulationAntProgramId: %d\n", _simulationAntProgramId);
+
+	// the movement cone of every direction code never changes, so the ant shader gets it once
+	std::vector<glm::ivec4> antMovementCones = antMovementConeUniformBlock();
+	glGenBuffers(1, &_antMovementConeBufferId);
+	glBindBuffer(GL_UNIFORM_BUFFER, _antMovementConeBufferId);
+	glBufferData(GL_UNIFORM_BUFFER, antMovementCones.size() * sizeof(glm::ivec4), &antMovementCones[0], GL_STATIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	glUniformBlockBinding(_simulationAntProgramId, glGetUniformBlockIndex(_simulationAntProgramId, "AntMovementCones"), ANT_MOVEMENT_CONES_BINDING);
+
+	_simulationDepositProgramId = Utils::createSimulationProgram("simulation_scatter_vertex.glsl", "simulation_scatter_geometry.glsl", "simulation_deposit_fragment.glsl");
+	printf("_simulationDepositProgramId: %d\n", _simulationDepositProgramId);
+
+	_simulationFoodProgramId = Utils::createSimulationProgram("simulation_scatter_vertex.glsl", "simulation_scatter_geometry.glsl", "simulation_food_fragment.glsl");
+	printf("_simulationFoodProgramId: %d\n", _simulationFoodProgramId);
+
+	_simulationCommitProgramId = Utils::createSimulationProgram("simulation_scatter_vertex.glsl", "simulation_scatter_geometry.glsl", "simulation_commit_fragment.glsl");
+	printf("_simulationCommitProgramId: %d\n", _simulationCommitProgramId);
+
+	_simulationRestampProgramId = Utils::createSimulationProgram("simulation_vertex.glsl", "simulation_geometry.glsl", "simulation_restamp_fragment.glsl");
+	printf("_simulationRestampProgramId: %d\n", _simulationRestampProgramId);
+
+	_brickRequestProgramId = Utils::createSimulationProgram("simulation_scatter_vertex.glsl", "simulation_brick_request_geometry.glsl", "simulation_brick_request_fragment.glsl");
+	printf("_brickRequestProgramId: %d\n", _brickRequestProgramId);
+}
+
+const char* FragmentSimulationBackend::name() const
+{
+	return "fragment";
+}
+
+unsigned int FragmentSimulationBackend::tick() const
+{
+	return _tick;
+}
+
+int FragmentSimulationBackend::numAnts() const
+{
+	return _numAnts;
+}
+
+const BrickedWorld& FragmentSimulationBackend::world() const
+{
+	return _world;
+}
+
+unsigned int FragmentSimulationBackend::worldTrailTextureId() const
+{
+	return _worldTrailVolume.textureId;
+}
+
+unsigned int FragmentSimulationBackend::worldFoodTextureId() const
+{
+	return _worldFoodVolume.textureId;
+}
+
+unsigned int FragmentSimulationBackend::worldTerrainTextureId() const
+{
+	return _worldTerrainTextureId;
+}
+
+unsigned int FragmentSimulationBackend::worldPageTextureId() const
+{
+	return _worldPageTextureId;
+}
+
+void FragmentSimulationBackend::restart(const SimulationParameters& parameters)
+{
+	_seed = parameters.seed;
+	_tick = 0;
+
+	_world.reset(parameters.worldSize, false);
+
+	glm::ivec3 atlasSize = _world.atlasSize();
+
+	Volume* worldLayerVolumes[] = { &_worldTrailVolume, &_worldFoodVolume, &_updatedTrailVolume, &_updatedFoodVolume };
+	GLenum worldLayerFormats[] = { WORLD_TRAIL_TEXTURE_FORMAT, WORLD_FOOD_TEXTURE_FORMAT, WORLD_TRAIL_TEXTURE_FORMAT, WORLD_FOOD_TEXTURE_FORMAT };
+	for (int i = 0; i < 4; i++) {
+		Utils::updateTextureSize(worldLayerVolumes[i]->textureId, atlasSize, worldLayerFormats[i]);
+		worldLayerVolumes[i]->volumeSize = atlasSize;
+	}
+
+	Utils::updateTextureSize(_worldTerrainTextureId, atlasSize, WORLD_TERRAIN_TEXTURE_FORMAT);
+
+	Utils::updateTextureSize(_depositVolume.textureId, atlasSize, DEPOSIT_TEXTURE_FORMAT);
+	_depositVolume.volumeSize = atlasSize;
+
+	Utils::updatePageTextureSize(_worldPageTextureId, _world.pageTableSize());
+
+	// requests still on the way are for the previous world
+	if (_brickRequestFence != 0) {
+		glDeleteSync(_brickRequestFence);
+		_brickRequestFence = 0;
+	}
+
+	glm::ivec3 sizeInBricks = _world.sizeInBricks();
+	Utils::updateTextureSize(_brickRequestVolume.textureId, sizeInBricks, GL_R8);
+	_brickRequestVolume.volumeSize = sizeInBricks;
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, _brickRequestPackBufferId);
+	glBufferData(GL_PIXEL_PACK_BUFFER, sizeInBricks.x * sizeInBricks.y * sizeInBricks.z, 0, GL_STREAM_READ);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	GLint maxTextureSize;
+	glGetIntegerv(GL_MAX_3D_TEXTURE_SIZE, &maxTextureSize);
+	Utils::doOpenGLErrorCheck(antTextureSize(MAX_NUM_ANTS).x <= maxTextureSize, "too many ants for the maximum 3D texture size");
+
+	// start with room for just the initial ants, reserveAntTexels() grows the textures when more are spawned
+	_antPingPong = Utils::updatePingPongSize(_antPingPong, antTextureSize(parameters.numAnts));
+
+	_population.reset(parameters.numAnts);
+	_numAnts = parameters.numAnts;
+
+	// the deposit counts are only cleared where the ants were, so start from an all-zero texture
+	glBindFramebuffer(GL_FRAMEBUFFER, _depositVolume.fboId);
+	glClearColor(0.0, 0.0, 0.0, 0.0);
+	glClear(GL_COLOR_BUFFER_BIT);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	initWorld(parameters);
+
+	// with no ants before it, the first pass through the ant shader runs init() for every ant
+	_numPreviousAnts = 0;
+
+	updateAnts(parameters);
+	requestBricks();
+}
+
+void FragmentSimulationBackend::step(const SimulationParameters& parameters)
+{
+	_numPreviousAnts = _numAnts;
+	_population.beginTick(parameters, _tick);
+	_numAnts = _population.numAnts();
+
+	// before the ants read the world and the faded bricks are released, like CpuSimulationBackend::step()
+	if (_tick > 0 && _tick % WORLD_CELL_RESTAMP_INTERVAL == 0) {
+		restampWorld(parameters);
+	}
+
+	updateAnts(parameters);
+	updateResidentBricks(parameters);
+	requestBricks();
+
+	depositAnts();
+	updateTouchedTrails(parameters);
+	updateAntFood(parameters);
+	commitAntFood();
+	commitTouchedTrails();
+
+	_tick++;
+}
+
+void FragmentSimulationBackend::initWorld(const SimulationParameters& parameters) {
+	GLuint worldTrailTextureId = _worldTrailVolume.textureId;
+	GLuint worldFoodTextureId = _worldFoodVolume.textureId;
+	GLuint worldTerrainTextureId = _worldTerrainTextureId;
+	const BrickedWorld& world = _world;
+
+	_world.initialize(parameters, [&](int slot, const WorldCell* cells) {
+		Utils::uploadBrick(worldTrailTextureId, worldFoodTextureId, worldTerrainTextureId, world.atlasBrickCoord(slot), cells);
+	});
+
+	Utils::uploadPageTable(_worldPageTextureId, _world.pageTableSize(), _world.pageTable());
+}
+
+// the stamps only hold 16 bits, so every WORLD_CELL_RESTAMP_INTERVAL ticks the cells that have gone that long untouched
+// are restamped (see restampWorldCell). One quad per atlas slice, up to the last slice holding a slot in use, writes
+// the whole trail layer of those slices into the updated trail texture, which then swaps places with the trail
+// texture; the slices past them only hold slots that are cleared when they are handed out
+void FragmentSimulationBackend::restampWorld(const SimulationParameters& parameters) {
+	int numSlotsInUse = _world.numSlotsInUse();
+	if (numSlotsInUse == 0) {
+		return;
+	}
+
+	glm::ivec3 atlasSizeInBricks = _world.atlasSizeInBricks();
+	int bricksPerLayer = atlasSizeInBricks.x * atlasSizeInBricks.y;
+	int numSlices = (numSlotsInUse + bricksPerLayer - 1) / bricksPerLayer * WORLD_BRICK_SIZE;
+
+	glBindBuffer(GL_ARRAY_BUFFER, _quadVbo);
+	glVertexAttribPointer(SlotPosition, 2, GL_SHORT, GL_FALSE, 2 * sizeof(short), 0);
+	glViewport(0, 0, _updatedTrailVolume.volumeSize.x, _updatedTrailVolume.volumeSize.y);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, _updatedTrailVolume.fboId);
+
+	glUseProgram(_simulationRestampProgramId);
+
+	glUniform1f(glGetUniformLocation(_simulationRestampProgramId, "trailDissipationPerFrame"), parameters.trailDissipationPerFrame);
+	glUniform1ui(glGetUniformLocation(_simulationRestampProgramId, "worldTick"), _tick);
+	glUniform1i(glGetUniformLocation(_simulationRestampProgramId, "worldTrailTexture"), 0);	// set to GL_TEXTURE0
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_3D, _worldTrailVolume.textureId);
+
+	glDisable(GL_BLEND);
+
+	glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, numSlices);
+
+	glBindTexture(GL_TEXTURE_3D, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	glUseProgram(0);
+
+	// each volume keeps its own framebuffer, but the commit framebuffer has to follow the trail texture
+	Volume restampedTrailVolume = _updatedTrailVolume;
+	_updatedTrailVolume = _worldTrailVolume;
+	_worldTrailVolume = restampedTrailVolume;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, _commitFboId);
+	glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, _worldTrailVolume.textureId, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+// makes the bricks the ants requested on the last tick resident, and the nest's neighbourhood if ants are spawned there,
+// so the scatter passes find a slot for every voxel they touch; also hands the bricks whose trails have faded back to
+// the pool. Like ComputeSimulationBackend::updateResidentBricks, this pins the bricks the ants stood in last tick,
+// including the ones that just retired
+void FragmentSimulationBackend::updateResidentBricks(const SimulationParameters& parameters) {
+	if (_tick % BRICK_RELEASE_INTERVAL == 0) {
+		_world.releaseFadedBricks(_tick, parameters.trailDissipationPerFrame);
+	}
+
+	if (_brickRequestFence != 0) {
+		Utils::waitForFence(_brickRequestFence);
+		_brickRequestFence = 0;
+
+		glm::ivec3 sizeInBricks = _world.sizeInBricks();
+		int numBricks = sizeInBricks.x * sizeInBricks.y * sizeInBricks.z;
+
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, _brickRequestPackBufferId);
+		const unsigned char* requests = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, numBricks, GL_MAP_READ_BIT);
+		for (int brick = 0; brick < numBricks; brick++) {
+			if (requests[brick] != 0) {
+				_world.touchRequestedBricks(brick, requests[brick], _tick);
+			}
+		}
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+
+	if (_population.numSpawnedAnts() > 0) {
+		_world.touchNeighborhood(_world.worldSize() / 2, _tick);
+	}
+
+	// slots can be handed out again, so clear whatever trail, food and nest the previous brick left in them
+	static const WorldCell emptyCell = { 0, 0, 0, 0 };
+	static const std::vector<WorldCell> emptyBrickCells(WORLD_BRICK_VOXELS, emptyCell);
+
+	const std::vector<int>& allocatedSlots = _world.allocatedSlots();
+	for (size_t i = 0; i < allocatedSlots.size(); i++) {
+		Utils::uploadBrick(_worldTrailVolume.textureId, _worldFoodVolume.textureId, _worldTerrainTextureId, _world.atlasBrickCoord(allocatedSlots[i]), &emptyBrickCells[0]);
+	}
+
+	const std::vector<int>& changedBricks = _world.changedBricks();
+	for (size_t i = 0; i < changedBricks.size(); i++) {
+		Utils::uploadPageTableEntry(_worldPageTextureId, _world.pageTableCoord(changedBricks[i]), _world.pageTable()[changedBricks[i]]);
+	}
+
+	_world.clearChanges();
+}
+
+// marks the bricks within two voxels of every ant (after updateAnts() swapped the ant ping-pong, previous holds the new
+// positions) and starts reading them back; the next updateResidentBricks() waits for them, by when the passes after
+// this one have long been queued
+void FragmentSimulationBackend::requestBricks() {
+	glm::ivec3 worldSize = _world.worldSize();
+	glm::ivec3 sizeInBricks = _brickRequestVolume.volumeSize;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, _brickRequestVolume.fboId);
+	glViewport(0, 0, sizeInBricks.x, sizeInBricks.y);
+
+	glClearColor(0.0, 0.0, 0.0, 0.0);
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	glUseProgram(_brickRequestProgramId);
+
+	glUniform1i(glGetUniformLocation(_brickRequestProgramId, "antTexture"), 1);	// set to GL_TEXTURE1
+	glUniform3f(glGetUniformLocation(_brickRequestProgramId, "inverseWorldTextureSize"), 
+		1.0f / worldSize.x,
+		1.0f / worldSize.y,
+		1.0f / worldSize.z);
+	glUniform1i(glGetUniformLocation(_brickRequestProgramId, "antVoxelsOnly"), 1);
+	glUniform3i(glGetUniformLocation(_brickRequestProgramId, "worldSize"), worldSize.x, worldSize.y, worldSize.z);
+	glUniform3i(glGetUniformLocation(_brickRequestProgramId, "worldSizeInBricks"), sizeInBricks.x, sizeInBricks.y, sizeInBricks.z);
+
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_3D, _antPingPong.previous.textureId);
+
+	// the ants marking the same brick keep the most bits
+	glEnable(GL_BLEND);
+	glBlendEquation(GL_MAX);
+
+	glDisableVertexAttribArray(SlotPosition);
+
+	glDrawArrays(GL_POINTS, 0, _numAnts);
+
+	glEnableVertexAttribArray(SlotPosition);
+
+	glBlendEquation(GL_FUNC_ADD);
+
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_3D, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	glUseProgram(0);
+
+	// into the pixel buffer, so this doesn't wait for the pass; the rows of bytes aren't padded
+	glBindTexture(GL_TEXTURE_3D, _brickRequestVolume.textureId);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, _brickRequestPackBufferId);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glGetTexImage(GL_TEXTURE_3D, 0, GL_RED, GL_UNSIGNED_BYTE, 0);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	glBindTexture(GL_TEXTURE_3D, 0);
+
+	_brickRequestFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+// uniforms every pass that reads or writes the world through the page table needs
+void FragmentSimulationBackend::setWorldLayoutUniforms(GLuint simulationShaderProgramId) {
+	glm::ivec3 worldSize = _world.worldSize();
+	glm::ivec3 atlasSizeInBricks = _world.atlasSizeInBricks();
+
+	glUniform1i(glGetUniformLocation(simulationShaderProgramId, "antTexture"), 1);	// set to GL_TEXTURE1
+	glUniform1i(glGetUniformLocation(simulationShaderProgramId, "worldPageTexture"), 4);	// set to GL_TEXTURE4
+	glUniform3i(glGetUniformLocation(simulationShaderProgramId, "worldAtlasSizeInBricks"), atlasSizeInBricks.x, atlasSizeInBricks.y, atlasSizeInBricks.z);
+	glUniform3f(glGetUniformLocation(simulationShaderProgramId, "inverseWorldTextureSize"), 
+		1.0f / worldSize.x,
+		1.0f / worldSize.y,
+		1.0f / worldSize.z);
+}
+
+void FragmentSimulationBackend::setSimulationUniforms(const SimulationParameters& parameters, GLuint simulationShaderProgramId) {
+	glUniform1ui(glGetUniformLocation(simulationShaderProgramId, "randomSeed"), _seed);
+	glUniform1f(glGetUniformLocation(simulationShaderProgramId, "initialFoodRatio"), parameters.initialFoodRatio);
+	glUniform1f(glGetUniformLocation(simulationShaderProgramId, "trailDissipationPerFrame"), parameters.trailDissipationPerFrame);
+	glUniform1f(glGetUniformLocation(simulationShaderProgramId, "freeWillThreshold"), 1.0f - parameters.randomMovementProbability);	// same float as the CPU backend compares against
+	glUniform1f(glGetUniformLocation(simulationShaderProgramId, "foodNestScoreMultiplier"), parameters.foodNestScoreMultiplier);
+	glUniform1f(glGetUniformLocation(simulationShaderProgramId, "trailScoreMultiplier"), parameters.trailScoreMultiplier);
+	glUniform1f(glGetUniformLocation(simulationShaderProgramId, "crowdingScoreMultiplier"), parameters.crowdingScoreMultiplier);
+	glUniform1f(glGetUniformLocation(simulationShaderProgramId, "foodPickupRate"), parameters.foodPickupRate);
+	glUniform1ui(glGetUniformLocation(simulationShaderProgramId, "worldTick"), _tick);
+	glUniform1i(glGetUniformLocation(simulationShaderProgramId, "worldTrailTexture"), 0);	// set to GL_TEXTURE0
+	glUniform1i(glGetUniformLocation(simulationShaderProgramId, "worldFoodTexture"), 5);	// set to GL_TEXTURE5
+	glUniform1i(glGetUniformLocation(simulationShaderProgramId, "worldTerrainTexture"), 6);	// set to GL_TEXTURE6
+	glUniform1i(glGetUniformLocation(simulationShaderProgramId, "depositTexture"), 3);	// set to GL_TEXTURE3
+	setWorldLayoutUniforms(simulationShaderProgramId);
+	glUniform3f(glGetUniformLocation(simulationShaderProgramId, "inverseAntTextureSize"), 
+		1.0f / _antPingPong.current.volumeSize.x,
+		1.0f / _antPingPong.current.volumeSize.y,
+		1.0f / _antPingPong.current.volumeSize.z);
+	glUniform1ui(glGetUniformLocation(simulationShaderProgramId, "numAnts"), (GLuint)_numAnts);
+	glUniform1ui(glGetUniformLocation(simulationShaderProgramId, "numPreviousAnts"), (GLuint)_numPreviousAnts);
+	glUniform1ui(glGetUniformLocation(simulationShaderProgramId, "numRetiredAnts"), (GLuint)_population.numRetiredAnts());
+	glUniform1ui(glGetUniformLocation(simulationShaderProgramId, "firstAntId"), _population.firstAntId());
+}
+
+// the ant pass writes the current ant texture, which has to hold all the live ants; it doubles when it runs out, so a
+// growing colony reallocates now and then instead of every tick, and the previous texture catches up on the next tick
+void FragmentSimulationBackend::reserveAntTexels() {
+	glm::ivec3 antSize = _antPingPong.current.volumeSize;
+	int numAntTexels = antSize.x * antSize.y;
+	if (numAntTexels >= _numAnts) {
+		return;
+	}
+
+	antSize = antTextureSize(glm::min(glm::max(_numAnts, 2 * numAntTexels), MAX_NUM_ANTS));
+
+	Utils::updateTextureSize(_antPingPong.current.textureId, antSize);
+	_antPingPong.current.volumeSize = antSize;
+}
+
+void FragmentSimulationBackend::updateAnts(const SimulationParameters& parameters) {
+	reserveAntTexels();
+
+	glBindBuffer(GL_ARRAY_BUFFER, _quadVbo);
+	glVertexAttribPointer(SlotPosition, 2, GL_SHORT, GL_FALSE, 2 * sizeof(short), 0);
+	glViewport(0, 0, _antPingPong.current.volumeSize.x, _antPingPong.current.volumeSize.y);
+
+	glUseProgram(_simulationAntProgramId);
+
+	setSimulationUniforms(parameters, _simulationAntProgramId);
+
+	// bind textures
+
+	glBindFramebuffer(GL_FRAMEBUFFER, _antPingPong.current.fboId);
+
+	// the ants read the world around them and their own previous state
+	
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_3D, _worldTrailVolume.textureId);
+
+	glActiveTexture(GL_TEXTURE5);
+	glBindTexture(GL_TEXTURE_3D, _worldFoodVolume.textureId);
+
+	glActiveTexture(GL_TEXTURE6);
+	glBindTexture(GL_TEXTURE_3D, _worldTerrainTextureId);
+
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_3D, _antPingPong.previous.textureId);
+
+	glActiveTexture(GL_TEXTURE4);
+	glBindTexture(GL_TEXTURE_3D, _worldPageTextureId);
+
+	glBindBufferBase(GL_UNIFORM_BUFFER, ANT_MOVEMENT_CONES_BINDING, _antMovementConeBufferId);
+
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_ONE, GL_ZERO);
+	glBlendEquation(GL_FUNC_ADD);
+
+	glDisable(GL_CULL_FACE);
+
+	glClearColor(0.0, 0.0, 0.0, 0.0);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	// draw arrays instanced
+
+	glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, _antPingPong.current.volumeSize.z);
+
+	Utils::swapPingPong(&_antPingPong);
+
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_3D, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	glUseProgram(0);
+}
+
+// draws one point per ant, instanced over the 27 voxels of its neighbourhood, with whatever program and framebuffer are bound;
+// the geometry shader routes each point to its slice with gl_Layer and drops the ones outside the world
+void FragmentSimulationBackend::scatterAroundAnts() {
+	glViewport(0, 0, _worldTrailVolume.volumeSize.x, _worldTrailVolume.volumeSize.y);
+
+	// after updateAnts() swapped the ant ping-pong, previous holds the new ant positions
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_3D, _antPingPong.previous.textureId);
+
+	glActiveTexture(GL_TEXTURE4);
+	glBindTexture(GL_TEXTURE_3D, _worldPageTextureId);
+
+	// the vertex shader only uses gl_VertexID/gl_InstanceID, so don't fetch from the quad VBO
+	glDisableVertexAttribArray(SlotPosition);
+
+	glDrawArraysInstanced(GL_POINTS, 0, _numAnts, NUM_NEIGHBORHOOD_VOXELS);
+
+	glEnableVertexAttribArray(SlotPosition);
+
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_3D, 0);
+}
+
+// draws one point at the voxel every ant stands in after this tick's moves, the only voxels whose food changes. Same
+// state as scatterAroundAnts() otherwise; the program must have antVoxelsOnly set
+void FragmentSimulationBackend::scatterAtAnts() {
+	glViewport(0, 0, _worldFoodVolume.volumeSize.x, _worldFoodVolume.volumeSize.y);
+
+	glActiveTexture(GL_TEXTURE4);
+	glBindTexture(GL_TEXTURE_3D, _worldPageTextureId);
+
+	glDisableVertexAttribArray(SlotPosition);
+
+	// after updateAnts() swapped the ant ping-pong, previous holds the new ant positions
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_3D, _antPingPong.previous.textureId);
+	glDrawArrays(GL_POINTS, 0, _numAnts);
+
+	glEnableVertexAttribArray(SlotPosition);
+
+	glBindTexture(GL_TEXTURE_3D, 0);
+}
+
+void FragmentSimulationBackend::depositAnts() {
+	glBindFramebuffer(GL_FRAMEBUFFER, _depositVolume.fboId);
+
+	glUseProgram(_simulationDepositProgramId);
+
+	setWorldLayoutUniforms(_simulationDepositProgramId);
+
+	// overlapping points add up: red counts the ants in a voxel, green the ants next to it
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_ONE, GL_ONE);
+	glBlendEquation(GL_FUNC_ADD);
+
+	scatterAroundAnts();
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	glUseProgram(0);
+}
+
+void FragmentSimulationBackend::updateTouchedTrails(const SimulationParameters& parameters) {
+	glBindFramebuffer(GL_FRAMEBUFFER, _updatedTrailVolume.fboId);
+
+	glUseProgram(_simulationWorldProgramId);
+
+	setSimulationUniforms(parameters, _simulationWorldProgramId);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_3D, _worldTrailVolume.textureId);
+
+	glActiveTexture(GL_TEXTURE3);
+	glBindTexture(GL_TEXTURE_3D, _depositVolume.textureId);
+
+	// a voxel next to several ants gets several points, but they all read the same inputs and write the same value
+	glDisable(GL_BLEND);
+
+	scatterAroundAnts();
+
+	glActiveTexture(GL_TEXTURE3);
+	glBindTexture(GL_TEXTURE_3D, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	glUseProgram(0);
+}
+
+void FragmentSimulationBackend::updateAntFood(const SimulationParameters& parameters) {
+	glBindFramebuffer(GL_FRAMEBUFFER, _updatedFoodVolume.fboId);
+
+	glUseProgram(_simulationFoodProgramId);
+
+	setSimulationUniforms(parameters, _simulationFoodProgramId);
+	glUniform1i(glGetUniformLocation(_simulationFoodProgramId, "antVoxelsOnly"), 1);
+
+	glActiveTexture(GL_TEXTURE5);
+	glBindTexture(GL_TEXTURE_3D, _worldFoodVolume.textureId);
+
+	// like the trail update, points landing on the same voxel all write the same value
+	glDisable(GL_BLEND);
+
+	scatterAtAnts();
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	glUseProgram(0);
+}
+
+void FragmentSimulationBackend::commitAntFood() {
+	glBindFramebuffer(GL_FRAMEBUFFER, _commitFoodFboId);
+
+	glUseProgram(_simulationCommitProgramId);
+
+	glUniform1i(glGetUniformLocation(_simulationCommitProgramId, "updatedWorldTexture"), 3);	// set to GL_TEXTURE3
+	glUniform1i(glGetUniformLocation(_simulationCommitProgramId, "antVoxelsOnly"), 1);
+	setWorldLayoutUniforms(_simulationCommitProgramId);
+
+	// the food texture is only sampled in the other passes, so it can be a render target here
+	glActiveTexture(GL_TEXTURE5);
+	glBindTexture(GL_TEXTURE_3D, 0);
+
+	glActiveTexture(GL_TEXTURE3);
+	glBindTexture(GL_TEXTURE_3D, _updatedFoodVolume.textureId);
+
+	glDisable(GL_BLEND);
+
+	scatterAtAnts();
+
+	glActiveTexture(GL_TEXTURE3);
+	glBindTexture(GL_TEXTURE_3D, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	glUseProgram(0);
+}
+
+void FragmentSimulationBackend::commitTouchedTrails() {
+	glBindFramebuffer(GL_FRAMEBUFFER, _commitFboId);
+
+	glUseProgram(_simulationCommitProgramId);
+
+	glUniform1i(glGetUniformLocation(_simulationCommitProgramId, "updatedWorldTexture"), 3);	// set to GL_TEXTURE3
+	glUniform1i(glGetUniformLocation(_simulationCommitProgramId, "antVoxelsOnly"), 0);
+	setWorldLayoutUniforms(_simulationCommitProgramId);
+
+	// the trail texture is only sampled in the other passes, so it can be a render target here
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_3D, 0);
+
+	glActiveTexture(GL_TEXTURE3);
+	glBindTexture(GL_TEXTURE_3D, _updatedTrailVolume.textureId);
+
+	glDisable(GL_BLEND);
+
+	scatterAroundAnts();
+
+	glActiveTexture(GL_TEXTURE3);
+	glBindTexture(GL_TEXTURE_3D, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	glUseProgram(0);
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#define GLEW_STATIC 1
+#include <GL/glew.h>
+#include <GL/glut.h>
+#include <glm/glm.hpp>
+#include "SimulationBackend.h"
+#include "Utils.h"
+#include "BrickedWorld.h"
+#include "AntPopulation.h"
+#include <vector>
+
+// The original GPU simulation: the ants live in a pair of ping-ponged textures, one texel per ant in a square of up
+// to 2048 x 2048, updated by drawing a full-screen quad through simulation_ant_fragment.glsl. The live ants are kept
+// in id order at the start of the texture: the ant pass reads each ant from past the ants that retire this tick and
+// initializes the spawned ones after the rest, and the textures grow by doubling as the colony does. The world lives in a brick atlas texture plus a page table texture
+// (see BrickedWorld.h), one atlas texture per layer of the cells (see WorldCell.h), and is only written around the ants:
+// each ant is scattered as GL_POINTs over its 27-voxel neighbourhood (routed to the right atlas slice with gl_Layer) to
+// count the ants per voxel, update the trail layer of those voxels, and copy it back. The food layer only goes through
+// the same update and copy at the voxels the ants stand in and just left, one point each. Trails decay lazily from a
+// per-voxel tick stamp, so untouched voxels are never rewritten.
+// The host keeps the brick bookkeeping without reading the ants back: a pass draws every ant into a texture of one
+// byte per brick, marking the bricks within two voxels of it, and that texture is read back through a pixel buffer
+// while the rest of the tick runs; the next tick makes the marked bricks resident before its scatter passes, which
+// stay within a voxel of ants that have moved at most one voxel since. Needs a current GL context.
+class FragmentSimulationBackend : public SimulationBackend
+{
+public:
+	FragmentSimulationBackend();
+
+	virtual void restart(const SimulationParameters& parameters);
+	virtual void step(const SimulationParameters& parameters);
+	virtual const char* name() const;
+	virtual unsigned int tick() const;
+	virtual int numAnts() const;
+
+	virtual const BrickedWorld& world() const;
+
+	virtual unsigned int worldTrailTextureId() const;
+	virtual unsigned int worldFoodTextureId() const;
+	virtual unsigned int worldTerrainTextureId() const;
+	virtual unsigned int worldPageTextureId() const;
+
+private:
+	unsigned int _seed;	// run seed, passed to the ant shader for its random draws
+	unsigned int _tick;	// number of completed ticks; the world texture holds this tick
+
+	int _numAnts;	// the ant textures hold this many ants, row by row (see antTextureSize)
+	int _numPreviousAnts;	// ants in the previous ant texture, before this tick's retirements and spawns
+
+	AntPopulation _population;
+
+	GLuint _simulationWorldProgramId;		// points around the ants
+	GLuint _simulationAntProgramId;
+	GLuint _simulationDepositProgramId;
+	GLuint _simulationFoodProgramId;		// points at the ants
+	GLuint _simulationCommitProgramId;
+	GLuint _simulationRestampProgramId;		// quads over the atlas
+	GLuint _brickRequestProgramId;
+
+	void setWorldLayoutUniforms(GLuint simulationShaderProgramId);
+	void setSimulationUniforms(const SimulationParameters& parameters, GLuint simulationShaderProgramId);
+
+	void initWorld(const SimulationParameters& parameters);
+	void restampWorld(const SimulationParameters& parameters);
+	void reserveAntTexels();
+	void updateAnts(const SimulationParameters& parameters);
+	void updateResidentBricks(const SimulationParameters& parameters);
+	void requestBricks();
+
+	void scatterAroundAnts();
+	void scatterAtAnts();
+	void depositAnts();
+	void updateTouchedTrails(const SimulationParameters& parameters);
+	void updateAntFood(const SimulationParameters& parameters);
+	void commitAntFood();
+	void commitTouchedTrails();
+
+	GLuint _quadVbo;
+
+	BrickedWorld _world;	// bookkeeping only, the cells are in the atlas textures
+
+	// all six are laid out as the brick atlas; a fragment shader can't read the texture it renders to, so each layer the
+	// passes change has a second texture it is updated into and then copied back from
+	Volume _worldTrailVolume;
+	Volume _worldFoodVolume;
+	GLuint _worldTerrainTextureId;	// never rendered to, only written by brick uploads
+	Volume _updatedTrailVolume;	// new trail layer, only meaningful in the voxels around the ants
+	Volume _updatedFoodVolume;	// new food layer, only meaningful in the voxels the ants stand in
+	Volume _depositVolume;	// red = ants in each voxel, green = ants in the 26 voxels around it; zero everywhere between ticks
+
+	GLuint _worldPageTextureId;
+
+	GLuint _antMovementConeBufferId;	// AntMovementCones uniform block of the ant shader
+
+	Volume _brickRequestVolume;	// GL_R8, one texel per brick of the world, holding its BRICK_REQUEST_* bits
+	GLuint _brickRequestPackBufferId;	// the requests of the last tick, read back into it by the GPU
+	GLsync _brickRequestFence;	// signalled once they are there; 0 if none are on the way
+
+	GLuint _commitFboId;	// trail texture on attachment 0, deposit texture on attachment 1
+	GLuint _commitFoodFboId;	// food texture on attachment 0 only
+	
+	PingPong _antPingPong;
+};
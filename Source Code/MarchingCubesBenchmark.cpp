@@ -0,0 +1,85 @@
+#include "MarchingCubesBenchmark.h"
+#include "AntSim.h"
+#include "SurfaceMesh.h"
+#include <chrono>
+#include <stdio.h>
+
+struct ExtractionResult {
+	double bestMilliseconds;	// until the GPU finished, over the repeats
+	unsigned int triangles;
+};
+
+// the first extraction grows the mesh buffers to the surface and isn't timed
+static ExtractionResult timeExtractions(AntSim* antsim, SurfaceMesh* surfaceMesh, int numRepeats)
+{
+	ExtractionResult result = { 0.0, 0 };
+
+	for (int r = -1; r < numRepeats; r++) {
+		glFinish();
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		antsim->extractWholeSurface(surfaceMesh);
+		glFinish();
+
+		double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		surfaceMesh->beginUpdate();	// reads back what the compute pass extracted, and makes room if it didn't fit
+
+		if (r >= 0) {
+			if (r == 0 || milliseconds < result.bestMilliseconds) {
+				result.bestMilliseconds = milliseconds;
+			}
+			result.triangles = surfaceMesh->lastUpdateTriangles();
+		}
+	}
+
+	return result;
+}
+
+int runMarchingCubesBenchmark(int cubeLength, int numAnts, int numTicks, unsigned int seed, int numRepeats)
+{
+	cubeLength = glm::max(cubeLength / WORLD_BRICK_SIZE, 1) * WORLD_BRICK_SIZE;	// whole bricks, see BrickedWorld::reset
+	numTicks = glm::max(numTicks, 1);
+	numRepeats = glm::max(numRepeats, 1);
+
+	AntSim antsim(1, 1, (int)(seed & 0x7fffffffu), BackendFragmentShader);
+	antsim.cubeLength = cubeLength;
+	antsim.numAnts = numAnts;
+	antsim.restart();
+
+	// all the ticks in one go, like fast-forwarding
+	antsim.fastForward = 1;
+	antsim.ticksPerFrame = numTicks;
+	antsim.update();
+
+	printf("marching cubes benchmark: world %dx%dx%d, %d ants, seed %u, tick %d, best of %d complete extractions\n",
+		cubeLength, cubeLength, cubeLength, numAnts, seed & 0x7fffffffu, numTicks, numRepeats);
+
+	glm::ivec3 worldSize(cubeLength, cubeLength, cubeLength);
+
+	SurfaceMesh geometryShaderMesh(antsim.visualizationProgramId(), false);
+	geometryShaderMesh.reset(worldSize);
+	ExtractionResult geometryShader = timeExtractions(&antsim, &geometryShaderMesh, numRepeats);
+	printf("%-36s %10.1f ms %10u triangles\n", "geometry shader, every voxel", geometryShader.bestMilliseconds, geometryShader.triangles);
+
+	if (!GLEW_VERSION_4_3) {
+		printf("no OpenGL 4.3, so no compute pass to check the geometry shader's triangle count against\n");
+		return 0;
+	}
+
+	SurfaceMesh computeMesh(antsim.visualizationProgramId(), true);
+	computeMesh.reset(worldSize);
+	ExtractionResult compute = timeExtractions(&antsim, &computeMesh, numRepeats);
+	printf("%-36s %10.1f ms %10u triangles\n", "compute pass, resident blocks", compute.bestMilliseconds, compute.triangles);
+
+	if (geometryShader.triangles < compute.triangles) {
+		printf("the geometry shader dropped %u of the %u predicted triangles, so cubes were truncated\n", compute.triangles - geometryShader.triangles, compute.triangles);
+		return 1;
+	} else if (geometryShader.triangles > compute.triangles) {
+		printf("the geometry shader emitted %u triangles more than the %u predicted\n", geometryShader.triangles - compute.triangles, compute.triangles);
+		return 1;
+	}
+
+	printf("the geometry shader emitted every predicted triangle, no cube was truncated\n");
+	return 0;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+// Times complete extractions of the surface mesh of a world the fragment backend has run for a while: every voxel
+// through the geometry shader (visualization_geometry.glsl), and with OpenGL 4.3 the compute pass over the resident
+// blocks (visualization_extract_compute.glsl). Prints the best time of each and the triangles they produced; the
+// geometry shader's are counted with a GL_PRIMITIVES_GENERATED query, so a cube that ran out of max_vertices shows up
+// as fewer triangles than the compute pass, which has no such limit, predicts. Returns nonzero if the counts differ.
+// Needs a current context.
+// usage: myproject --benchmark-marching-cubes [--cube-length N] [--ants N] [--ticks N] [--seed N] [--repeats N]
+int runMarchingCubesBenchmark(int cubeLength, int numAnts, int numTicks, unsigned int seed, int numRepeats);
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+// Morton (Z-order) codes: the bits of x, y and z interleaved as ...z1y1x1z0y0x0, so that every aligned 2^k cube of
+// voxels is a contiguous run of 8^k codes. Up to 10 bits per axis (1024^3) fit in 32 bits.
+
+// spreads the low 10 bits of v so there are two zero bits between each of them
+inline unsigned int mortonPart1By2(unsigned int v)
+{
+	v &= 0x000003ffu;
+	v = (v ^ (v << 16)) & 0xff0000ffu;
+	v = (v ^ (v << 8)) & 0x0300f00fu;
+	v = (v ^ (v << 4)) & 0x030c30c3u;
+	v = (v ^ (v << 2)) & 0x09249249u;
+	return v;
+}
+
+// inverse of mortonPart1By2: gathers every third bit back into the low 10 bits
+inline unsigned int mortonCompact1By2(unsigned int v)
+{
+	v &= 0x09249249u;
+	v = (v ^ (v >> 2)) & 0x030c30c3u;
+	v = (v ^ (v >> 4)) & 0x0300f00fu;
+	v = (v ^ (v >> 8)) & 0xff0000ffu;
+	v = (v ^ (v >> 16)) & 0x000003ffu;
+	return v;
+}
+
+inline unsigned int mortonEncode(glm::ivec3 voxel)
+{
+	return mortonPart1By2((unsigned int)voxel.x) | (mortonPart1By2((unsigned int)voxel.y) << 1) | (mortonPart1By2((unsigned int)voxel.z) << 2);
+}
+
+inline glm::ivec3 mortonDecode(unsigned int code)
+{
+	return glm::ivec3(mortonCompact1By2(code), mortonCompact1By2(code >> 1), mortonCompact1By2(code >> 2));
+}
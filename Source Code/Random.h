@@ -0,0 +1,51 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <time.h>
+
+// Counter-based random numbers: every draw is a pure function of (run seed, stream, tick, index, draw), with no state
+// carried from one draw to the next, so any tick can be recomputed on its own, the result does not depend on how the
+// work is split across threads, and a run replays exactly from its seed. simulation_ant_fragment.glsl has the same
+// functions with the same 32-bit integer arithmetic, so both backends draw bit-identical numbers.
+
+// random streams, so that different uses never reuse the same numbers
+static const unsigned int RANDOM_STREAM_FOOD = 0;	// index = food patch
+static const unsigned int RANDOM_STREAM_ANT_INIT = 1;	// index = ant
+static const unsigned int RANDOM_STREAM_ANT_MOVE = 2;	// index = ant
+
+// integer finalizer with good avalanche (every input bit flips every output bit with probability ~1/2)
+inline unsigned int hashUint(unsigned int x)
+{
+	x ^= x >> 16;
+	x *= 0x7feb352dU;
+	x ^= x >> 15;
+	x *= 0x846ca68bU;
+	x ^= x >> 16;
+	return x;
+}
+
+inline unsigned int randomBits(unsigned int seed, unsigned int stream, unsigned int tick, unsigned int index, unsigned int draw)
+{
+	unsigned int h = hashUint(seed ^ hashUint(stream + 0x9e3779b9U * (tick + 1)));
+	h = hashUint(h ^ index);
+	h = hashUint(h ^ draw);
+	return h;
+}
+
+// uniform in [0,1); 24 bits, so the value is exact in a float on both sides
+inline float randomUniform(unsigned int seed, unsigned int stream, unsigned int tick, unsigned int index, unsigned int draw)
+{
+	return (randomBits(seed, stream, tick, index, draw) >> 8) * (1.0f / 16777216.0f);
+}
+
+// round(mix(low, high, r)) for r from randomUniform, computed exactly so the shader gets the same integer
+inline int randomIntBetween(int low, int high, float r)
+{
+	return low + (int)glm::floor((float)(high - low) * r + 0.5f);
+}
+
+// a fresh run seed, for when none was given; the seed in use is printed on restart so the run can be replayed
+inline unsigned int randomRunSeed()
+{
+	return hashUint(static_cast<unsigned int>(time(0)) ^ hashUint(static_cast<unsigned int>(clock())));
+}
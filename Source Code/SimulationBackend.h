@@ -0,0 +1,69 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+class BrickedWorld;
+
+enum SimulationBackendType {
+	BackendFragmentShader,	// brick atlas textures updated by the simulation_*_fragment.glsl passes
+	BackendCpu,				// multithreaded host implementation, does not need a GL context
+	BackendCompute			// GL 4.3 compute shaders over an ant storage buffer and the brick atlas as an image
+};
+
+static const int MAX_NUM_ANTS = 2048 * 2048;	// the fragment backend keeps one texel per ant in a square of at most 2048 x 2048
+
+// everything a backend needs to know to initialize the world and advance it by one tick
+struct SimulationParameters {
+	unsigned int seed;	// every random draw of the run derives from this (see Random.h), so the same seed replays the same run
+
+	glm::ivec3 worldSize;
+
+	int numAnts;	// ants at restart, at most MAX_NUM_ANTS
+	float antSpawnRate;	// ants the nest spawns per tick; fractions carry over to the next tick
+	int antLifetime;	// ticks an ant lives before it retires, 0 = forever (see AntPopulation.h)
+
+	float initialFoodRatio;	// amount of food to put in world; e.g. 0.2 = 20% of tiles have food
+	float foodPickupRate;	// when an ant picks up some food, how much does that diminish the food supply of a cell
+	float trailDissipationPerFrame;	// how much a trail fades each time the simulation updates
+
+	float foodNestScoreMultiplier;	// how much importance to place on food or nest when choosing where to move ant
+	float trailScoreMultiplier;	// how much importance to place on trail when choosing where to move ant
+	float crowdingScoreMultiplier;	// how much to take off the score of a cell for every ant already in it (0 = ants ignore each other)
+
+	float randomMovementProbability;	// between 0 and 1, probability that ant will choose to move randomly rather than selecting the cell with highest score
+};
+
+class SimulationBackend
+{
+public:
+	virtual ~SimulationBackend() {}
+
+	// (re)create the world and ants for the given parameters
+	virtual void restart(const SimulationParameters& parameters) = 0;
+
+	// advance the simulation by one tick: move the ants, then update the world around them
+	virtual void step(const SimulationParameters& parameters) = 0;
+
+	virtual const char* name() const = 0;
+
+	// number of ticks since restart; the world's trail values are stamped with it (see trailStrengthInWorldCell in the shaders)
+	virtual unsigned int tick() const = 0;
+
+	// number of live ants, which changes from tick to tick when ants spawn or retire
+	virtual int numAnts() const = 0;
+
+	// the world's bricks (see BrickedWorld.h); only holds the cells if the backend simulates in host memory
+	virtual const BrickedWorld& world() const = 0;
+
+	// GL brick atlas holding the trail layer of the current world cells (see WorldCell.h), or 0 if the backend keeps the world in host memory
+	virtual unsigned int worldTrailTextureId() const { return 0; }
+
+	// the same atlas for the food layer of the cells
+	virtual unsigned int worldFoodTextureId() const { return 0; }
+
+	// and for the terrain layer, which only changes when a brick is uploaded
+	virtual unsigned int worldTerrainTextureId() const { return 0; }
+
+	// GL page table texture mapping the world's bricks to atlas slots, or 0 if the backend keeps the world in host memory
+	virtual unsigned int worldPageTextureId() const { return 0; }
+};
@@ -0,0 +1,185 @@
+#include "SimulationThread.h"
+
+static const int MAX_CATCH_UP_TICKS = 8;	// ticks run back to back after falling behind, before the backlog is dropped
+
+WorldSnapshot::WorldSnapshot() : tick(0), filled(false), pageTableSize(0, 0, 0), pageTableVersion(0), atlasSizeInBricks(0, 0, 0), restampVersion(0)
+{
+}
+
+void WorldSnapshot::fill(const BrickedWorld& world, unsigned int tick)
+{
+	if (!filled || pageTableVersion != world.pageTableVersion()) {
+		glm::ivec3 size = world.pageTableSize();
+		pageTableSize = size;
+		pageTable.assign(world.pageTable(), world.pageTable() + (size_t)size.x * size.y * size.z);
+		pageTableVersion = world.pageTableVersion();
+	}
+
+	atlasSizeInBricks = world.atlasSizeInBricks();
+
+	// bricks are only written on the ticks they are touched, and slots are stamped again when they are handed out;
+	// the restamp sweep is the exception, and so rare that everything is copied after it
+	bool restamped = restampVersion != world.restampVersion();
+	int numPreviousSlots = (int)slotBrick.size();
+	int numSlots = world.numSlotsInUse();
+	slotBrick.resize(numSlots);
+	slotTouchedTick.resize(numSlots);
+	cells.resize((size_t)numSlots * WORLD_BRICK_VOXELS);
+
+	for (int slot = 0; slot < numSlots; slot++) {
+		slotBrick[slot] = world.slotBrick(slot);
+		slotTouchedTick[slot] = world.slotTouchedTick(slot);
+
+		bool changed = !filled || restamped || slot >= numPreviousSlots || slotTouchedTick[slot] >= this->tick;
+		if (slotBrick[slot] != EMPTY_BRICK && changed) {
+			world.brickCellsInAtlasOrder(slot, &cells[(size_t)slot * WORLD_BRICK_VOXELS]);
+		}
+	}
+
+	restampVersion = world.restampVersion();
+	this->tick = tick;
+	filled = true;
+}
+
+glm::ivec3 WorldSnapshot::atlasBrickCoord(int slot) const
+{
+	return glm::ivec3(
+		slot % atlasSizeInBricks.x,
+		(slot / atlasSizeInBricks.x) % atlasSizeInBricks.y,
+		slot / (atlasSizeInBricks.x * atlasSizeInBricks.y));
+}
+
+glm::ivec3 WorldSnapshot::brickCoord(int brickIndex) const
+{
+	return glm::ivec3(
+		brickIndex % pageTableSize.x,
+		(brickIndex / pageTableSize.x) % pageTableSize.y,
+		brickIndex / (pageTableSize.x * pageTableSize.y)) - WORLD_HALO_BRICKS;
+}
+
+const WorldCell* WorldSnapshot::brickCells(int slot) const
+{
+	return &cells[(size_t)slot * WORLD_BRICK_VOXELS];
+}
+
+SimulationThread::SimulationThread() : _backend(0), _stopping(false), _fillingSnapshot(0), _readySnapshot(1), _drawnSnapshot(2), _readySnapshotIsNew(false)
+{
+}
+
+SimulationThread::~SimulationThread()
+{
+	stop();
+}
+
+void SimulationThread::start(SimulationBackend* backend, const SimulationThreadSettings& settings)
+{
+	stop();
+
+	_backend = backend;
+	_settings = settings;
+	_stopping = false;
+
+	// a restart can change the world entirely, so the next fill of every snapshot copies all of it
+	for (int i = 0; i < 3; i++) {
+		_snapshots[i].filled = false;
+	}
+
+	_snapshots[_fillingSnapshot].fill(_backend->world(), _backend->tick());
+	std::swap(_fillingSnapshot, _readySnapshot);
+	_readySnapshotIsNew = true;
+
+	_thread = std::thread(&SimulationThread::threadLoop, this);
+}
+
+void SimulationThread::stop()
+{
+	if (!_thread.joinable()) {
+		return;
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_stopping = true;
+	}
+	_settingsChanged.notify_all();
+
+	_thread.join();
+}
+
+bool SimulationThread::running() const
+{
+	return _thread.joinable();
+}
+
+void SimulationThread::post(const SimulationThreadSettings& settings)
+{
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_settings = settings;
+	}
+	_settingsChanged.notify_all();
+}
+
+const WorldSnapshot& SimulationThread::acquireSnapshot()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	if (_readySnapshotIsNew) {
+		std::swap(_drawnSnapshot, _readySnapshot);
+		_readySnapshotIsNew = false;
+	}
+	return _snapshots[_drawnSnapshot];
+}
+
+void SimulationThread::threadLoop()
+{
+	TickScheduler scheduler(MAX_CATCH_UP_TICKS);
+	scheduler.reset(TickScheduler::Clock::now());
+
+	while (true) {
+		SimulationThreadSettings settings;
+		{
+			// wait until the next tick is due; settings posted meanwhile wake us up, since they can change when that is
+			std::unique_lock<std::mutex> lock(_mutex);
+			while (!_stopping) {
+				if (_settings.paused) {
+					_settingsChanged.wait(lock);
+					scheduler.reset(TickScheduler::Clock::now());	// carry on right away, without making up for the pause
+					continue;
+				}
+
+				TickScheduler::Clock::time_point nextTickDue = scheduler.nextTickDue(_settings.tickIntervalSeconds);
+				if (TickScheduler::Clock::now() >= nextTickDue) {
+					break;
+				}
+				_settingsChanged.wait_until(lock, nextTickDue);
+			}
+			if (_stopping) {
+				return;
+			}
+			settings = _settings;
+		}
+
+		_backend->step(settings.parameters);
+		scheduler.tickDone(settings.tickIntervalSeconds, TickScheduler::Clock::now());
+
+		publishSnapshot();
+	}
+}
+
+// only once the renderer has taken the previous snapshot, so a tick that is much faster than a frame doesn't
+// copy bricks that are never drawn
+void SimulationThread::publishSnapshot()
+{
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		if (_readySnapshotIsNew) {
+			return;
+		}
+	}
+
+	_snapshots[_fillingSnapshot].fill(_backend->world(), _backend->tick());
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	std::swap(_fillingSnapshot, _readySnapshot);
+	_readySnapshotIsNew = true;
+}
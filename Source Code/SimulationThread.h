@@ -0,0 +1,83 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <glm/glm.hpp>
+#include "SimulationBackend.h"
+#include "BrickedWorld.h"
+#include "TickScheduler.h"
+
+// what the renderer needs of a host-side world after some tick: the page table and every slot of the brick pool, with
+// the cells already in the x-fastest order of the GL atlas. Refilling a snapshot only copies the bricks touched since
+// it was last filled, so it stays cheap while the world is large but the ants are few
+struct WorldSnapshot {
+	unsigned int tick;	// ticks completed when the snapshot was filled
+	bool filled;	// false until the first fill(), so that everything is copied then
+
+	glm::ivec3 pageTableSize;
+	std::vector<int> pageTable;
+	unsigned int pageTableVersion;
+
+	glm::ivec3 atlasSizeInBricks;	// slot s goes to the atlas brick at atlasBrickCoord(s)
+	std::vector<int> slotBrick;	// brick index per slot, EMPTY_BRICK if free; slots [0, numSlotsInUse) of the world
+	std::vector<unsigned int> slotTouchedTick;
+	std::vector<WorldCell> cells;	// WORLD_BRICK_VOXELS per slot, in atlas order
+	unsigned int restampVersion;	// of the world when the cells were copied; a restamp can change any brick
+
+	WorldSnapshot();
+
+	void fill(const BrickedWorld& world, unsigned int tick);
+	glm::ivec3 atlasBrickCoord(int slot) const;
+	glm::ivec3 brickCoord(int brickIndex) const;	// of the page table entry brickIndex, like BrickedWorld::brickCoord
+	const WorldCell* brickCells(int slot) const;
+};
+
+// the pacing and parameters the simulation thread runs with; the latest one posted wins
+struct SimulationThreadSettings {
+	SimulationParameters parameters;	// the world size, seed and initial ants only take effect on restart
+	float tickIntervalSeconds;	// wall time between two ticks (see TickScheduler.h), 0 = as fast as possible
+	bool paused;	// no ticks at all; the thread sleeps until the settings change
+};
+
+// Runs a backend that doesn't need a GL context (the CPU backend) on its own thread, so a slow frame doesn't stall
+// the simulation and a slow tick doesn't stall the window. The UI thread only talks to it through post(), which
+// hands over new settings for the next tick, and acquireSnapshot(), which returns the latest world snapshot.
+// Snapshots go through a triple buffer: the simulation fills one snapshot after a tick, and publishes it by swapping
+// it with the ready one; the renderer swaps the ready one with the one it draws from. Neither side ever waits for
+// the other, only for the swap of two indices. The backend must not be touched by anyone else between start() and stop()
+class SimulationThread
+{
+public:
+	SimulationThread();
+	~SimulationThread();
+
+	// fills and publishes a snapshot of the backend as it is, so there is one to draw right away, then starts ticking
+	void start(SimulationBackend* backend, const SimulationThreadSettings& settings);
+	void stop();	// waits for the tick in progress
+	bool running() const;
+
+	void post(const SimulationThreadSettings& settings);
+
+	// the newest published snapshot; it stays valid and unchanged until the next call
+	const WorldSnapshot& acquireSnapshot();
+
+private:
+	void threadLoop();
+	void publishSnapshot();
+
+	SimulationBackend* _backend;
+	std::thread _thread;
+
+	std::mutex _mutex;	// guards the settings and the snapshot indices; a snapshot itself belongs to whoever holds its index
+	std::condition_variable _settingsChanged;	// also signalled by stop()
+	SimulationThreadSettings _settings;
+	bool _stopping;
+
+	WorldSnapshot _snapshots[3];
+	int _fillingSnapshot;	// only the simulation thread touches this one
+	int _readySnapshot;	// published and not yet acquired if _readySnapshotIsNew
+	int _drawnSnapshot;	// only the renderer touches this one
+	bool _readySnapshotIsNew;
+};
@@ -0,0 +1,346 @@
+#include "SurfaceMesh.h"
+#include "Utils.h"
+#include "BrickedWorld.h"
+
+static const unsigned int INITIAL_VERTEX_CAPACITY = 1 << 18;	// the buffers grow when the surface outgrows them
+static const unsigned int INITIAL_INDEX_CAPACITY = 1 << 19;
+
+static const int VERTEX_FLOATS = 10;	// meshPosition, meshNormal, meshColor, interleaved as captureVaryings() gives them
+static const GLsizeiptr VERTEX_BYTES = VERTEX_FLOATS * sizeof(GLfloat);
+
+static const GLuint MESH_COUNT_BINDING = 0;	// shader storage buffers, also given in the layout qualifiers of the compute shader
+static const GLuint BLOCKS_BINDING = 1;
+static const GLuint MESH_DRAWS_BINDING = 2;
+static const GLuint MESH_VERTICES_BINDING = 3;
+static const GLuint MESH_INDICES_BINDING = 4;
+
+static const int DRAW_COMMAND_WORDS = 5;	// DrawElementsIndirectCommand
+static const int MAX_WORKGROUPS_PER_DISPATCH = 65535;	// the least GL_MAX_COMPUTE_WORK_GROUP_COUNT allowed
+
+// replaces the buffer with a bigger one, keeping the start of it in place: the draw commands point into it by offset
+static void growBuffer(GLuint& bufferId, GLsizeiptr bytes, GLsizeiptr keptBytes)
+{
+	GLuint grownBufferId;
+	glGenBuffers(1, &grownBufferId);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, grownBufferId);
+	glBufferData(GL_COPY_WRITE_BUFFER, bytes, 0, GL_DYNAMIC_COPY);
+
+	if (keptBytes > 0) {
+		glBindBuffer(GL_COPY_READ_BUFFER, bufferId);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, keptBytes);
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	glDeleteBuffers(1, &bufferId);
+	bufferId = grownBufferId;
+}
+
+SurfaceMesh::SurfaceMesh(GLuint visualizationProgramId, bool allowComputeExtraction) : _visualizationProgramId(visualizationProgramId), _extractProgramId(0),
+	_vertexBufferId(0), _indexBufferId(0), _vertexCapacity(0), _indexCapacity(0), _numVertices(0), _numIndices(0),
+	_lastUpdateVertices(0), _lastUpdateIndices(0), _blockBufferId(0), _meshDrawBufferId(0), _meshCountBufferId(0),
+	_worldSize(0, 0, 0), _sizeInBlocks(0, 0, 0), _valid(false), _tick(0), _lastUpdatePending(false), _lastUpdateComplete(false)
+{
+	_meshProgramId = glCreateProgram();
+	Utils::initializeShader(_meshProgramId, "visualization_mesh_vertex.glsl", GL_VERTEX_SHADER);
+	Utils::initializeShader(_meshProgramId, "visualization_fragment.glsl", GL_FRAGMENT_SHADER);
+
+	glBindAttribLocation(_meshProgramId, SlotPosition, "meshPosition");
+	glBindAttribLocation(_meshProgramId, SlotNormal, "meshNormal");
+	glBindAttribLocation(_meshProgramId, SlotColor, "meshColor");
+
+	glLinkProgram(_meshProgramId);
+
+	Utils::logProgramLinkError(_meshProgramId);
+
+	glGenBuffers(1, &_vertexBufferId);
+
+	if (GLEW_VERSION_4_3 && allowComputeExtraction) {
+		_extractProgramId = Utils::createComputeProgram("visualization_extract_compute.glsl");
+		printf("_extractProgramId: %d\n", _extractProgramId);
+
+		GLuint nothingExtracted[2] = { 0, 0 };
+		glGenBuffers(1, &_meshCountBufferId);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, _meshCountBufferId);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(nothingExtracted), nothingExtracted, GL_DYNAMIC_COPY);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+		glGenBuffers(1, &_indexBufferId);
+		glGenBuffers(1, &_blockBufferId);
+		glGenBuffers(1, &_meshDrawBufferId);
+
+		reserve(INITIAL_VERTEX_CAPACITY, INITIAL_INDEX_CAPACITY, false);
+	} else {
+		if (!GLEW_VERSION_4_3) {
+			printf("no OpenGL 4.3, the visualization runs marching cubes on every voxel whenever the world changes\n");
+		}
+
+		reserve(INITIAL_VERTEX_CAPACITY, 0, false);
+	}
+
+	glGenQueries(1, &_generatedQueryId);
+}
+
+void SurfaceMesh::captureVaryings(GLuint visualizationProgramId)
+{
+	static const char* varyings[] = { "meshPosition", "meshNormal", "meshColor" };
+	glTransformFeedbackVaryings(visualizationProgramId, 3, varyings, GL_INTERLEAVED_ATTRIBS);
+}
+
+void SurfaceMesh::reserve(unsigned int numVertices, unsigned int numIndices, bool keepMesh)
+{
+	if (numVertices > _vertexCapacity) {
+		growBuffer(_vertexBufferId, numVertices * VERTEX_BYTES, keepMesh ? _numVertices * VERTEX_BYTES : 0);
+		_vertexCapacity = numVertices;
+		printf("surface mesh grown to %u vertices\n", _vertexCapacity);
+	}
+
+	if (numIndices > _indexCapacity) {
+		growBuffer(_indexBufferId, numIndices * sizeof(GLuint), keepMesh ? _numIndices * sizeof(GLuint) : 0);
+		_indexCapacity = numIndices;
+		printf("surface mesh grown to %u indices\n", _indexCapacity);
+	}
+}
+
+void SurfaceMesh::reset(glm::ivec3 worldSize)
+{
+	_worldSize = worldSize;
+	_sizeInBlocks = (worldSize + WORLD_BRICK_SIZE - 1) / WORLD_BRICK_SIZE;
+
+	int numBlocks = _sizeInBlocks.x * _sizeInBlocks.y * _sizeInBlocks.z;
+	_blockChanged.assign(numBlocks, 0);
+	_changedBlocks.clear();
+
+	if (_extractProgramId != 0) {
+		std::vector<GLuint> noDraws(numBlocks * DRAW_COMMAND_WORDS, 0);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _meshDrawBufferId);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, noDraws.size() * sizeof(GLuint), &noDraws[0], GL_DYNAMIC_COPY);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+
+	_numVertices = 0;
+	_numIndices = 0;
+	_lastUpdateVertices = 0;
+	_lastUpdateIndices = 0;
+	_lastUpdatePending = false;	// whatever it found belongs to the old world
+	invalidate();
+}
+
+void SurfaceMesh::invalidate()
+{
+	_valid = false;
+}
+
+bool SurfaceMesh::beginUpdate()
+{
+	if (_lastUpdatePending) {
+		_lastUpdatePending = false;
+
+		GLuint extracted[2] = { 0, 0 };	// vertices, indices
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, _meshCountBufferId);
+		glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(extracted), extracted);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+		if (_numVertices + extracted[0] > _vertexCapacity || _numIndices + extracted[1] > _indexCapacity) {
+			// that frame drew the blocks that didn't fit as empty, and the mesh would keep them that way; if the
+			// whole surface didn't fit, it goes into buffers twice its size
+			if (_lastUpdateComplete) {
+				reserve(2 * extracted[0], 2 * extracted[1], false);
+			}
+			invalidate();
+		} else {
+			_numVertices += extracted[0];
+			_numIndices += extracted[1];
+			_lastUpdateVertices = extracted[0];
+			_lastUpdateIndices = extracted[1];
+
+			// half the buffers free after extracting the whole surface, so it takes a few updates to fill them up again
+			if (_lastUpdateComplete) {
+				reserve(2 * _numVertices, 2 * _numIndices, true);
+			}
+		}
+	}
+
+	// no room for another update like the last one, so start over, which drops the stale runs
+	if (_extractProgramId != 0 &&
+		(_numVertices + _lastUpdateVertices > _vertexCapacity || _numVertices == _vertexCapacity ||
+		_numIndices + _lastUpdateIndices > _indexCapacity || _numIndices == _indexCapacity)) {
+		invalidate();
+	}
+
+	return !_valid;
+}
+
+void SurfaceMesh::markBrickChanged(glm::ivec3 brickCoord)
+{
+	// the cubes reach one voxel past their block, so the blocks before the brick along each axis see it too
+	for (int i = 0; i < 8; i++) {
+		glm::ivec3 block = brickCoord - glm::ivec3(i & 1, (i >> 1) & 1, i >> 2);
+		if (block.x < 0 || block.y < 0 || block.z < 0) {
+			continue;
+		}
+
+		GLuint blockIndex = (GLuint)(block.x + _sizeInBlocks.x * (block.y + _sizeInBlocks.y * block.z));
+		if (!_blockChanged[blockIndex]) {
+			_blockChanged[blockIndex] = 1;
+			_changedBlocks.push_back(blockIndex);
+		}
+	}
+}
+
+// the changed blocks, appended past the mesh so far; the next beginUpdate() reads back how much they took
+void SurfaceMesh::extractBlocks(glm::ivec3 atlasSizeInBricks, unsigned int worldTick, float trailOpacity, float trailDissipationPerFrame)
+{
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, _blockBufferId);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, _changedBlocks.size() * sizeof(GLuint), &_changedBlocks[0], GL_STREAM_DRAW);
+
+	GLuint nothingExtracted[2] = { 0, 0 };
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, _meshCountBufferId);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(nothingExtracted), nothingExtracted);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	glUseProgram(_extractProgramId);
+
+	glUniform1i(glGetUniformLocation(_extractProgramId, "worldTrailTexture"), 0);	// set to GL_TEXTURE0
+	glUniform1i(glGetUniformLocation(_extractProgramId, "worldFoodTexture"), 5);	// set to GL_TEXTURE5
+	glUniform1i(glGetUniformLocation(_extractProgramId, "worldTerrainTexture"), 6);	// set to GL_TEXTURE6
+	glUniform1i(glGetUniformLocation(_extractProgramId, "worldPageTexture"), 4);	// set to GL_TEXTURE4
+	glUniform1i(glGetUniformLocation(_extractProgramId, "triangleTableTexture"), 2);	// set to GL_TEXTURE2
+	glUniform3i(glGetUniformLocation(_extractProgramId, "worldAtlasSizeInBricks"), atlasSizeInBricks.x, atlasSizeInBricks.y, atlasSizeInBricks.z);
+	glUniform3i(glGetUniformLocation(_extractProgramId, "worldSize"), _worldSize.x, _worldSize.y, _worldSize.z);
+	glUniform3f(glGetUniformLocation(_extractProgramId, "voxelSize"), 2.0f / _worldSize.x, 2.0f / _worldSize.y, 2.0f / _worldSize.z);
+	glUniform1ui(glGetUniformLocation(_extractProgramId, "worldTick"), worldTick);
+	glUniform1f(glGetUniformLocation(_extractProgramId, "trailDissipationPerFrame"), trailDissipationPerFrame);
+	glUniform1f(glGetUniformLocation(_extractProgramId, "trailOpacity"), trailOpacity);
+	glUniform1ui(glGetUniformLocation(_extractProgramId, "vertexBase"), _numVertices);
+	glUniform1ui(glGetUniformLocation(_extractProgramId, "indexBase"), _numIndices);
+	glUniform1ui(glGetUniformLocation(_extractProgramId, "vertexCapacity"), _vertexCapacity);
+	glUniform1ui(glGetUniformLocation(_extractProgramId, "indexCapacity"), _indexCapacity);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MESH_COUNT_BINDING, _meshCountBufferId);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BLOCKS_BINDING, _blockBufferId);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MESH_DRAWS_BINDING, _meshDrawBufferId);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MESH_VERTICES_BINDING, _vertexBufferId);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MESH_INDICES_BINDING, _indexBufferId);
+
+	// one workgroup per block
+	int numBlocks = (int)_changedBlocks.size();
+	for (int firstBlock = 0; firstBlock < numBlocks; firstBlock += MAX_WORKGROUPS_PER_DISPATCH) {
+		glUniform1ui(glGetUniformLocation(_extractProgramId, "firstBlock"), firstBlock);
+		glDispatchCompute(glm::min(numBlocks - firstBlock, MAX_WORKGROUPS_PER_DISPATCH), 1, 1);
+	}
+
+	// the mesh is drawn with the commands and the buffers the pass wrote
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_ELEMENT_ARRAY_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+	glUseProgram(0);
+}
+
+// every voxel of the world through the geometry shader, reading back how many triangles came out right away, and
+// extracting again into a bigger buffer if they didn't fit
+void SurfaceMesh::extractEverything()
+{
+	glUseProgram(_visualizationProgramId);
+
+	glDisableVertexAttribArray(SlotPosition);	// the vertex shader fetches no attributes
+	glEnable(GL_RASTERIZER_DISCARD);
+
+	while (true) {
+		glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, _vertexBufferId);
+		glBeginQuery(GL_PRIMITIVES_GENERATED, _generatedQueryId);
+		glBeginTransformFeedback(GL_TRIANGLES);
+		glDrawArrays(GL_POINTS, 0, _worldSize.x * _worldSize.y * _worldSize.z);
+		glEndTransformFeedback();
+		glEndQuery(GL_PRIMITIVES_GENERATED);
+		glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+
+		GLuint generatedTriangles = 0;
+		glGetQueryObjectuiv(_generatedQueryId, GL_QUERY_RESULT, &generatedTriangles);
+		if (3 * generatedTriangles <= _vertexCapacity) {
+			_numVertices = 3 * generatedTriangles;
+			_lastUpdateVertices = _numVertices;
+			break;
+		}
+
+		reserve(2 * 3 * generatedTriangles, 0, false);
+	}
+
+	glDisable(GL_RASTERIZER_DISCARD);
+	glEnableVertexAttribArray(SlotPosition);
+
+	glUseProgram(0);
+}
+
+void SurfaceMesh::update(glm::ivec3 atlasSizeInBricks, unsigned int worldTick, float trailOpacity, float trailDissipationPerFrame)
+{
+	bool complete = !_valid;
+	_valid = true;
+	_tick = worldTick;
+
+	if (_extractProgramId == 0) {
+		if (complete || !_changedBlocks.empty()) {
+			extractEverything();
+		}
+	} else {
+		if (complete) {
+			_numVertices = 0;
+			_numIndices = 0;
+
+			GLuint noDraws = 0;
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _meshDrawBufferId);
+			glClearBufferData(GL_DRAW_INDIRECT_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &noDraws);
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		}
+
+		if (!_changedBlocks.empty()) {
+			extractBlocks(atlasSizeInBricks, worldTick, trailOpacity, trailDissipationPerFrame);
+
+			_lastUpdatePending = true;
+			_lastUpdateComplete = complete;
+		}
+	}
+
+	for (size_t i = 0; i < _changedBlocks.size(); i++) {
+		_blockChanged[_changedBlocks[i]] = 0;
+	}
+	_changedBlocks.clear();
+}
+
+unsigned int SurfaceMesh::tick() const
+{
+	return _tick;
+}
+
+unsigned int SurfaceMesh::lastUpdateTriangles() const
+{
+	return (_extractProgramId != 0) ? _lastUpdateIndices / 3 : _lastUpdateVertices / 3;
+}
+
+void SurfaceMesh::draw()
+{
+	glUseProgram(_meshProgramId);
+
+	glBindBuffer(GL_ARRAY_BUFFER, _vertexBufferId);
+	glVertexAttribPointer(SlotPosition, 3, GL_FLOAT, GL_FALSE, VERTEX_BYTES, (const GLvoid*)0);
+	glVertexAttribPointer(SlotNormal, 3, GL_FLOAT, GL_FALSE, VERTEX_BYTES, (const GLvoid*)(3 * sizeof(GLfloat)));
+	glVertexAttribPointer(SlotColor, 4, GL_FLOAT, GL_FALSE, VERTEX_BYTES, (const GLvoid*)(6 * sizeof(GLfloat)));
+	glEnableVertexAttribArray(SlotNormal);
+	glEnableVertexAttribArray(SlotColor);
+
+	if (_extractProgramId != 0) {
+		// every block's latest run; the blocks without triangles have empty commands
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBufferId);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _meshDrawBufferId);
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, 0, _sizeInBlocks.x * _sizeInBlocks.y * _sizeInBlocks.z, 0);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	} else {
+		glDrawArrays(GL_TRIANGLES, 0, _numVertices);
+	}
+
+	glDisableVertexAttribArray(SlotNormal);
+	glDisableVertexAttribArray(SlotColor);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glUseProgram(0);
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#define GLEW_STATIC 1
+#include <GL/glew.h>
+#include <vector>
+#include <glm/glm.hpp>
+
+// The marching-cubes surfaces, extracted into a mesh that is drawn again every frame (through
+// visualization_mesh_vertex.glsl) until the world changes, so turning the camera on a world that doesn't tick costs a
+// draw call and no extraction. The mesh is made of 8x8x8 blocks of cubes, which line up with the bricks; a block has to
+// be extracted again when one of the bricks its corners lie in changed. With OpenGL 4.3 only those blocks are: a
+// compute pass (visualization_extract_compute.glsl) runs marching cubes on them and appends an indexed mesh per block
+// to the vertex and index buffers, past those of the previous updates, welding the vertices of each block so that every
+// crossed edge has one, with a normal from the gradient of the field. Every block of the world has an indirect draw
+// command pointing at its latest run, which the pass writes itself, so the whole mesh is one glMultiDrawElementsIndirect
+// and the host never waits for the counts. Once the stale runs fill a buffer, the whole surface is extracted again from
+// the start. Without OpenGL 4.3, the geometry shader extracts separate triangles with flat normals, captured with
+// transform feedback, over the whole surface whenever anything changed. Needs a current context.
+class SurfaceMesh
+{
+public:
+	// the visualization program extracts the triangles without OpenGL 4.3, or when allowComputeExtraction is false; it
+	// has to have been linked after captureVaryings()
+	SurfaceMesh(GLuint visualizationProgramId, bool allowComputeExtraction = true);
+
+	static void captureVaryings(GLuint visualizationProgramId);
+
+	void reset(glm::ivec3 worldSize);	// empties the mesh; the next update extracts the whole surface
+	void invalidate();	// the next update extracts the whole surface, e.g. after a setting every triangle depends on changed
+
+	// reads back what the last update extracted, which is long done by the next frame. Returns true if this update
+	// has to extract the whole surface: after reset() or invalidate(), when part of the last update didn't fit, or when
+	// the buffers have no room left for another update like it. Every resident brick has to be marked changed then
+	bool beginUpdate();
+
+	// the cells of the brick may read differently than at tick()
+	void markBrickChanged(glm::ivec3 brickCoord);
+
+	// extracts the blocks around the bricks marked changed, from the world textures bound for display: trail layer on
+	// GL_TEXTURE0, food layer on GL_TEXTURE5, terrain layer on GL_TEXTURE6, page table on GL_TEXTURE4, and the triangle
+	// table on GL_TEXTURE2. Without OpenGL 4.3 that goes through the visualization program, whose uniforms have to be
+	// set for the world at worldTick
+	void update(glm::ivec3 atlasSizeInBricks, unsigned int worldTick, float trailOpacity, float trailDissipationPerFrame);
+
+	unsigned int tick() const;	// the tick of the world the mesh shows
+
+	// how many triangles the last update that fit extracted, once beginUpdate() has read them back; the geometry
+	// shader's are counted right away, with a GL_PRIMITIVES_GENERATED query
+	unsigned int lastUpdateTriangles() const;
+
+	void draw();
+
+private:
+	void reserve(unsigned int numVertices, unsigned int numIndices, bool keepMesh);
+	void extractBlocks(glm::ivec3 atlasSizeInBricks, unsigned int worldTick, float trailOpacity, float trailDissipationPerFrame);
+	void extractEverything();
+
+	GLuint _visualizationProgramId;
+	GLuint _meshProgramId;	// visualization_mesh_vertex.glsl and visualization_fragment.glsl
+	GLuint _extractProgramId;	// 0 without OpenGL 4.3
+
+	GLuint _vertexBufferId;	// interleaved position, normal and colour
+	GLuint _indexBufferId;	// per block, from its first vertex; none without OpenGL 4.3, where every triangle has its own vertices
+	unsigned int _vertexCapacity;
+	unsigned int _indexCapacity;
+	unsigned int _numVertices;	// extracted so far, stale runs included
+	unsigned int _numIndices;
+	unsigned int _lastUpdateVertices;
+	unsigned int _lastUpdateIndices;
+
+	GLuint _blockBufferId;	// the blocks of the last update
+	GLuint _meshDrawBufferId;	// DrawElementsIndirectCommand per block of the world
+	GLuint _meshCountBufferId;	// the vertices and indices of the last update, whether they fit or not
+	GLuint _generatedQueryId;	// without OpenGL 4.3, where the count is read back right away
+
+	glm::ivec3 _worldSize;
+	glm::ivec3 _sizeInBlocks;
+	std::vector<unsigned char> _blockChanged;
+	std::vector<GLuint> _changedBlocks;	// x fastest over the blocks of the world, in the order they were marked
+
+	bool _valid;
+	unsigned int _tick;
+	bool _lastUpdatePending;	// extracted, not read back yet
+	bool _lastUpdateComplete;	// extracted the whole surface
+};
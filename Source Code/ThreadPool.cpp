@@ -0,0 +1,107 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(int numThreads) : _currentFunction(0), _currentCount(0), _generation(0), _pendingWorkers(0), _shuttingDown(false)
+{
+	if (numThreads <= 0) {
+		numThreads = std::thread::hardware_concurrency();
+	}
+	if (numThreads <= 0) {
+		numThreads = 1;
+	}
+
+	// the calling thread does the first chunk itself, so only start numThreads-1 workers
+	for (int i = 1; i < numThreads; i++) {
+		_workers.push_back(std::thread(&ThreadPool::workerLoop, this, i));
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_shuttingDown = true;
+	}
+	_workAvailable.notify_all();
+
+	for (size_t i = 0; i < _workers.size(); i++) {
+		_workers[i].join();
+	}
+}
+
+int ThreadPool::numThreads() const
+{
+	return (int)_workers.size() + 1;
+}
+
+static void chunkBounds(int count, int numChunks, int chunkIndex, int* begin, int* end)
+{
+	*begin = (int)(((long long)count * chunkIndex) / numChunks);
+	*end = (int)(((long long)count * (chunkIndex + 1)) / numChunks);
+}
+
+void ThreadPool::parallelFor(int count, const RangeFunction& fn)
+{
+	if (count <= 0) {
+		return;
+	}
+
+	if (_workers.empty()) {
+		fn(0, count);
+		return;
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_currentFunction = &fn;
+		_currentCount = count;
+		_pendingWorkers = (int)_workers.size();
+		_generation++;
+	}
+	_workAvailable.notify_all();
+
+	int begin, end;
+	chunkBounds(count, numThreads(), 0, &begin, &end);
+	if (begin < end) {
+		fn(begin, end);
+	}
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (_pendingWorkers > 0) {
+		_workDone.wait(lock);
+	}
+	_currentFunction = 0;
+}
+
+void ThreadPool::workerLoop(int workerIndex)
+{
+	unsigned int lastGeneration = 0;
+
+	while (true) {
+		const RangeFunction* fn;
+		int count;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			while (!_shuttingDown && _generation == lastGeneration) {
+				_workAvailable.wait(lock);
+			}
+			if (_shuttingDown) {
+				return;
+			}
+			lastGeneration = _generation;
+			fn = _currentFunction;
+			count = _currentCount;
+		}
+
+		int begin, end;
+		chunkBounds(count, numThreads(), workerIndex, &begin, &end);
+		if (begin < end) {
+			(*fn)(begin, end);
+		}
+
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_pendingWorkers--;
+		}
+		_workDone.notify_one();
+	}
+}
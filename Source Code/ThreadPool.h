@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+// fixed set of worker threads that split a range of work items into contiguous chunks,
+// e.g. slices of the ant array or lists of touched voxels
+class ThreadPool
+{
+public:
+	typedef std::function<void(int begin, int end)> RangeFunction;
+
+	ThreadPool(int numThreads = 0);	// 0 = one thread per hardware core
+	~ThreadPool();
+
+	int numThreads() const;
+
+	// call fn(begin, end) on disjoint chunks covering [0, count), one chunk per thread; blocks until all chunks are done
+	void parallelFor(int count, const RangeFunction& fn);
+
+private:
+	void workerLoop(int workerIndex);
+
+	std::vector<std::thread> _workers;
+
+	std::mutex _mutex;
+	std::condition_variable _workAvailable;
+	std::condition_variable _workDone;
+
+	const RangeFunction* _currentFunction;
+	int _currentCount;
+	unsigned int _generation;	// incremented for each parallelFor call so workers know there is new work
+	int _pendingWorkers;
+	bool _shuttingDown;
+};
@@ -0,0 +1,42 @@
+#include "TickScheduler.h"
+#include <algorithm>
+
+TickScheduler::TickScheduler(int maxBacklogTicks) : _ticked(false), _lastTickDue(), _maxBacklogTicks(maxBacklogTicks)
+{
+}
+
+TickScheduler::Clock::duration TickScheduler::toDuration(double seconds)
+{
+	return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(std::max(seconds, 0.0)));
+}
+
+void TickScheduler::reset(Clock::time_point now)
+{
+	_ticked = false;
+	_lastTickDue = now;
+}
+
+TickScheduler::Clock::time_point TickScheduler::nextTickDue(double intervalSeconds) const
+{
+	if (!_ticked) {
+		return _lastTickDue;
+	}
+	return _lastTickDue + toDuration(intervalSeconds);
+}
+
+bool TickScheduler::tickDue(double intervalSeconds, Clock::time_point now) const
+{
+	return now >= nextTickDue(intervalSeconds);
+}
+
+void TickScheduler::tickDone(double intervalSeconds, Clock::time_point now)
+{
+	if (!_ticked) {
+		_ticked = true;
+		_lastTickDue = now;
+		return;
+	}
+
+	Clock::duration interval = toDuration(intervalSeconds);
+	_lastTickDue = std::max(_lastTickDue + interval, now - interval * _maxBacklogTicks);
+}
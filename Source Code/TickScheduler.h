@@ -0,0 +1,28 @@
+#pragma once
+
+#include <chrono>
+
+// Paces something that should happen every interval of wall time (std::chrono::steady_clock): simulation ticks, or
+// displayed frames. Each tick falls due one interval after the previous one was due, not after it ran, so the rate
+// holds even when ticks take a while. A caller that falls behind runs the ticks that fell due back to back to catch
+// up, but never more than maxBacklogTicks of them; beyond that the backlog is dropped, so a rate that can't be kept
+// up doesn't snowball. The interval is given on every call, so it can change at any time.
+class TickScheduler
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	TickScheduler(int maxBacklogTicks = 0);
+
+	void reset(Clock::time_point now);	// the next tick is due right away
+	Clock::time_point nextTickDue(double intervalSeconds) const;
+	bool tickDue(double intervalSeconds, Clock::time_point now) const;
+	void tickDone(double intervalSeconds, Clock::time_point now);	// after running the tick that was due
+
+private:
+	static Clock::duration toDuration(double seconds);
+
+	bool _ticked;	// false until the first tick after reset(), which is due right away
+	Clock::time_point _lastTickDue;
+	int _maxBacklogTicks;
+};
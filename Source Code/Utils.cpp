@@ -112,20 +112,125 @@ void Utils::doOpenGLErrorCheck(bool success, char * errorMessage)
 	}
 }
 
-void Utils::updateTextureSize(GLuint textureId, glm::ivec3 volumeSize) {
+bool Utils::isIntegerTextureFormat(GLenum internalFormat) {
+	return internalFormat == GL_RG16UI || internalFormat == GL_R16UI || internalFormat == GL_R8UI || internalFormat == GL_R32UI;
+}
+
+void Utils::updateTextureSize(GLuint textureId, glm::ivec3 volumeSize, GLenum internalFormat) {
 	glBindTexture(GL_TEXTURE_3D, textureId);
 
+	// integer textures are incomplete with linear filtering (they are only read with texelFetch anyway)
+	GLint filter = isIntegerTextureFormat(internalFormat) ? GL_NEAREST : GL_LINEAR;
+
 	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, filter);
+
+	GLenum format = GL_RGBA;
+	GLenum type = GL_FLOAT;
+	if (internalFormat == GL_RG16UI) {
+		format = GL_RG_INTEGER;	// world trail layer
+		type = GL_UNSIGNED_SHORT;
+	} else if (internalFormat == GL_R16UI) {
+		format = GL_RED_INTEGER;	// world food layer
+		type = GL_UNSIGNED_SHORT;
+	} else if (internalFormat == GL_R8UI) {
+		format = GL_RED_INTEGER;	// world terrain layer
+		type = GL_UNSIGNED_BYTE;
+	} else if (internalFormat == GL_R32UI) {
+		format = GL_RED_INTEGER;	// ant counts of the compute backend
+		type = GL_UNSIGNED_INT;
+	}
 
-	glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA32F, volumeSize.x, volumeSize.y, volumeSize.z, 0, GL_RGBA, GL_FLOAT, 0);
+	glTexImage3D(GL_TEXTURE_3D, 0, internalFormat, volumeSize.x, volumeSize.y, volumeSize.z, 0, format, type, 0);
 
 	doOpenGLErrorCheck(glGetError() == GL_NO_ERROR, "volume texture creation failed");
 }
 
+GLuint Utils::createPageTexture(glm::ivec3 pageTableSize) {
+	GLuint textureId;
+	glGenTextures(1, &textureId);
+
+	updatePageTextureSize(textureId, pageTableSize);
+
+	return textureId;
+}
+
+void Utils::updatePageTextureSize(GLuint textureId, glm::ivec3 pageTableSize) {
+	glBindTexture(GL_TEXTURE_3D, textureId);
+
+	// integer texture of atlas slots, only ever read with texelFetch
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	glTexImage3D(GL_TEXTURE_3D, 0, GL_R32I, pageTableSize.x, pageTableSize.y, pageTableSize.z, 0, GL_RED_INTEGER, GL_INT, 0);
+
+	doOpenGLErrorCheck(glGetError() == GL_NO_ERROR, "page table texture creation failed");
+}
+
+void Utils::uploadPageTable(GLuint textureId, glm::ivec3 pageTableSize, const int* entries) {
+	glBindTexture(GL_TEXTURE_3D, textureId);
+
+	glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, 0, pageTableSize.x, pageTableSize.y, pageTableSize.z, GL_RED_INTEGER, GL_INT, entries);
+
+	doOpenGLErrorCheck(glGetError() == GL_NO_ERROR, "page table upload failed");
+}
+
+void Utils::uploadPageTableEntry(GLuint textureId, glm::ivec3 entryCoord, int slot) {
+	glBindTexture(GL_TEXTURE_3D, textureId);
+
+	glTexSubImage3D(GL_TEXTURE_3D, 0, entryCoord.x, entryCoord.y, entryCoord.z, 1, 1, 1, GL_RED_INTEGER, GL_INT, &slot);
+}
+
+// the trail layer is the first 32-bit word of a WorldCell, the food and terrain layers one 16-bit half each of the
+// second; the terrain only keeps the low byte
+void Utils::uploadWorldCells(GLuint trailTextureId, GLuint foodTextureId, GLuint terrainTextureId, glm::ivec3 offset, glm::ivec3 size, const WorldCell* cells) {
+	size_t numCells = (size_t)size.x * size.y * size.z;
+	std::vector<unsigned int> trailWords(numCells);
+	std::vector<unsigned short> foodValues(numCells);
+	std::vector<unsigned char> terrainValues(numCells);
+
+	for (size_t i = 0; i < numCells; i++) {
+		trailWords[i] = cells[i].trailAnts | ((unsigned int)cells[i].tick << 16);
+		foodValues[i] = cells[i].food;
+		terrainValues[i] = (unsigned char)cells[i].terrain;
+	}
+
+	glBindTexture(GL_TEXTURE_3D, trailTextureId);
+	glTexSubImage3D(GL_TEXTURE_3D, 0, offset.x, offset.y, offset.z, size.x, size.y, size.z, GL_RG_INTEGER, GL_UNSIGNED_SHORT, &trailWords[0]);
+
+	glBindTexture(GL_TEXTURE_3D, foodTextureId);
+	glTexSubImage3D(GL_TEXTURE_3D, 0, offset.x, offset.y, offset.z, size.x, size.y, size.z, GL_RED_INTEGER, GL_UNSIGNED_SHORT, &foodValues[0]);
+
+	// rows of single bytes aren't padded to 4 bytes
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glBindTexture(GL_TEXTURE_3D, terrainTextureId);
+	glTexSubImage3D(GL_TEXTURE_3D, 0, offset.x, offset.y, offset.z, size.x, size.y, size.z, GL_RED_INTEGER, GL_UNSIGNED_BYTE, &terrainValues[0]);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+void Utils::uploadBrick(GLuint trailTextureId, GLuint foodTextureId, GLuint terrainTextureId, glm::ivec3 atlasBrickCoord, const WorldCell* cells) {
+	uploadWorldCells(trailTextureId, foodTextureId, terrainTextureId, atlasBrickCoord * WORLD_BRICK_SIZE, glm::ivec3(WORLD_BRICK_SIZE), cells);
+}
+
+void Utils::waitForFence(GLsync fence) {
+	static const GLuint64 waitNanoseconds = 1000000;
+
+	// flush once, so the fence gets to the GPU, then keep waiting; it is a readback the simulation can't go on without
+	GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, waitNanoseconds);
+	while (status == GL_TIMEOUT_EXPIRED) {
+		status = glClientWaitSync(fence, 0, waitNanoseconds);
+	}
+	doOpenGLErrorCheck(status != GL_WAIT_FAILED, "waiting for a fence failed");
+
+	glDeleteSync(fence);
+}
+
 PingPong Utils::updatePingPongSize(PingPong pingPong, glm::ivec3 volumeSize) {
 	updateTextureSize(pingPong.previous.textureId, volumeSize);
 	pingPong.previous.volumeSize = volumeSize;
@@ -138,7 +243,7 @@ PingPong Utils::updatePingPongSize(PingPong pingPong, glm::ivec3 volumeSize) {
 	return pingPong;
 }
 
-Volume Utils::createVolume(glm::ivec3 volumeSize) 
+Volume Utils::createVolume(glm::ivec3 volumeSize, GLenum internalFormat) 
 {
 	printf("creating volume of size %d x %d x %d\n", volumeSize.x, volumeSize.y, volumeSize.z);
 
@@ -153,22 +258,25 @@ Volume Utils::createVolume(glm::ivec3 volumeSize)
 	GLuint textureId;
 	glGenTextures(1, &textureId);
 
-	updateTextureSize(textureId, volumeSize);
+	updateTextureSize(textureId, volumeSize, internalFormat);
 
-	printf("creating render buffer\n");
+	printf("attaching texture to FBO\n");
 
-	GLuint renderBufferId;
-	glGenRenderbuffers(1, &renderBufferId);
-	glBindRenderbuffer(GL_RENDERBUFFER, renderBufferId);
-	glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, renderBufferId, 0);
+	// layered attachment, so the geometry shader can route each quad to a slice with gl_Layer
+	glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, textureId, 0);
 
-	doOpenGLErrorCheck(glGetError() == GL_NO_ERROR, "attaching render buffer failed");
+	doOpenGLErrorCheck(glGetError() == GL_NO_ERROR, "attaching volume texture failed");
 
 	doOpenGLErrorCheck(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE, "failed to create FBO");
 
-	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	if (isIntegerTextureFormat(internalFormat)) {
+		GLuint zero[4] = { 0, 0, 0, 0 };
+		glClearBufferuiv(GL_COLOR, 0, zero);	// glClear is undefined on integer color buffers
+	} else {
+		glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
 
-	glClear(GL_COLOR_BUFFER_BIT);
+		glClear(GL_COLOR_BUFFER_BIT);
+	}
 
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
@@ -208,4 +316,17 @@ GLuint Utils::createSimulationProgram(char * vsFile, char * gsFile, char * fsFil
 	Utils::logProgramValidationError(simulationProgramId);
 
 	return simulationProgramId;
+}
+
+GLuint Utils::createComputeProgram(char * csFile)
+{
+	GLuint computeProgramId = glCreateProgram();
+
+	Utils::initializeShader(computeProgramId, csFile, GL_COMPUTE_SHADER);
+
+	glLinkProgram(computeProgramId);
+
+	Utils::logProgramLinkError(computeProgramId);
+
+	return computeProgramId;
 }
\ No newline at end of file
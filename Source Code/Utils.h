@@ -4,8 +4,15 @@
 #include <GL/glew.h>
 #include <GL/glut.h>
 #include <string>
+#include <vector>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include "BrickedWorld.h"
+
+// the world atlas keeps each layer of the WorldCells in a texture of its own
+static const GLenum WORLD_TRAIL_TEXTURE_FORMAT = GL_RG16UI;	// trail or ants, and tick
+static const GLenum WORLD_FOOD_TEXTURE_FORMAT = GL_R16UI;
+static const GLenum WORLD_TERRAIN_TEXTURE_FORMAT = GL_R8UI;	// static, only written by brick uploads
 
 struct Volume {
 	GLuint fboId;
@@ -19,7 +26,9 @@ struct PingPong {
 };
 
 enum AttributeSlot {
-	SlotPosition
+	SlotPosition,
+	SlotNormal,	// of the surface mesh, see SurfaceMesh.h
+	SlotColor
 };
 
 class Utils
@@ -31,22 +40,42 @@ public:
 
 	static GLuint initializeQuadVBO();
 
-	static Volume createVolume(glm::ivec3 volumeSize);
+	static Volume createVolume(glm::ivec3 volumeSize, GLenum internalFormat = GL_RGBA32F);
 
 	static void doOpenGLErrorCheck(bool success, char * errorMessage);
 
 	static GLuint createSimulationProgram(char * vsFile, char * gsFile, char * fsFile);
 
+	static GLuint createComputeProgram(char * csFile);	// needs GL 4.3
+
 	static void swapPingPong(PingPong* pingPong);
 
 	static PingPong createPingPong(glm::ivec3 volumeSize);
 
 	static PingPong updatePingPongSize(PingPong pingPong, glm::ivec3 volumeSize);
 
+	static void updateTextureSize(GLuint textureId, glm::ivec3 volumeSize, GLenum internalFormat = GL_RGBA32F);
+
+	static GLuint createPageTexture(glm::ivec3 pageTableSize);
+
+	static void updatePageTextureSize(GLuint textureId, glm::ivec3 pageTableSize);
+
+	static void uploadPageTable(GLuint textureId, glm::ivec3 pageTableSize, const int* entries);
+
+	static void uploadPageTableEntry(GLuint textureId, glm::ivec3 entryCoord, int slot);
+
+	// the world atlas is three textures, one per layer of the cells (see WorldCell.h); cells are in x-fastest order
+	static void uploadWorldCells(GLuint trailTextureId, GLuint foodTextureId, GLuint terrainTextureId, glm::ivec3 offset, glm::ivec3 size, const WorldCell* cells);
+
+	static void uploadBrick(GLuint trailTextureId, GLuint foodTextureId, GLuint terrainTextureId, glm::ivec3 atlasBrickCoord, const WorldCell* cells);
+
+	// blocks until the commands before the fence are done, then deletes it
+	static void waitForFence(GLsync fence);
+
 private:
 	static int loadShaderSource(char* filename, std::string& text);
 
-	static void updateTextureSize(GLuint textureId, glm::ivec3 volumeSize);
+	static bool isIntegerTextureFormat(GLenum internalFormat);
 
 };
 
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+// One world voxel packed into 64 bits, as three layers that the GL atlas keeps in separate textures (see
+// Utils::uploadWorldCells), so each pass only writes the layer it changes. The shaders decode them with the same bit
+// layout (see decodeWorldCell / encodeTrailLayer / encodeFoodLayer in simulation_world_fragment.glsl and
+// simulation_food_fragment.glsl):
+// trail layer (GL_RG16UI), dynamic, rewritten in every voxel in or around an ant:
+//   trailAnts = bit 15 clear: trail strength when the cell was last reinforced, 15-bit unorm; it decays lazily from the
+//               tick below. bit 15 set: ants stood in the cell at that tick, which leaves the trail at full strength,
+//               and bits 0-6 count them (saturating)
+//   tick      = low 16 bits of the tick the cell was last reinforced (see restampWorldCell)
+// food layer (GL_R16UI), only rewritten where an ant stands:
+//   food      = signed 8.8 fixed point, saturating (it goes below zero where ants have been without finding food)
+// terrain layer (GL_R8UI), static, only written when a brick is uploaded:
+//   terrain   = bit 0: nest
+// An all-zero cell is empty space. Food saturates at -32767/256, so a food value of 0x8000 never comes out of the
+// simulation; it marks the wall cells of the halo around the world (see BrickedWorld.h).
+struct WorldCell {
+	unsigned short trailAnts;
+	unsigned short tick;
+	unsigned short food;
+	unsigned short terrain;
+};
+
+static const unsigned int WORLD_CELL_TICK_MASK = 0xFFFFu;	// stamps wrap after 2^16 ticks
+static const unsigned int WORLD_CELL_RESTAMP_INTERVAL = 0x8000u;	// ticks between restampWorldCell sweeps
+static const unsigned int WORLD_CELL_MAX_ANTS = 127u;
+static const unsigned short WORLD_CELL_ANTS = 0x8000u;	// in trailAnts
+static const unsigned short WORLD_CELL_NEST = 0x0001u;	// in terrain
+static const float WORLD_CELL_FOOD_SCALE = 256.0f;
+static const float WORLD_CELL_TRAIL_SCALE = 32767.0f;
+static const unsigned short WORLD_CELL_WALL_FOOD = 0x8000u;
+
+static const WorldCell WALL_WORLD_CELL = { 0, 0, WORLD_CELL_WALL_FOOD, 0 };
+
+inline bool worldCellIsWall(const WorldCell& cell)
+{
+	return cell.food == WORLD_CELL_WALL_FOOD;
+}
+
+inline bool worldCellHasNest(const WorldCell& cell)
+{
+	return (cell.terrain & WORLD_CELL_NEST) != 0;
+}
+
+inline float worldCellFood(const WorldCell& cell)
+{
+	return (short)cell.food / WORLD_CELL_FOOD_SCALE;
+}
+
+// trail strength at tick, decayed linearly since the cell was last reinforced
+inline float worldCellTrailStrength(const WorldCell& cell, unsigned int tick, float trailDissipationPerFrame)
+{
+	unsigned int age = (tick - cell.tick) & WORLD_CELL_TICK_MASK;
+	float trail = (cell.trailAnts & WORLD_CELL_ANTS) != 0 ? 1.0f : cell.trailAnts / WORLD_CELL_TRAIL_SCALE;
+	return glm::max(trail - trailDissipationPerFrame * age, 0.0f);
+}
+
+// ants in the cell at tick; the count is only current if the cell was stamped with that tick
+inline unsigned int worldCellAnts(const WorldCell& cell, unsigned int tick)
+{
+	if (cell.tick != (tick & WORLD_CELL_TICK_MASK) || (cell.trailAnts & WORLD_CELL_ANTS) == 0) {
+		return 0;
+	}
+	return cell.trailAnts & WORLD_CELL_MAX_ANTS;
+}
+
+// saturates the trail and the count to what the layer can hold; a cell with ants in it keeps their count instead of
+// the trail, which they always leave at full strength
+inline void packTrailLayer(WorldCell* cell, float trail, unsigned int ants, unsigned int tick)
+{
+	if (ants > 0) {
+		cell->trailAnts = (unsigned short)(WORLD_CELL_ANTS | glm::min(ants, WORLD_CELL_MAX_ANTS));
+	} else {
+		cell->trailAnts = (unsigned short)glm::floor(glm::clamp(trail, 0.0f, 1.0f) * WORLD_CELL_TRAIL_SCALE + 0.5f);
+	}
+	cell->tick = (unsigned short)(tick & WORLD_CELL_TICK_MASK);
+}
+
+// saturates the food to what the layer can hold
+inline void packFoodLayer(WorldCell* cell, float food)
+{
+	cell->food = (unsigned short)(short)glm::clamp(glm::floor(food * WORLD_CELL_FOOD_SCALE + 0.5f), -32767.0f, 32767.0f);
+}
+
+inline WorldCell packWorldCell(bool nest, float food, float trail, unsigned int tick, unsigned int ants)
+{
+	WorldCell cell;
+	packTrailLayer(&cell, trail, ants, tick);
+	packFoodLayer(&cell, food);
+	cell.terrain = (unsigned short)(nest ? WORLD_CELL_NEST : 0u);
+	return cell;
+}
+
+// The stamps only keep 16 bits, so every WORLD_CELL_RESTAMP_INTERVAL ticks each backend restamps the cells that have
+// gone that long without being reinforced: their trail is stored as it is at tick, and their stale ant count dropped.
+// No cell is then ever read 2^16 ticks or more after its stamp. A cell with no trail and no ants reads the same under
+// any stamp, so it is left alone. Returns whether the cell changed
+inline bool restampWorldCell(WorldCell* cell, unsigned int tick, float trailDissipationPerFrame)
+{
+	unsigned int age = (tick - cell->tick) & WORLD_CELL_TICK_MASK;
+	if (age < WORLD_CELL_RESTAMP_INTERVAL || cell->trailAnts == 0) {
+		return false;
+	}
+
+	packTrailLayer(cell, worldCellTrailStrength(*cell, tick, trailDissipationPerFrame), 0, tick);
+	return true;
+}
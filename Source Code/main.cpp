@@ -8,7 +8,16 @@
 #include <GL/glut.h>
 #include <GL/glui.h>
 #include "AntSim.h"
+#include "CpuSimulationBackend.h"
+#include "BrickLayoutBenchmark.h"
+#include "MarchingCubesBenchmark.h"
+#include "Random.h"
+#include "TickScheduler.h"
 #include <glm/gtc/type_ptr.hpp>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
 
 
 static int winWidth = 800;
@@ -18,10 +27,23 @@ static GLUI *glui;
 
 AntSim *antsim;
 
-const int NUM_SUPPORTED_CUBE_LENGTHS = 3;
-int SUPPORTED_CUBE_LENGTHS[NUM_SUPPORTED_CUBE_LENGTHS] = {32, 64, 128};
+const int NUM_SUPPORTED_CUBE_LENGTHS = 6;
+int SUPPORTED_CUBE_LENGTHS[NUM_SUPPORTED_CUBE_LENGTHS] = {32, 64, 128, 256, 512, 1024};	// the world is bricked, so only the bricks with something in them take memory
 int selectedCubeLengthButton = 0;
 
+const int NUM_SIMULATION_BACKENDS = 3;
+SimulationBackendType SIMULATION_BACKENDS[NUM_SIMULATION_BACKENDS] = {BackendFragmentShader, BackendCpu, BackendCompute};	// in the order of the radio buttons
+const char* SIMULATION_BACKEND_NAMES[NUM_SIMULATION_BACKENDS] = {"fragment", "cpu", "compute"};	// for --backend
+int selectedSimulationBackendButton = 0;
+
+static GLUI_EditText *seedEditText;
+static GLUI_StaticText *timingText;
+
+static int commandLineSeed = -1;	// --seed replays a run; otherwise AntSim picks one (shown in the GUI)
+static int commandLineTicksPerFrame = 0;	// --fast-forward K starts fast-forwarding, drawing every K-th tick
+
+static TickScheduler frameScheduler(1);	// paces the redraws to antsim->targetFramesPerSecond
+
 /*****************************************************************************
 *****************************************************************************/
 static void
@@ -128,18 +150,26 @@ keyboardCB(unsigned char key, int x, int y)
 }
 
 /*****************************************************************************
+ Asks for the next frame once it is due, then sleeps in GLUT's event loop until
+ the one after. GLUI redraws the window itself whenever a control changes, so
+ nothing is redrawn while the simulation is paused and left alone.
 *****************************************************************************/
 void
-idleFunc()
-{		
-	if ( glutGetWindow() != winId ) 
-	{
-		glutSetWindow(winId);  
+frameTimerCB(int)
+{
+	double frameIntervalSeconds = 1.0 / glm::max(antsim->targetFramesPerSecond, 1.0f);
+
+	TickScheduler::Clock::time_point now = TickScheduler::Clock::now();
+	if (frameScheduler.tickDue(frameIntervalSeconds, now)) {
+		if (antsim->simulationRunning && !antsim->simulationPaused) {
+			glutSetWindow(winId);
+			glutPostRedisplay();
+		}
+		frameScheduler.tickDone(frameIntervalSeconds, now);
 	}
 
-	GLUI_Master.sync_live_all();  
-
-	glutPostRedisplay();
+	double secondsUntilNextFrame = std::chrono::duration<double>(frameScheduler.nextTickDue(frameIntervalSeconds) - TickScheduler::Clock::now()).count();
+	glutTimerFunc((unsigned int)glm::max(ceil(secondsUntilNextFrame * 1000.0), 1.0), frameTimerCB, 0);
 }
 
 
@@ -154,6 +184,17 @@ refreshCB()
 		antsim->display();
 
 		glutSwapBuffers();
+
+		// only when they change, about once a second, since every set_text redraws the GLUI window
+		static float displayedTicksPerSecond = -1.0f;
+		static float displayedFramesPerSecond = -1.0f;
+		if (antsim->ticksPerSecond() != displayedTicksPerSecond || antsim->framesPerSecond() != displayedFramesPerSecond) {
+			char timingLabel[64];
+			sprintf(timingLabel, "%.1f ticks/s, %.1f frames/s", antsim->ticksPerSecond(), antsim->framesPerSecond());
+			timingText->set_text(timingLabel);
+			displayedTicksPerSecond = antsim->ticksPerSecond();
+			displayedFramesPerSecond = antsim->framesPerSecond();
+		}
 	}
 }
 
@@ -165,7 +206,12 @@ void initialize()
     glewInit();
 
     // Create the gpgpu object
-    antsim = new AntSim(winWidth, winHeight);
+    antsim = new AntSim(winWidth, winHeight, commandLineSeed, SIMULATION_BACKENDS[selectedSimulationBackendButton]);
+
+	if (commandLineTicksPerFrame > 0) {
+		antsim->fastForward = 1;
+		antsim->ticksPerFrame = commandLineTicksPerFrame;
+	}
 }
 
 void __cdecl onChangeCubeLength(int id) {
@@ -174,11 +220,22 @@ void __cdecl onChangeCubeLength(int id) {
 	antsim->cubeLength = selectedCubeLength;
 }
 
+void __cdecl onChangeSimulationBackend(int id) {
+	antsim->simulationBackendType = SIMULATION_BACKENDS[selectedSimulationBackendButton];
+	printf("selecting simulation backend %d (takes effect on restart)\n", selectedSimulationBackendButton);
+}
+
 void __cdecl restart(int id) {
 	printf("restart button pressed\n");
 	antsim->restart();
 }
 
+void __cdecl restartWithNewSeed(int id) {
+	antsim->randomSeed = (int)(randomRunSeed() & 0x7fffffffu);
+	seedEditText->set_int_val(antsim->randomSeed);
+	antsim->restart();
+}
+
 /*****************************************************************************
 *****************************************************************************/
 void MakeGUI()
@@ -190,7 +247,7 @@ void MakeGUI()
 	GLUI_Panel *initialization_panel = glui->add_panel("Initialization");
 
 	GLUI_Spinner *simulation_num_ants_spinner = glui->add_spinner_to_panel(initialization_panel, "Number of Ants", GLUI_SPINNER_INT, &antsim->numAnts);
-	simulation_num_ants_spinner->set_int_limits(1, 128);
+	simulation_num_ants_spinner->set_int_limits(0, MAX_NUM_ANTS);
 
 	int CHANGE_CUBE_LENGTH_ID = 0;
 
@@ -204,10 +261,26 @@ void MakeGUI()
 	}
 	onChangeCubeLength(0);
 
+	int CHANGE_SIMULATION_BACKEND_ID = 2;
+
+	GLUI_Panel *simulation_backend_panel = glui->add_panel_to_panel(initialization_panel, "Simulation Backend");
+
+	GLUI_RadioGroup *simulation_backend_radio_group = glui->add_radiogroup_to_panel(simulation_backend_panel, &selectedSimulationBackendButton, CHANGE_SIMULATION_BACKEND_ID, (GLUI_Update_CB)onChangeSimulationBackend);
+	glui->add_radiobutton_to_group(simulation_backend_radio_group, "GPU (fragment shaders)");
+	glui->add_radiobutton_to_group(simulation_backend_radio_group, "CPU (multithreaded)");
+	glui->add_radiobutton_to_group(simulation_backend_radio_group, "GPU (compute shaders, GL 4.3)");
+
+	// the same seed and settings give the same run on either backend
+	seedEditText = glui->add_edittext_to_panel(initialization_panel, "Random Seed", GLUI_EDITTEXT_INT, &antsim->randomSeed);
+
 	int RESTART_ID = 1;
 
 	GLUI_Button *restart_button = glui->add_button_to_panel(initialization_panel, "Restart", RESTART_ID, (GLUI_Update_CB)restart);
 
+	int RESTART_WITH_NEW_SEED_ID = 3;
+
+	GLUI_Button *restart_with_new_seed_button = glui->add_button_to_panel(initialization_panel, "Restart with New Seed", RESTART_WITH_NEW_SEED_ID, (GLUI_Update_CB)restartWithNewSeed);
+
 	// simulation
 
 	GLUI_Panel *simulation_panel = glui->add_panel("Simulation");
@@ -221,6 +294,15 @@ void MakeGUI()
 	GLUI_Spinner *simulation_trail_score_multiplier_spinner = glui->add_spinner_to_panel(simulation_panel, "Trail Score Multiplier (default = 1)", GLUI_SPINNER_FLOAT, &antsim->trailScoreMultiplier);
 	simulation_trail_score_multiplier_spinner->set_float_limits(1, 50);
 
+	GLUI_Spinner *simulation_ant_spawn_rate_spinner = glui->add_spinner_to_panel(simulation_panel, "Ants Spawned per Tick", GLUI_SPINNER_FLOAT, &antsim->antSpawnRate);
+	simulation_ant_spawn_rate_spinner->set_float_limits(0, 10000);
+
+	GLUI_Spinner *simulation_ant_lifetime_spinner = glui->add_spinner_to_panel(simulation_panel, "Ant Lifetime (ticks, 0 = forever)", GLUI_SPINNER_INT, &antsim->antLifetime);
+	simulation_ant_lifetime_spinner->set_int_limits(0, 1000000);
+
+	GLUI_Spinner *simulation_crowding_score_multiplier_spinner = glui->add_spinner_to_panel(simulation_panel, "Crowding Score Multiplier (default = 0)", GLUI_SPINNER_FLOAT, &antsim->crowdingScoreMultiplier);
+	simulation_crowding_score_multiplier_spinner->set_float_limits(0, 10);
+
 	GLUI_Spinner *simulation_trail_fade_rate_spinner = glui->add_spinner_to_panel(simulation_panel, "Trail Fade Rate", GLUI_SPINNER_FLOAT, &antsim->trailDissipationPerFrame);
 	simulation_trail_fade_rate_spinner->set_float_limits(0.0, 1.0);
 	simulation_trail_fade_rate_spinner->set_speed(0.01f);
@@ -232,9 +314,21 @@ void MakeGUI()
 
 	glui->add_rotation_to_panel(visualization_panel, "Rotation", antsim->view_rotate());
 
-	GLUI_Spinner *visualization_update_rate_spinner = glui->add_spinner_to_panel(visualization_panel, "Update Rate (sec)", GLUI_SPINNER_FLOAT, &antsim->updateIntervalSeconds);
+	GLUI_Spinner *visualization_update_rate_spinner = glui->add_spinner_to_panel(visualization_panel, "Update Rate (sec, 0 = max)", GLUI_SPINNER_FLOAT, &antsim->updateIntervalSeconds);
 	visualization_update_rate_spinner->set_float_limits(0, 0.1);
 
+	GLUI_Spinner *visualization_frame_rate_spinner = glui->add_spinner_to_panel(visualization_panel, "Frame Rate (frames/s)", GLUI_SPINNER_FLOAT, &antsim->targetFramesPerSecond);
+	visualization_frame_rate_spinner->set_float_limits(1, 240);
+
+	glui->add_checkbox_to_panel(visualization_panel, "Pause", &antsim->simulationPaused);
+
+	glui->add_checkbox_to_panel(visualization_panel, "Fast Forward", &antsim->fastForward);
+
+	GLUI_Spinner *visualization_ticks_per_frame_spinner = glui->add_spinner_to_panel(visualization_panel, "Ticks per Frame (fast forward)", GLUI_SPINNER_INT, &antsim->ticksPerFrame);
+	visualization_ticks_per_frame_spinner->set_int_limits(1, 100000);
+
+	timingText = glui->add_statictext_to_panel(visualization_panel, "0.0 ticks/s, 0.0 frames/s");
+
 	GLUI_Spinner *visualization_trail_opacity_spinner = glui->add_spinner_to_panel(visualization_panel, "Trail Opacity", GLUI_SPINNER_FLOAT, &antsim->trailOpacity);
 	visualization_trail_opacity_spinner->set_float_limits(0.0, 1.0);
 
@@ -251,8 +345,157 @@ void MakeGUI()
 
 	glui->set_main_gfx_window(winId);
 
-	/* We register the idle callback with GLUI, *not* with GLUT */
-	GLUI_Master.set_glutIdleFunc(idleFunc);
+	// no idle callback, which would spin a core even while nothing changes; frameTimerCB paces the redraws
+	frameScheduler.reset(TickScheduler::Clock::now());
+	glutTimerFunc(1, frameTimerCB, 0);
+}
+
+/*****************************************************************************
+ Runs the CPU backend without creating a window or GL context, for batch nodes.
+ usage: myproject --headless [--ticks N] [--cube-length N] [--ants N] [--threads N] [--seed N] [--no-avx2] [--sort-ants K] [--crowding X]
+        [--spawn-rate R] [--lifetime T]
+*****************************************************************************/
+static int
+runHeadless(int argc, char *argv[])
+{
+	int ticks = 1000;
+	int cubeLength = 128;
+	int numAnts = 4096;
+	int numThreads = 0;
+	bool allowAvx2 = true;
+	int antSortInterval = 0;
+	float crowdingScoreMultiplier = 0.0f;
+	float antSpawnRate = 0.0f;
+	int antLifetime = 0;
+	unsigned int seed = randomRunSeed();
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) {
+			ticks = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--cube-length") == 0 && i + 1 < argc) {
+			cubeLength = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--ants") == 0 && i + 1 < argc) {
+			numAnts = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+			numThreads = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+			seed = (unsigned int)strtoul(argv[++i], 0, 10);
+		} else if (strcmp(argv[i], "--no-avx2") == 0) {
+			allowAvx2 = false;	// score the ants with the scalar loop, to compare against the AVX2 kernel
+		} else if (strcmp(argv[i], "--sort-ants") == 0 && i + 1 < argc) {
+			antSortInterval = atoi(argv[++i]);	// re-sort the ants by voxel every K ticks
+		} else if (strcmp(argv[i], "--crowding") == 0 && i + 1 < argc) {
+			crowdingScoreMultiplier = (float)atof(argv[++i]);
+		} else if (strcmp(argv[i], "--spawn-rate") == 0 && i + 1 < argc) {
+			antSpawnRate = (float)atof(argv[++i]);	// new ants per tick
+		} else if (strcmp(argv[i], "--lifetime") == 0 && i + 1 < argc) {
+			antLifetime = atoi(argv[++i]);	// in ticks, 0 = forever
+		}
+	}
+
+	cubeLength = glm::max(cubeLength / WORLD_BRICK_SIZE, 1) * WORLD_BRICK_SIZE;	// whole bricks, see BrickedWorld::reset
+
+	// same defaults as the interactive controls in AntSim
+	SimulationParameters parameters;
+	parameters.seed = seed;
+	parameters.worldSize = glm::ivec3(cubeLength, cubeLength, cubeLength);
+	parameters.numAnts = numAnts;
+	parameters.antSpawnRate = antSpawnRate;
+	parameters.antLifetime = antLifetime;
+	parameters.initialFoodRatio = 0.005f;
+	parameters.foodPickupRate = 0.5f;
+	parameters.trailDissipationPerFrame = 0.001f;
+	parameters.foodNestScoreMultiplier = 10.0f;
+	parameters.trailScoreMultiplier = 1.0f;
+	parameters.crowdingScoreMultiplier = crowdingScoreMultiplier;
+	parameters.randomMovementProbability = 0.1f;
+
+	printf("headless run: %d ticks, world %dx%dx%d, %d ants, seed %u\n", ticks, cubeLength, cubeLength, cubeLength, numAnts, seed);
+
+	CpuSimulationBackend backend(numThreads, allowAvx2);
+	backend.setAntSortInterval(antSortInterval);
+	backend.restart(parameters);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	double antSteps = 0.0;
+	for (int t = 0; t < ticks; t++) {
+		backend.step(parameters);
+		antSteps += backend.numAnts();
+	}
+
+	double elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	printf("%d ticks in %.3f s (%.1f ticks/s, %.1fM ant-steps/s), %d ants alive, %d carrying food\n",
+		ticks, elapsedSeconds, ticks / elapsedSeconds, antSteps / elapsedSeconds / 1e6, backend.numAnts(), backend.numAntsCarryingFood());
+
+	const AntSortStatistics& sortStatistics = backend.antSortStatistics();
+	if (sortStatistics.numSorts > 0) {
+		printf("ant sort: %d sorts in %.1f ms, %.2f -> %.2f bricks per batch of %d ants\n", sortStatistics.numSorts, sortStatistics.sortMilliseconds,
+			sortStatistics.bricksPerBatchBeforeSort, sortStatistics.bricksPerBatchAfterSort, ANT_SCORING_LANES);
+	}
+
+	return 0;
+}
+
+/*****************************************************************************
+ Times neighbourhood reads in the dense and bricked world layouts (see BrickLayoutBenchmark.h).
+ usage: myproject --benchmark-layout [--cube-length N] [--gathers N]
+*****************************************************************************/
+static int
+runLayoutBenchmark(int argc, char *argv[])
+{
+	int cubeLength = 256;
+	int numGathers = 4000000;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--cube-length") == 0 && i + 1 < argc) {
+			cubeLength = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--gathers") == 0 && i + 1 < argc) {
+			numGathers = atoi(argv[++i]);
+		}
+	}
+
+	return runBrickLayoutBenchmark(cubeLength, numGathers);
+}
+
+/*****************************************************************************
+ Times complete surface extractions of a simulated world and checks that the
+ geometry shader drops no triangles (see MarchingCubesBenchmark.h). Opens a
+ window for the GL context.
+ usage: myproject --benchmark-marching-cubes [--cube-length N] [--ants N] [--ticks N] [--seed N] [--repeats N]
+*****************************************************************************/
+static int
+runMarchingCubesBenchmarkMode(int argc, char *argv[])
+{
+	int cubeLength = 128;
+	int numAnts = 2000;
+	int numTicks = 160;
+	unsigned int seed = 1;	// the same world every run unless asked otherwise, so the counts can be compared
+	int numRepeats = 5;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--cube-length") == 0 && i + 1 < argc) {
+			cubeLength = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--ants") == 0 && i + 1 < argc) {
+			numAnts = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) {
+			numTicks = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+			seed = (unsigned int)strtoul(argv[++i], 0, 10);
+		} else if (strcmp(argv[i], "--repeats") == 0 && i + 1 < argc) {
+			numRepeats = atoi(argv[++i]);
+		}
+	}
+
+	glutInit(&argc, argv);
+	glutInitWindowSize(winWidth, winHeight);
+	glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGBA);
+	glutCreateWindow("Marching Cubes Benchmark");
+
+	glewInit();
+
+	return runMarchingCubesBenchmark(cubeLength, numAnts, numTicks, seed, numRepeats);
 }
 
 /*****************************************************************************
@@ -260,6 +503,28 @@ void MakeGUI()
 int
 main(int argc, char *argv[])
 {
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--headless") == 0) {
+			return runHeadless(argc, argv);
+		} else if (strcmp(argv[i], "--benchmark-layout") == 0) {
+			return runLayoutBenchmark(argc, argv);
+		} else if (strcmp(argv[i], "--benchmark-marching-cubes") == 0) {
+			return runMarchingCubesBenchmarkMode(argc, argv);
+		} else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+			commandLineSeed = (int)(strtoul(argv[++i], 0, 10) & 0x7fffffffu);
+		} else if (strcmp(argv[i], "--fast-forward") == 0 && i + 1 < argc) {
+			commandLineTicksPerFrame = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--backend") == 0 && i + 1 < argc) {
+			// the backend of the first run; the GUI can still switch on restart
+			++i;
+			for (int b = 0; b < NUM_SIMULATION_BACKENDS; b++) {
+				if (strcmp(argv[i], SIMULATION_BACKEND_NAMES[b]) == 0) {
+					selectedSimulationBackendButton = b;
+				}
+			}
+		}
+	}
+
 	// init OpenGL/GLUT
 	glutInit(&argc, argv);
 	
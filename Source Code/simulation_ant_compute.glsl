@@ -0,0 +1,363 @@
+#version 430
+
+// one invocation per ant: the same rules as simulation_ant_fragment.glsl, but the ants are read from and written back
+// to a shader storage buffer with integer positions instead of being drawn into a texture. Once an ant has moved, it
+// also counts itself into its own voxel and the 26 around it with atomic adds (the compute version of the point
+// scatter in simulation_scatter_*.glsl and simulation_deposit_fragment.glsl), so the ants are only read once per tick.
+// It marks the bricks its ant will need on the next tick as well, so the host only reads back a bit per brick
+
+layout(local_size_x = 128) in;	// ANT_WORKGROUP_SIZE in ComputeSimulationBackend.cpp
+
+uniform uint randomSeed;	// run seed, see Random.h
+
+uniform usampler3D worldTrailTexture;	// the three layers of the packed cells, see WorldCell.h
+uniform usampler3D worldFoodTexture;
+uniform usampler3D worldTerrainTexture;
+
+uniform ivec3 worldSize;
+
+const int WORLD_BRICK_SIZE = 8;	// same brick layout as BrickedWorld.h
+
+uniform isampler3D worldPageTexture;	// atlas slot of every brick of the world, -1 if the brick isn't resident; offset by the halo
+const int WALL_BRICK = -2;	// page table entry of the halo of wall bricks around the world
+uniform ivec3 worldAtlasSizeInBricks;	// how the slots are laid out in the world textures
+
+uniform uint numAnts;
+
+// the live ants are the ids firstAntId to firstAntId + numAnts - 1, in order (see AntPopulation.h): the ones still
+// alive from previousAnts come first, read from past the numRetiredAnts oldest ants, then the ones spawned this tick
+uniform uint firstAntId;
+uniform uint numPreviousAnts;	// ants in previousAnts
+uniform uint numRetiredAnts;
+
+uniform float trailDissipationPerFrame;
+uniform uint worldTick;	// the tick that the world textures currently hold
+uniform float freeWillThreshold;
+uniform float foodNestScoreMultiplier;
+uniform float trailScoreMultiplier;
+uniform float crowdingScoreMultiplier;
+
+// xyz = voxel the ant is in, w = ant state (bit 0 = has food, bits 1-5 = direction code, see AntDirection.h)
+layout(std430, binding = 0) writeonly buffer Ants {
+	ivec4 ants[];
+};
+
+layout(std430, binding = 1) readonly buffer PreviousAnts {
+	ivec4 previousAnts[];
+};
+
+// both laid out as the brick atlas, zero everywhere between ticks; simulation_world_compute.glsl applies and clears them
+layout(r32ui, binding = 1) uniform uimage3D antCountImage;	// ants in each voxel
+layout(r32ui, binding = 2) uniform uimage3D nearbyAntCountImage;	// ants in the 26 voxels around it
+
+uniform bool depositAnts;	// false for the pass at restart, which only places the ants
+
+// what the ants need of each brick on the next tick, BRICK_REQUEST_BITS per brick of the world in x-fastest order,
+// packed into words (see BrickedWorld.h); the host copies them out after the pass and clears them
+layout(std430, binding = 2) buffer BrickRequests {
+	uint brickRequests[];
+};
+
+const int BRICK_REQUEST_RADIUS = 2;	// an ant moves at most one voxel and then deposits into the voxels around it
+const uint BRICK_REQUEST_TOUCH = 1u;
+const uint BRICK_REQUEST_PIN = 2u;
+const int BRICK_REQUEST_BITS = 2;
+const int BRICK_REQUESTS_PER_WORD = 32 / BRICK_REQUEST_BITS;
+
+// the movement cone of every direction code, filled from antMovementConeUniformBlock() (see AntDirection.h)
+const int NUM_ANT_DIRECTIONS = 27;
+const int MAX_ANT_CONE_STEPS = 26;
+
+layout(std140, binding = 0) uniform AntMovementCones {
+	ivec4 antConeMinCorner[NUM_ANT_DIRECTIONS];	// w = number of steps in the cone
+	ivec4 antConeMaxCorner[NUM_ANT_DIRECTIONS];
+	ivec4 antConeSteps[NUM_ANT_DIRECTIONS * MAX_ANT_CONE_STEPS];	// in scoring order; ties go to the first step
+};
+
+// index of the ant this invocation simulates in the buffer it writes
+uint getAntIndex() {
+	return gl_GlobalInvocationID.x;
+}
+
+// the ant's id, which keys its random draws like in CpuSimulationBackend
+uint getAntId() {
+	return firstAntId + getAntIndex();
+}
+
+// index of this ant in previousAnts; numPreviousAnts or more if it was spawned this tick
+uint getPreviousAntIndex() {
+	return getAntIndex() + numRetiredAnts;
+}
+
+// counter-based random numbers, the same functions and integer arithmetic as Random.h
+const uint RANDOM_STREAM_ANT_INIT = 1u;
+const uint RANDOM_STREAM_ANT_MOVE = 2u;
+
+uint hashUint(uint x) {
+	x ^= x >> 16;
+	x *= 0x7feb352du;
+	x ^= x >> 15;
+	x *= 0x846ca68bu;
+	x ^= x >> 16;
+	return x;
+}
+
+// uniform in [0,1) for this ant and tick
+float random(uint stream, uint draw) {
+	uint h = hashUint(randomSeed ^ hashUint(stream + 0x9e3779b9u * (worldTick + 1u)));
+	h = hashUint(h ^ getAntId());
+	h = hashUint(h ^ draw);
+	return float(h >> 8) * (1.0 / 16777216.0);
+}
+
+// round(mix(low, high, r)), computed exactly so the CPU backend gets the same integer
+int randomIntBetween(int low, int high, float r) {
+	return low + int(floor(float(high - low) * r + 0.5));
+}
+
+const uint ANT_STATE_HAS_FOOD = 1u;
+const uint ANT_STATE_DIRECTION_SHIFT = 1u;
+
+int antDirectionCode(ivec3 step) {
+	return (step.x + 1) + 3 * (step.y + 1) + 9 * (step.z + 1);
+}
+
+ivec3 antDirectionStep(int directionCode) {
+	return ivec3(directionCode % 3, (directionCode / 3) % 3, directionCode / 9) - 1;
+}
+
+int reverseAntDirection(int directionCode) {
+	return (NUM_ANT_DIRECTIONS - 1) - directionCode;	// negating every axis mirrors the code
+}
+
+int generateAntState(int directionCode, bool hasFood) {
+	return int((uint(directionCode) << ANT_STATE_DIRECTION_SHIFT) | (hasFood ? ANT_STATE_HAS_FOOD : 0u));
+}
+
+ivec3 worldAtlasVoxel(int slot, ivec3 worldVolumeCoord) {
+	ivec3 atlasBrick = ivec3(
+		slot % worldAtlasSizeInBricks.x,
+		(slot / worldAtlasSizeInBricks.x) % worldAtlasSizeInBricks.y,
+		slot / (worldAtlasSizeInBricks.x * worldAtlasSizeInBricks.y));
+	return atlasBrick * WORLD_BRICK_SIZE + (worldVolumeCoord & (WORLD_BRICK_SIZE - 1));
+}
+
+// all three layers of a cell, in the order of WorldCell.h: red = trail or ants, green = tick stamp, blue = food, alpha = terrain
+uvec4 fetchWorldCell(ivec3 atlasVoxel) {
+	return uvec4(texelFetch(worldTrailTexture, atlasVoxel, 0).rg, texelFetch(worldFoodTexture, atlasVoxel, 0).r, texelFetch(worldTerrainTexture, atlasVoxel, 0).r);
+}
+
+// same packing as encodeTrailLayer and encodeFoodLayer in simulation_world_compute.glsl;
+// decoded into red = nest, green = food, blue = trail strength at worldTick, alpha = ants in the cell at worldTick
+vec4 decodeWorldCell(uvec4 worldCell) {
+	float nest = ((worldCell.a & 1u) != 0u) ? 1.0 : 0.0;
+	float food = float((int(worldCell.b) << 16) >> 16) / 256.0;
+
+	// bit 15 set: ants stood in the cell at its stamp, and left the trail at full strength
+	bool antsStamped = (worldCell.r & 0x8000u) != 0u;
+	uint age = (worldTick - worldCell.g) & 0xFFFFu;
+	float storedTrail = antsStamped ? 1.0 : float(worldCell.r) / 32767.0;
+	float trail = max(storedTrail - trailDissipationPerFrame * float(age), 0.0);
+
+	float ants = (antsStamped && age == 0u) ? float(worldCell.r & 127u) : 0.0;
+
+	return vec4(nest, food, trail, ants);
+}
+
+// decodeWorldCell of a wall cell: food is 0x8000, which the simulation never writes (see WorldCell.h)
+const vec4 WALL_CELL_COLOR = vec4(0.0, -128.0, 0.0, 0.0);
+
+bool worldCellIsWall(vec4 worldCellColor) {
+	return (worldCellColor.g <= -128.0);
+}
+
+vec4 lookupWorldCellColorAtCoordinate(ivec3 voxel) {
+	// no clamping: ants are never more than a voxel outside the world, and the page table has a halo of wall bricks
+	int slot = texelFetch(worldPageTexture, (voxel + WORLD_BRICK_SIZE) / WORLD_BRICK_SIZE, 0).r;
+	if (slot < 0) {
+		return (slot == WALL_BRICK) ? WALL_CELL_COLOR : vec4(0.0, 0.0, 0.0, 0.0);	// outside the world, or empty space
+	}
+
+	return decodeWorldCell(fetchWorldCell(worldAtlasVoxel(slot, voxel)));
+}
+
+ivec3 getDisplacementToStrongestTrailInFront(bool hasFood, ivec3 antPositionInWorld, int directionCode) {
+	float thresholdToNotChooseRandomly = 0.9;
+
+	float highestScore = 0.0;
+	ivec3 currentDisplacementCandidate = ivec3(0,0,0);
+
+	// go through each possible cell in front of the ant and see which one has the strongest trail
+	int numSteps = antConeMinCorner[directionCode].w;
+	for (int s = 0; s < numSteps; s++) {
+		ivec3 step = antConeSteps[directionCode * MAX_ANT_CONE_STEPS + s].xyz;
+		vec4 worldCellColor = lookupWorldCellColorAtCoordinate(antPositionInWorld + step);
+
+		float trailScoreAtThisCell = worldCellColor.b * trailScoreMultiplier;
+		float foodScoreAtThisCell = worldCellColor.g * foodNestScoreMultiplier;
+		float nestScoreAtThisCell = worldCellColor.r * foodNestScoreMultiplier;
+		float crowdingScoreAtThisCell = worldCellColor.a * crowdingScoreMultiplier;	// ants already in the cell
+
+		if (foodScoreAtThisCell > 0.0 && hasFood) {
+			// we don't want to go to a cell that has food if we already have food
+			foodScoreAtThisCell = -1000;
+		}
+
+		if (nestScoreAtThisCell > 0.0 && !hasFood) {
+			// we don't want to go to a cell that has the nest when we are empty-handed
+			nestScoreAtThisCell = -1000;
+		}
+
+		float totalScoreAtThisCell = trailScoreAtThisCell + foodScoreAtThisCell + nestScoreAtThisCell - crowdingScoreAtThisCell;
+
+		if (worldCellIsWall(worldCellColor)) {
+			totalScoreAtThisCell = -1000;	// never follow a trail out of the world
+		}
+
+		if (highestScore < totalScoreAtThisCell) {
+			highestScore = totalScoreAtThisCell;
+			currentDisplacementCandidate = step;
+		}
+	}
+
+	float strengthOfFreeWill = random(RANDOM_STREAM_ANT_MOVE, 0u);
+
+	if (highestScore <= thresholdToNotChooseRandomly || strengthOfFreeWill >= freeWillThreshold) {
+		// no strong trail in front, just return some random displacement
+		ivec3 minCorner = antConeMinCorner[directionCode].xyz;
+		ivec3 maxCorner = antConeMaxCorner[directionCode].xyz;
+		currentDisplacementCandidate = ivec3(
+			randomIntBetween(minCorner.x, maxCorner.x, random(RANDOM_STREAM_ANT_MOVE, 1u)),
+			randomIntBetween(minCorner.y, maxCorner.y, random(RANDOM_STREAM_ANT_MOVE, 2u)),
+			randomIntBetween(minCorner.z, maxCorner.z, random(RANDOM_STREAM_ANT_MOVE, 3u))
+		);
+	}
+
+	return currentDisplacementCandidate;
+}
+
+// along every axis where the ant's next step would leave the world, it heads back in
+ivec3 handleEdgeBoundaries(const ivec3 initialAntDirection, const ivec3 antPositionInWorld) {
+	ivec3 nextPosition = antPositionInWorld + initialAntDirection;
+	ivec3 below = ivec3(lessThan(nextPosition, ivec3(0)));
+	ivec3 above = ivec3(greaterThan(nextPosition, worldSize - 1));
+
+	return initialAntDirection + below * (1 - initialAntDirection) + above * (-1 - initialAntDirection);
+}
+
+ivec4 moveAnt(ivec4 ant) {
+	ivec3 antPositionInWorld = ant.xyz;
+
+	bool hasFood = (uint(ant.w) & ANT_STATE_HAS_FOOD) != 0u;
+	bool hadFood = hasFood;	// the cone is scored with the state from before this tick's pickup or drop-off
+	int directionCode = int(uint(ant.w) >> ANT_STATE_DIRECTION_SHIFT);
+	ivec3 antDirection = antDirectionStep(directionCode);
+
+	// get the state of the world where the ant is
+	vec4 worldCellColor = lookupWorldCellColorAtCoordinate(antPositionInWorld);
+
+	ivec3 antDirectionAfterEdgeHandling = handleEdgeBoundaries(antDirection, antPositionInWorld);
+
+	if (antDirectionAfterEdgeHandling != antDirection) {
+		directionCode = antDirectionCode(antDirectionAfterEdgeHandling);
+	} else if (worldCellColor.r > 0.0 && hasFood) {
+		// drop any food that is carried, and turn around
+		hasFood = false;
+		directionCode = reverseAntDirection(directionCode);
+	} else if (worldCellColor.g > 0.0 && !hasFood) {
+		// pick up some food here, and turn around
+		hasFood = true;
+		directionCode = reverseAntDirection(directionCode);
+	}
+
+	ivec3 displacement = getDisplacementToStrongestTrailInFront(hadFood, antPositionInWorld, directionCode);
+
+	return ivec4(antPositionInWorld + displacement, generateAntState(antDirectionCode(displacement), hasFood));
+}
+
+ivec4 init()
+{
+	ivec3 initialAntDirection = ivec3(
+		randomIntBetween(-1, 1, random(RANDOM_STREAM_ANT_INIT, 0u)),
+		randomIntBetween(-1, 1, random(RANDOM_STREAM_ANT_INIT, 1u)),
+		randomIntBetween(-1, 1, random(RANDOM_STREAM_ANT_INIT, 2u))
+	);
+
+	// every ant starts in the centre of the world, where the nest is
+	return ivec4(worldSize / 2, generateAntState(antDirectionCode(initialAntDirection), false));
+}
+
+void depositAnt(ivec3 antPositionInWorld) {
+	for (int neighbor = 0; neighbor < 27; neighbor++) {
+		ivec3 offset = ivec3(neighbor % 3, (neighbor / 3) % 3, neighbor / 9) - 1;
+		ivec3 voxel = antPositionInWorld + offset;
+
+		// the host makes the bricks within reach of the ants resident first, so this only fails if the pool is full,
+		// or in the halo of wall bricks
+		int slot = texelFetch(worldPageTexture, (voxel + WORLD_BRICK_SIZE) / WORLD_BRICK_SIZE, 0).r;
+		if (slot < 0) {
+			continue;
+		}
+
+		if (offset == ivec3(0, 0, 0)) {
+			imageAtomicAdd(antCountImage, worldAtlasVoxel(slot, voxel), 1u);
+		} else {
+			imageAtomicAdd(nearbyAntCountImage, worldAtlasVoxel(slot, voxel), 1u);
+		}
+	}
+}
+
+// like BrickedWorld::touchNeighborhood: requests the bricks within BRICK_REQUEST_RADIUS voxels of the ant, clamped to
+// the world, and pins the brick of an ant inside the world
+void requestBricks(ivec3 antPositionInWorld) {
+	ivec3 sizeInBricks = (worldSize + WORLD_BRICK_SIZE - 1) / WORLD_BRICK_SIZE;
+
+	ivec3 antVoxel = clamp(antPositionInWorld, ivec3(0), worldSize - 1);
+	bool antInWorld = (antVoxel == antPositionInWorld);
+	ivec3 antBrick = antVoxel / WORLD_BRICK_SIZE;
+
+	// a brick is wider than the box, so it spans at most two bricks along each axis
+	ivec3 minBrick = max(antPositionInWorld - BRICK_REQUEST_RADIUS, ivec3(0)) / WORLD_BRICK_SIZE;
+	ivec3 maxBrick = min(antPositionInWorld + BRICK_REQUEST_RADIUS, worldSize - 1) / WORLD_BRICK_SIZE;
+
+	for (int bz = minBrick.z; bz <= maxBrick.z; bz++) {
+		for (int by = minBrick.y; by <= maxBrick.y; by++) {
+			for (int bx = minBrick.x; bx <= maxBrick.x; bx++) {
+				ivec3 brick = ivec3(bx, by, bz);
+				int request = bx + sizeInBricks.x * (by + sizeInBricks.y * bz);
+
+				uint bits = (antInWorld && brick == antBrick) ? (BRICK_REQUEST_TOUCH | BRICK_REQUEST_PIN) : BRICK_REQUEST_TOUCH;
+				bits <<= uint(BRICK_REQUEST_BITS * (request % BRICK_REQUESTS_PER_WORD));
+
+				// most ants share their bricks with others that have set the bits already; a stale read only costs an
+				// atomic that changes nothing
+				int word = request / BRICK_REQUESTS_PER_WORD;
+				if ((brickRequests[word] & bits) != bits) {
+					atomicOr(brickRequests[word], bits);
+				}
+			}
+		}
+	}
+}
+
+void main()
+{
+	if (getAntIndex() >= numAnts) {
+		return;	// the last workgroup is only partly filled
+	}
+
+	ivec4 ant;
+	if (getPreviousAntIndex() >= numPreviousAnts) {
+		ant = init();	// spawned this tick, or at restart
+	} else {
+		ant = moveAnt(previousAnts[getPreviousAntIndex()]);
+	}
+
+	ants[getAntIndex()] = ant;
+
+	requestBricks(ant.xyz);
+
+	if (depositAnts) {
+		depositAnt(ant.xyz);
+	}
+}
@@ -3,55 +3,100 @@
 #extension GL_EXT_geometry_shader4 : enable 
 #extension GL_EXT_gpu_shader4 : enable 
 
-uniform int initialized;
+uniform uint randomSeed;	// run seed, see Random.h
 
-uniform float randomSeed;
-
-uniform sampler3D worldTexture;
+uniform usampler3D worldTrailTexture;	// the three layers of the packed cells, see WorldCell.h
+uniform usampler3D worldFoodTexture;
+uniform usampler3D worldTerrainTexture;
 uniform sampler3D antTexture;
 
 uniform vec3 inverseWorldTextureSize;
+
+const int WORLD_BRICK_SIZE = 8;	// same brick layout as BrickedWorld.h
+
+uniform isampler3D worldPageTexture;	// atlas slot of every brick of the world, -1 if the brick isn't resident; offset by the halo
+const int WALL_BRICK = -2;	// page table entry of the halo of wall bricks around the world
+uniform ivec3 worldAtlasSizeInBricks;	// how the slots are laid out in the world textures
 uniform vec3 inverseAntTextureSize;
+uniform uint numAnts;	// the ant texture is a square; texels past the last ant stay empty
+
+// the live ants are the ids firstAntId to firstAntId + numAnts - 1, in order (see AntPopulation.h): the ones still
+// alive from antTexture come first, read from past the numRetiredAnts oldest ants, then the ones spawned this tick
+uniform uint firstAntId;
+uniform uint numPreviousAnts;	// ants in antTexture
+uniform uint numRetiredAnts;
 
 uniform float foodPickupRate;
+uniform float trailDissipationPerFrame;
+uniform uint worldTick;	// the tick that the world textures currently hold
 uniform float freeWillThreshold;
 uniform float foodNestScoreMultiplier;
 uniform float trailScoreMultiplier;
+uniform float crowdingScoreMultiplier;
 
 in float volumeLayer;
 
-const int NUM_DIMENSIONS = 3;
-const int MAX_NUM_NEIGHBORS = 27;
+// the movement cone of every direction code, filled from antMovementConeUniformBlock() (see AntDirection.h)
+const int NUM_ANT_DIRECTIONS = 27;
+const int MAX_ANT_CONE_STEPS = 26;
+
+layout(std140) uniform AntMovementCones {
+	ivec4 antConeMinCorner[NUM_ANT_DIRECTIONS];	// w = number of steps in the cone
+	ivec4 antConeMaxCorner[NUM_ANT_DIRECTIONS];
+	ivec4 antConeSteps[NUM_ANT_DIRECTIONS * MAX_ANT_CONE_STEPS];	// in scoring order; ties go to the first step
+};
+
+// index of the ant this fragment simulates in the texture it writes
+uint getAntIndex() {
+	ivec3 antVolumeCoord = ivec3(vec3(gl_FragCoord.xy, volumeLayer) - 0.5);
+	ivec3 antTextureSize = ivec3(round(1.0 / inverseAntTextureSize));
+	return uint(antVolumeCoord.x + antTextureSize.x * (antVolumeCoord.y + antTextureSize.y * antVolumeCoord.z));
+}
 
-// pseudorandom seed
-// http://byteblacksmith.com/improvements-to-the-canonical-one-liner-glsl-rand-for-opengl-es-2-0/
-float rand(vec2 co)
-{
-    float a = 12.9898;
-    float b = 78.233;
-    float c = 43758.5453;
-    float dt= dot(co.xy ,vec2(a,b));
-    float sn= mod(dt,3.14);
-    return fract(sin(sn) * c);
+// the ant's id, which keys its random draws like in CpuSimulationBackend
+uint getAntId() {
+	return firstAntId + getAntIndex();
 }
 
-float getRandBetween(float low, float high, float seed) {
-	return mix(low,high,rand(vec2(seed,seed+1)));
+// index of this ant in antTexture; numPreviousAnts or more if it was spawned this tick
+uint getPreviousAntIndex() {
+	return getAntIndex() + numRetiredAnts;
+}
+
+// counter-based random numbers, the same functions and integer arithmetic as Random.h, so the CPU backend
+// draws the same numbers: every draw is keyed by (run seed, stream, tick, ant, draw) instead of carried state
+const uint RANDOM_STREAM_ANT_INIT = 1u;
+const uint RANDOM_STREAM_ANT_MOVE = 2u;
+
+uint hashUint(uint x) {
+	x ^= x >> 16;
+	x *= 0x7feb352du;
+	x ^= x >> 15;
+	x *= 0x846ca68bu;
+	x ^= x >> 16;
+	return x;
+}
+
+// uniform in [0,1) for this ant and tick
+float random(uint stream, uint draw) {
+	uint h = hashUint(randomSeed ^ hashUint(stream + 0x9e3779b9u * (worldTick + 1u)));
+	h = hashUint(h ^ getAntId());
+	h = hashUint(h ^ draw);
+	return float(h >> 8) * (1.0 / 16777216.0);
+}
+
+// round(mix(low, high, r)), computed exactly so the CPU backend gets the same integer
+int randomIntBetween(int low, int high, float r) {
+	return low + int(floor(float(high - low) * r + 0.5));
 }
 
 vec3 getAntPositionInWorldFromColor(vec4 antCellColor) {
 	return (antCellColor.rgb / inverseWorldTextureSize) - 0.5;
 }
 
-// alpha defines ant state (direction, has-food)
-// 32-bit float
-const uint BITMASK_HAS_FOOD = 1u << 0;
-const uint BITMASK_X_POS = 1u << 1;
-const uint BITMASK_X_NEG = 1u << 2;
-const uint BITMASK_Y_POS = 1u << 3;
-const uint BITMASK_Y_NEG = 1u << 4;
-const uint BITMASK_Z_POS = 1u << 5;
-const uint BITMASK_Z_NEG = 1u << 6;
+// alpha defines ant state: bit 0 = has food, bits 1-5 = direction code (see AntDirection.h)
+const uint ANT_STATE_HAS_FOOD = 1u;
+const uint ANT_STATE_DIRECTION_SHIFT = 1u;
 
 highp uint getAntStateFromColor(vec4 antCellColor) {
 	highp uint antState = uint(antCellColor.a);
@@ -59,31 +104,23 @@ highp uint getAntStateFromColor(vec4 antCellColor) {
 }
 
 bool getHasFoodFromState(highp uint antState) {
-	return ((antState & BITMASK_HAS_FOOD) > 0u);
+	return ((antState & ANT_STATE_HAS_FOOD) != 0u);
 }
 
-ivec3 getAntDirectionFromState(highp uint antState) {
-	ivec3 direction = ivec3(0, 0, 0);
-
-	if ((antState & BITMASK_X_POS) > 0u) {
-		direction.x = 1;
-	} else if ((antState & BITMASK_X_NEG) > 0u) {
-		direction.x = -1;
-	}
+int getAntDirectionCodeFromState(highp uint antState) {
+	return int(antState >> ANT_STATE_DIRECTION_SHIFT);
+}
 
-	if ((antState & BITMASK_Y_POS) > 0u) {
-		direction.y = 1;
-	} else if ((antState & BITMASK_Y_NEG) > 0u) {
-		direction.y = -1;
-	}
+int antDirectionCode(ivec3 step) {
+	return (step.x + 1) + 3 * (step.y + 1) + 9 * (step.z + 1);
+}
 
-	if ((antState & BITMASK_Z_POS) > 0u) {
-		direction.z = 1;
-	} else if ((antState & BITMASK_Z_NEG) > 0u) {
-		direction.z = -1;
-	}
+ivec3 antDirectionStep(int directionCode) {
+	return ivec3(directionCode % 3, (directionCode / 3) % 3, directionCode / 9) - 1;
+}
 
-	return direction;
+highp uint generateAntState(int directionCode, bool hasFood) {
+	return (uint(directionCode) << ANT_STATE_DIRECTION_SHIFT) | (hasFood ? ANT_STATE_HAS_FOOD : 0u);
 }
 
 vec4 getAntCellColorFromAntPositionInWorldAndState(vec3 antPositionInWorld, highp uint antState) {
@@ -97,94 +134,75 @@ vec4 getAntCellColorFromAntPositionInWorldAndState(vec3 antPositionInWorld, high
 	return updatedAntCellColor;
 }
 
-vec4 lookupWorldCellColorAtCoordinate(vec3 worldVolumeCoord) {
-	// this represents where to look in the world texture to find this world voxel
-	vec3 worldTextureCoord = inverseWorldTextureSize*(worldVolumeCoord+0.5); // in values [0.5/16,1.5/16,2.5/16,...,15.5/16]
-
-	// this represents the current world state at this voxel
-	vec4 worldCellColor = texture(worldTexture, worldTextureCoord);
+ivec3 worldAtlasVoxel(int slot, ivec3 worldVolumeCoord) {
+	ivec3 atlasBrick = ivec3(
+		slot % worldAtlasSizeInBricks.x,
+		(slot / worldAtlasSizeInBricks.x) % worldAtlasSizeInBricks.y,
+		slot / (worldAtlasSizeInBricks.x * worldAtlasSizeInBricks.y));
+	return atlasBrick * WORLD_BRICK_SIZE + (worldVolumeCoord & (WORLD_BRICK_SIZE - 1));
+}
 
-	return worldCellColor;
+// all three layers of a cell, in the order of WorldCell.h: red = trail or ants, green = tick stamp, blue = food, alpha = terrain
+uvec4 fetchWorldCell(ivec3 atlasVoxel) {
+	return uvec4(texelFetch(worldTrailTexture, atlasVoxel, 0).rg, texelFetch(worldFoodTexture, atlasVoxel, 0).r, texelFetch(worldTerrainTexture, atlasVoxel, 0).r);
 }
 
-vec4 lookupAntCellColorInTexture() {
-	// this represents which ant we're talking about
-	vec3 antVolumeCoord = vec3(gl_FragCoord.xy, volumeLayer) - 0.5;		// in values [0,1,2,...,15]
+// same packing as encodeTrailLayer in simulation_world_fragment.glsl and encodeFoodLayer in simulation_food_fragment.glsl;
+// decoded into red = nest, green = food, blue = trail strength at worldTick, alpha = ants in the cell at worldTick
+vec4 decodeWorldCell(uvec4 worldCell) {
+	float nest = ((worldCell.a & 1u) != 0u) ? 1.0 : 0.0;
+	float food = float((int(worldCell.b) << 16) >> 16) / 256.0;
 
-	// this represents the location in the ant texture to find this ant's current state
-	vec3 antTextureCoord = inverseAntTextureSize*(antVolumeCoord+0.5); // in values [0.5/16,1.5/16,2.5/16,...,15.5/16]
+	// bit 15 set: ants stood in the cell at its stamp, and left the trail at full strength
+	bool antsStamped = (worldCell.r & 0x8000u) != 0u;
+	uint age = (worldTick - worldCell.g) & 0xFFFFu;
+	float storedTrail = antsStamped ? 1.0 : float(worldCell.r) / 32767.0;
+	float trail = max(storedTrail - trailDissipationPerFrame * float(age), 0.0);
 
-	// this represents the ant's current state
-	vec4 antCellColor = texture(antTexture, antTextureCoord);
+	float ants = (antsStamped && age == 0u) ? float(worldCell.r & 127u) : 0.0;
 
-	return antCellColor;
+	return vec4(nest, food, trail, ants);
 }
 
-float getSeed() {
-	// based on combo of frag coord and current color
-	float fragCoordSeed = rand((gl_FragCoord.xyz * inverseAntTextureSize).xx);
+// decodeWorldCell of a wall cell: food is 0x8000, which the simulation never writes (see WorldCell.h)
+const vec4 WALL_CELL_COLOR = vec4(0.0, -128.0, 0.0, 0.0);
 
-	return rand(vec2(randomSeed, gl_FragCoord.x*inverseAntTextureSize.x));
+bool worldCellIsWall(vec4 worldCellColor) {
+	return (worldCellColor.g <= -128.0);
 }
 
-ivec2[NUM_DIMENSIONS] getValidMovementRangesBasedOnDirectionVector(ivec3 d) {
-	// d is in form (-1,-1,-1) to (1,1,1)
-
-	int numZeroDirections = ((d.x == 0) ? 1 : 0) + ((d.y == 0) ? 1 : 0) + ((d.z == 0) ? 1 : 0);
-	if (numZeroDirections == 0) {
-		// pointing towards corner of XYZ cube
-
-		// range should be in form (-1, 0) or (0, 1) for each axis, depending on the initial direction
-		return ivec2[NUM_DIMENSIONS](
-			ivec2(min(d.x, 0), max(d.x, 0)),
-			ivec2(min(d.y, 0), max(d.y, 0)),
-			ivec2(min(d.z, 0), max(d.z, 0))
-		);
-
-	} else if (numZeroDirections == 1 || numZeroDirections == 2) {
-		// pointing toward edge of XYZ cube (if 1 0-direction)
-		// or pointing toward face of XYZ cube (if 2 0-directions)
+vec4 lookupWorldCellColorAtCoordinate(vec3 worldVolumeCoord) {
+	// no clamping: ants are never more than a voxel outside the world, and the page table has a halo of wall bricks
+	ivec3 voxel = ivec3(round(worldVolumeCoord));
 
-		// if 0 direction in an axis, it's unconstrained, otherwise it is
+	// this represents where the brick holding this world voxel is, if anywhere
+	int slot = texelFetch(worldPageTexture, (voxel + WORLD_BRICK_SIZE) / WORLD_BRICK_SIZE, 0).r;
+	if (slot < 0) {
+		return (slot == WALL_BRICK) ? WALL_CELL_COLOR : vec4(0.0, 0.0, 0.0, 0.0);	// outside the world, or empty space
+	}
 
-		return ivec2[NUM_DIMENSIONS](
-			(d.x == 0) ? ivec2(-1,1) : ivec2(min(d.x, 0), max(d.x, 0)),
-			(d.y == 0) ? ivec2(-1,1) : ivec2(min(d.y, 0), max(d.y, 0)),
-			(d.z == 0) ? ivec2(-1,1) : ivec2(min(d.z, 0), max(d.z, 0))
-		);
+	// this represents the current world state at this voxel
+	vec4 worldCellColor = decodeWorldCell(fetchWorldCell(worldAtlasVoxel(slot, voxel)));
 
-	} else {
-		// direction is zero vector, assume can move in any direction
-		return ivec2[NUM_DIMENSIONS](ivec2(-1,1),ivec2(-1,1),ivec2(-1,1));
-	}
+	return worldCellColor;
 }
 
-highp uint generateAntState(ivec3 displacement, bool hasFood) {
-	highp uint antState = 0u;	// initial -- all flags are zero
+vec4 lookupAntCellColorInTexture() {
+	// this represents which ant we're talking about; antTexture can be narrower than the texture being written
+	int previousAntTextureWidth = textureSize(antTexture, 0).x;
+	int previousAntIndex = int(getPreviousAntIndex());
+	ivec3 antVolumeCoord = ivec3(previousAntIndex % previousAntTextureWidth, previousAntIndex / previousAntTextureWidth, 0);
 
-	if (hasFood) {
-		antState = antState | BITMASK_HAS_FOOD;
-	}
+	// this represents the ant's current state; fetched by texel, since a normalized coordinate can land on the
+	// neighbouring texel when the texture width isn't a power of two
+	vec4 antCellColor = texelFetch(antTexture, antVolumeCoord, 0);
 
-	if (displacement.x > 0) {
-		antState = antState | BITMASK_X_POS;
-	} else if (displacement.x < 0) {
-		antState = antState | BITMASK_X_NEG;
-	}
-
-	if (displacement.y > 0) {
-		antState = antState | BITMASK_Y_POS;
-	} else if (displacement.y < 0) {
-		antState = antState | BITMASK_Y_NEG;
-	}
-
-	if (displacement.z > 0) {
-		antState = antState | BITMASK_Z_POS;
-	} else if (displacement.z < 0) {
-		antState = antState | BITMASK_Z_NEG;
-	}
+	return antCellColor;
+}
 
-	return antState;
+// the trail decays lazily, see simulation_world_fragment.glsl; decodeWorldCell already applied it
+float trailStrengthInWorldCell(vec4 worldCellColor) {
+	return worldCellColor.b;
 }
 
 bool worldCellContainsNest(vec4 worldCellColor) {
@@ -195,129 +213,85 @@ bool worldCellContainsFood(vec4 worldCellColor) {
 	return (worldCellColor.g > 0);
 }
 
-ivec3 reverseAntDirection(ivec3 antDirection) {
-	return -antDirection;
+int reverseAntDirection(int directionCode) {
+	return (NUM_ANT_DIRECTIONS - 1) - directionCode;	// negating every axis mirrors the code
 }
 
-ivec3 getDisplacementToStrongestTrailInFront(highp uint antState, vec3 antPositionInWorld, ivec2 minMaxX, ivec2 minMaxY, ivec2 minMaxZ) {
-	float seed = getSeed();
-
-	ivec3[MAX_NUM_NEIGHBORS] displacementCandidates;
-	float[MAX_NUM_NEIGHBORS] scoresForEachDisplacementCandidate;
-	int displacementCandidatesIndex;
-
-	for (displacementCandidatesIndex = 0; displacementCandidatesIndex < MAX_NUM_NEIGHBORS; displacementCandidatesIndex++) {
-		scoresForEachDisplacementCandidate[displacementCandidatesIndex] = -1000;
-		displacementCandidates[displacementCandidatesIndex] = ivec3(0,0,0);
-	}
-
+ivec3 getDisplacementToStrongestTrailInFront(highp uint antState, vec3 antPositionInWorld, int directionCode) {
 	float thresholdToNotChooseRandomly = 0.9;
 
 	bool hasFood = getHasFoodFromState(antState);
-	
-	// go through each possible cell in front of the ant and see which one has the strongest trail
-	int i, j, k;
-	for (i = minMaxX.s; i <= minMaxX.t; i++) {
-		for (j = minMaxY.s; j <= minMaxY.t; j++) {
-			for (k = minMaxZ.s; k <= minMaxZ.t; k++) {
-				if (i != 0 || j != 0 || k != 0) {	// don't evaluate any spot where we don't move
-					vec4 worldCellColor = lookupWorldCellColorAtCoordinate(antPositionInWorld + ivec3(i,j,k));
-
-					float totalScoreAtThisCell = 0.0;
-
-					float trailScoreAtThisCell = worldCellColor.b * trailScoreMultiplier;
-					float foodScoreAtThisCell = worldCellColor.g * foodNestScoreMultiplier;
-					float nestScoreAtThisCell = worldCellColor.r * foodNestScoreMultiplier;
-
-					if (foodScoreAtThisCell > 0.0 && hasFood) {
-						// we don't want to go to a cell that has food if we already have food
-						foodScoreAtThisCell = -1000;
-					}
-
-					if (nestScoreAtThisCell > 0.0 && !hasFood) {
-						// we don't want to go to a cell that has the nest when we are empty-handed
-						nestScoreAtThisCell = -1000;
-					}
-
-					totalScoreAtThisCell = trailScoreAtThisCell + foodScoreAtThisCell + nestScoreAtThisCell;
-					scoresForEachDisplacementCandidate[displacementCandidatesIndex] = totalScoreAtThisCell;
-					displacementCandidates[displacementCandidatesIndex] = ivec3(i,j,k);
-				}
-
-				displacementCandidatesIndex++;
-			}
-		}
-	}
-	
+
 	float highestScore = 0.0;
 	ivec3 currentDisplacementCandidate = ivec3(0,0,0);
 
-	for (displacementCandidatesIndex = 0; displacementCandidatesIndex < MAX_NUM_NEIGHBORS; displacementCandidatesIndex++) {
-		if (highestScore < scoresForEachDisplacementCandidate[displacementCandidatesIndex]) {
-			highestScore = scoresForEachDisplacementCandidate[displacementCandidatesIndex];
-			currentDisplacementCandidate = displacementCandidates[displacementCandidatesIndex];
+	// go through each possible cell in front of the ant and see which one has the strongest trail
+	int numSteps = antConeMinCorner[directionCode].w;
+	for (int s = 0; s < numSteps; s++) {
+		ivec3 step = antConeSteps[directionCode * MAX_ANT_CONE_STEPS + s].xyz;
+		vec4 worldCellColor = lookupWorldCellColorAtCoordinate(antPositionInWorld + step);
+
+		float trailScoreAtThisCell = trailStrengthInWorldCell(worldCellColor) * trailScoreMultiplier;
+		float foodScoreAtThisCell = worldCellColor.g * foodNestScoreMultiplier;
+		float nestScoreAtThisCell = worldCellColor.r * foodNestScoreMultiplier;
+		float crowdingScoreAtThisCell = worldCellColor.a * crowdingScoreMultiplier;	// ants already in the cell
+
+		if (foodScoreAtThisCell > 0.0 && hasFood) {
+			// we don't want to go to a cell that has food if we already have food
+			foodScoreAtThisCell = -1000;
+		}
+
+		if (nestScoreAtThisCell > 0.0 && !hasFood) {
+			// we don't want to go to a cell that has the nest when we are empty-handed
+			nestScoreAtThisCell = -1000;
+		}
+
+		float totalScoreAtThisCell = trailScoreAtThisCell + foodScoreAtThisCell + nestScoreAtThisCell - crowdingScoreAtThisCell;
+
+		if (worldCellIsWall(worldCellColor)) {
+			totalScoreAtThisCell = -1000;	// never follow a trail out of the world
+		}
+
+		if (highestScore < totalScoreAtThisCell) {
+			highestScore = totalScoreAtThisCell;
+			currentDisplacementCandidate = step;
 		}
 	}
 
-	float strengthOfFreeWill = getRandBetween(0, 1, ++seed);
+	float strengthOfFreeWill = random(RANDOM_STREAM_ANT_MOVE, 0u);
 	
 	if (highestScore <= thresholdToNotChooseRandomly || strengthOfFreeWill >= freeWillThreshold) {
 		// no strong trail in front, just return some random displacement
+		ivec3 minCorner = antConeMinCorner[directionCode].xyz;
+		ivec3 maxCorner = antConeMaxCorner[directionCode].xyz;
 		currentDisplacementCandidate = ivec3(
-			round(getRandBetween(minMaxX.s, minMaxX.t, ++seed)),
-			round(getRandBetween(minMaxY.s, minMaxY.t, ++seed)),
-			round(getRandBetween(minMaxZ.s, minMaxZ.t, ++seed))
+			randomIntBetween(minCorner.x, maxCorner.x, random(RANDOM_STREAM_ANT_MOVE, 1u)),
+			randomIntBetween(minCorner.y, maxCorner.y, random(RANDOM_STREAM_ANT_MOVE, 2u)),
+			randomIntBetween(minCorner.z, maxCorner.z, random(RANDOM_STREAM_ANT_MOVE, 3u))
 		);
 	}
 
 	return currentDisplacementCandidate;
 }
 
+// a random step can still take an ant one voxel into the halo; along every axis where its next step would leave
+// the world, it heads back in (selects instead of branches, like CpuSimulationBackend::handleEdgeBoundaries)
 ivec3 handleEdgeBoundaries(const ivec3 initialAntDirection, const vec3 antPositionInWorld) {
-	ivec3 outputAntDirection = initialAntDirection;
-
-	float minX = 0;
-	float maxX = 1.0/inverseWorldTextureSize.x - 1;
-	float minY = 0;
-	float maxY = 1.0/inverseWorldTextureSize.y - 1;
-	float minZ = 0;
-	float maxZ = 1.0/inverseWorldTextureSize.z - 1;
-
-	if (antPositionInWorld.x + initialAntDirection.x < minX) {
-		outputAntDirection.x = 1;
-	}
-
-	if (antPositionInWorld.x + initialAntDirection.x > maxX) {
-		outputAntDirection.x = -1;
-	}
-
-	if (antPositionInWorld.y + initialAntDirection.y < minY) {
-		outputAntDirection.y = 1;
-	}
-
-	if (antPositionInWorld.y + initialAntDirection.y > maxY) {
-		outputAntDirection.y = -1;
-	}
-
-	if (antPositionInWorld.z + initialAntDirection.z < minZ) {
-		outputAntDirection.z = 1;
-	}
-
-	if (antPositionInWorld.z + initialAntDirection.z > maxZ) {
-		outputAntDirection.z = -1;
-	}
+	ivec3 worldSize = ivec3(round(1.0 / inverseWorldTextureSize));
+	ivec3 nextPosition = ivec3(round(antPositionInWorld)) + initialAntDirection;
+	ivec3 below = ivec3(lessThan(nextPosition, ivec3(0)));
+	ivec3 above = ivec3(greaterThan(nextPosition, worldSize - 1));
 
-	return outputAntDirection;
+	return initialAntDirection + below * (1 - initialAntDirection) + above * (-1 - initialAntDirection);
 }
 
 vec4 moveAnt(vec4 antCellColor) {
-	float seed = getSeed();
-
 	vec3 antPositionInWorld = getAntPositionInWorldFromColor(antCellColor); // in values [0,1,2,...,15]
 	highp uint antState = getAntStateFromColor(antCellColor);
 
 	bool hasFood = getHasFoodFromState(antState);
-	ivec3 antDirection = getAntDirectionFromState(antState);
+	int directionCode = getAntDirectionCodeFromState(antState);
+	ivec3 antDirection = antDirectionStep(directionCode);
 
 	// get the state of the world where the ant is
 	vec4 worldCellColor = lookupWorldCellColorAtCoordinate(antPositionInWorld);
@@ -325,28 +299,26 @@ vec4 moveAnt(vec4 antCellColor) {
 	ivec3 antDirectionAfterEdgeHandling = handleEdgeBoundaries(antDirection, antPositionInWorld);
 
 	if (antDirectionAfterEdgeHandling != antDirection) {
-		antDirection = antDirectionAfterEdgeHandling;
+		directionCode = antDirectionCode(antDirectionAfterEdgeHandling);
 	} else if (worldCellContainsNest(worldCellColor) && hasFood) {
 		// drop any food that is carried
 		hasFood = false;
 
 		// turn around
-		antDirection = reverseAntDirection(antDirection);
+		directionCode = reverseAntDirection(directionCode);
 	} else if (worldCellContainsFood(worldCellColor) && !hasFood) {
 		// pick up some food here
 		hasFood = true;
 
 		// turn around
-		antDirection = reverseAntDirection(antDirection);
+		directionCode = reverseAntDirection(directionCode);
 	}
 
-	ivec2[NUM_DIMENSIONS] validMinMaxes = getValidMovementRangesBasedOnDirectionVector(antDirection);
-
-	ivec3 displacement = getDisplacementToStrongestTrailInFront(antState, antPositionInWorld, validMinMaxes[0], validMinMaxes[1], validMinMaxes[2]);
+	ivec3 displacement = getDisplacementToStrongestTrailInFront(antState, antPositionInWorld, directionCode);
 
 	antPositionInWorld += displacement;
 
-	antState = generateAntState(displacement, hasFood);
+	antState = generateAntState(antDirectionCode(displacement), hasFood);
 
 	vec4 updatedAntCellColor = getAntCellColorFromAntPositionInWorldAndState(antPositionInWorld, antState);
 
@@ -356,8 +328,6 @@ vec4 moveAnt(vec4 antCellColor) {
 
 void init()
 {
-	float seed = getSeed();
-
 	// this represents the XYZ placement of this ant in the world
 
 	vec3 centerOfWorld = 1.0 / inverseWorldTextureSize / 2.0;	// if texture size is 16x16x16, this gets element 8,8,8
@@ -367,12 +337,12 @@ void init()
 	bool hasFood = false;
 
 	ivec3 initialAntDirection = ivec3(
-		round(getRandBetween(-1, 1, ++seed)),
-		round(getRandBetween(-1, 1, ++seed)),
-		round(getRandBetween(-1, 1, ++seed))
+		randomIntBetween(-1, 1, random(RANDOM_STREAM_ANT_INIT, 0u)),
+		randomIntBetween(-1, 1, random(RANDOM_STREAM_ANT_INIT, 1u)),
+		randomIntBetween(-1, 1, random(RANDOM_STREAM_ANT_INIT, 2u))
 	);
 
-	highp uint initialAntState = generateAntState(initialAntDirection, hasFood);
+	highp uint initialAntState = generateAntState(antDirectionCode(initialAntDirection), hasFood);
 
 	gl_FragColor = getAntCellColorFromAntPositionInWorldAndState(initialAntPositionInWorld, initialAntState);
 }
@@ -388,8 +358,12 @@ void update()
 
 void main()
 {
-	if (initialized == 0) {
-		init();
+	if (getAntIndex() >= numAnts) {
+		discard;
+	}
+
+	if (getPreviousAntIndex() >= numPreviousAnts) {
+		init();	// spawned this tick, or at restart
 	} else {
 		update();
 	}
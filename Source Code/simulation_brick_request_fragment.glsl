@@ -0,0 +1,11 @@
+#version 330
+
+// blended with GL_MAX into the GL_R8 brick request texture, so a brick ends up with the request bits of every ant that
+// marked it (a pinning request also touches); read back as bytes
+
+flat in int brickRequest;
+
+void main()
+{
+	gl_FragColor = vec4(float(brickRequest) / 255.0, 0.0, 0.0, 0.0);
+}
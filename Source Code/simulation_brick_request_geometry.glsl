@@ -0,0 +1,52 @@
+#version 150 compatibility
+
+// one point per ant, from simulation_scatter_vertex.glsl with antVoxelsOnly set; emits a point at the texel of every
+// brick within two voxels of the ant, in the brick request texture (one texel per brick of the world): the bricks the
+// ant can read or write on the next tick, when it moves at most one voxel and then deposits into the voxels around it
+
+layout(points) in;
+layout(points, max_vertices = 8) out;	// a brick is wider than the box around the ant, so it spans at most two along each axis
+
+const int WORLD_BRICK_SIZE = 8;	// same brick layout as BrickedWorld.h
+const int BRICK_REQUEST_RADIUS = 2;
+
+// same bits as BRICK_REQUEST_TOUCH and BRICK_REQUEST_PIN in BrickedWorld.h
+const int BRICK_REQUEST_TOUCH = 1;
+const int BRICK_REQUEST_PIN = 2;
+
+uniform ivec3 worldSize;
+uniform ivec3 worldSizeInBricks;
+
+flat in ivec3 scatterVoxel[1];
+
+flat out int brickRequest;
+
+void main()
+{
+	ivec3 antPositionInWorld = scatterVoxel[0];
+
+	// like BrickedWorld::touchNeighborhood: the box is clamped to the world, and only the brick of an ant inside the
+	// world is pinned
+	ivec3 antVoxel = clamp(antPositionInWorld, ivec3(0), worldSize - 1);
+	bool antInWorld = (antVoxel == antPositionInWorld);
+	ivec3 antBrick = antVoxel / WORLD_BRICK_SIZE;
+
+	ivec3 minBrick = max(antPositionInWorld - BRICK_REQUEST_RADIUS, ivec3(0)) / WORLD_BRICK_SIZE;
+	ivec3 maxBrick = min(antPositionInWorld + BRICK_REQUEST_RADIUS, worldSize - 1) / WORLD_BRICK_SIZE;
+
+	for (int bz = minBrick.z; bz <= maxBrick.z; bz++) {
+		for (int by = minBrick.y; by <= maxBrick.y; by++) {
+			for (int bx = minBrick.x; bx <= maxBrick.x; bx++) {
+				ivec3 brick = ivec3(bx, by, bz);
+
+				gl_Layer = brick.z;
+				brickRequest = (antInWorld && brick == antBrick) ? (BRICK_REQUEST_TOUCH | BRICK_REQUEST_PIN) : BRICK_REQUEST_TOUCH;
+
+				// centre of texel (x,y) in the layer
+				gl_Position = vec4((vec2(brick.xy) + 0.5) / vec2(worldSizeInBricks.xy) * 2.0 - 1.0, 0.0, 1.0);
+				EmitVertex();
+				EndPrimitive();
+			}
+		}
+	}
+}
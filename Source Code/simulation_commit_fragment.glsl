@@ -0,0 +1,20 @@
+#version 330
+
+// copies one updated layer of the voxels the ants touched back into the world texture of that layer, and clears their
+// deposit counts for the next tick; the food layer is committed through a framebuffer without the deposit texture,
+// since its points only cover the ants' own voxels and the trail commit clears all the counts
+
+uniform usampler3D updatedWorldTexture;
+
+in float volumeLayer;
+
+layout(location = 0) out uvec4 worldCell;	// world texture of the layer
+layout(location = 1) out vec4 deposit;	// deposit texture
+
+void main()
+{
+	ivec3 worldVolumeCoord = ivec3(vec3(gl_FragCoord.xy, volumeLayer) - 0.5);
+
+	worldCell = texelFetch(updatedWorldTexture, worldVolumeCoord, 0);
+	deposit = vec4(0.0, 0.0, 0.0, 0.0);
+}
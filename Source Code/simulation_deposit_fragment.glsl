@@ -0,0 +1,16 @@
+#version 330
+
+// additively blended into the deposit texture:
+// red = number of ants in this voxel
+// green = number of ants in the 26 voxels around it
+
+flat in int isAntVoxel;
+
+void main()
+{
+	if (isAntVoxel == 1) {
+		gl_FragColor = vec4(1.0, 0.0, 0.0, 0.0);
+	} else {
+		gl_FragColor = vec4(0.0, 1.0, 0.0, 0.0);
+	}
+}
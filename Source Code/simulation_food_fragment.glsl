@@ -0,0 +1,40 @@
+#version 330
+
+#extension GL_EXT_geometry_shader4 : enable
+#extension GL_EXT_gpu_shader4 : enable
+
+uniform float foodPickupRate;
+
+// a brick atlas (see BrickedWorld.h), and this pass only runs on the atlas voxels the ants stand in after this tick's
+// moves (see FragmentSimulationBackend::updateAntFood)
+uniform usampler3D worldFoodTexture;
+
+in float volumeLayer;
+
+layout(location = 0) out uvec4 updatedFoodCell;
+
+ivec3 getWorldAtlasVoxel() {
+	return ivec3(vec3(gl_FragCoord.xy, volumeLayer) - 0.5);
+}
+
+// the food layer of a cell, same layout as WorldCell.h:
+// red = food, signed 8.8 fixed point (below zero where ants have been without finding food; 0x8000 only marks halo walls)
+// it only changes where an ant stands; the ants are counted in the trail layer (see simulation_world_fragment.glsl)
+float foodInFoodLayer(uvec4 foodLayer) {
+	return float((int(foodLayer.r) << 16) >> 16) / 256.0;	// sign-extend the low 16 bits
+}
+
+// saturates the food to what the channel can hold, like packFoodLayer
+uvec4 encodeFoodLayer(float food) {
+	return uvec4(uint(int(clamp(floor(food * 256.0 + 0.5), -32767.0, 32767.0))) & 0xFFFFu, 0u, 0u, 0u);
+}
+
+void main()
+{
+	uvec4 foodLayer = texelFetch(worldFoodTexture, getWorldAtlasVoxel(), 0);
+
+	// every point of this pass is at an ant
+	float food = foodInFoodLayer(foodLayer) - foodPickupRate;	// assume ant has picked up some food
+
+	updatedFoodCell = encodeFoodLayer(food);
+}
@@ -0,0 +1,51 @@
+#version 430
+
+// one workgroup per resident brick of the atlas, like simulation_world_compute.glsl: restamps the trail layer of the
+// cells that have gone WORLD_CELL_RESTAMP_INTERVAL ticks or more without being reinforced, in place (see
+// restampWorldCell in WorldCell.h). Only runs every WORLD_CELL_RESTAMP_INTERVAL ticks
+
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 8) in;	// one brick, WORLD_BRICK_SIZE in BrickedWorld.h
+
+uniform float trailDissipationPerFrame;
+uniform uint worldTick;	// the tick that the world image currently holds, and the new stamp
+
+uniform ivec3 worldAtlasSizeInBricks;
+uniform int numSlotsInUse;	// slots past this one have never been handed out
+
+layout(rg16ui, binding = 0) uniform uimage3D worldTrailImage;	// same image unit as in simulation_world_compute.glsl
+
+// same trail layer as simulation_world_compute.glsl
+const uint WORLD_CELL_TICK_MASK = 0xFFFFu;
+const uint WORLD_CELL_RESTAMP_INTERVAL = 0x8000u;
+const uint WORLD_CELL_ANTS = 0x8000u;
+
+float trailStrengthInTrailLayer(uvec4 trailLayer, uint tick) {
+	uint age = (tick - trailLayer.g) & WORLD_CELL_TICK_MASK;
+	float storedTrail = ((trailLayer.r & WORLD_CELL_ANTS) != 0u) ? 1.0 : float(trailLayer.r) / 32767.0;
+	return max(storedTrail - trailDissipationPerFrame * float(age), 0.0);
+}
+
+// a restamped cell has no ants at the new stamp, so this only stores the trail
+uvec4 encodeTrailLayer(float trail, uint tick) {
+	return uvec4(uint(floor(clamp(trail, 0.0, 1.0) * 32767.0 + 0.5)), tick & WORLD_CELL_TICK_MASK, 0u, 0u);
+}
+
+void main()
+{
+	int slot = int(gl_WorkGroupID.x + worldAtlasSizeInBricks.x * (gl_WorkGroupID.y + worldAtlasSizeInBricks.y * gl_WorkGroupID.z));
+	if (slot >= numSlotsInUse) {
+		return;	// the last layer of workgroups is only partly filled
+	}
+
+	ivec3 atlasVoxel = ivec3(gl_GlobalInvocationID);
+
+	uvec4 trailLayer = imageLoad(worldTrailImage, atlasVoxel);
+
+	// a cell with no trail and no ants reads the same under any stamp
+	uint age = (worldTick - trailLayer.g) & WORLD_CELL_TICK_MASK;
+	if (age < WORLD_CELL_RESTAMP_INTERVAL || trailLayer.r == 0u) {
+		return;
+	}
+
+	imageStore(worldTrailImage, atlasVoxel, encodeTrailLayer(trailStrengthInTrailLayer(trailLayer, worldTick), worldTick));
+}
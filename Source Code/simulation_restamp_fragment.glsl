@@ -0,0 +1,43 @@
+#version 330
+
+// restamps the trail layer of every atlas voxel that has gone WORLD_CELL_RESTAMP_INTERVAL ticks or more without being
+// reinforced (see restampWorldCell in WorldCell.h), and copies every other voxel as it is, so the output replaces the
+// whole trail layer (see FragmentSimulationBackend::restampWorld). Only runs every WORLD_CELL_RESTAMP_INTERVAL ticks
+
+uniform float trailDissipationPerFrame;
+uniform uint worldTick;	// the tick that worldTrailTexture currently holds, and the new stamp
+
+uniform usampler3D worldTrailTexture;	// the brick atlas of BrickedWorld.h
+
+in float volumeLayer;
+
+layout(location = 0) out uvec4 restampedTrailCell;
+
+// same trail layer as simulation_world_fragment.glsl
+const uint WORLD_CELL_TICK_MASK = 0xFFFFu;
+const uint WORLD_CELL_RESTAMP_INTERVAL = 0x8000u;
+const uint WORLD_CELL_ANTS = 0x8000u;
+
+float trailStrengthInTrailLayer(uvec4 trailLayer, uint tick) {
+	uint age = (tick - trailLayer.g) & WORLD_CELL_TICK_MASK;
+	float storedTrail = ((trailLayer.r & WORLD_CELL_ANTS) != 0u) ? 1.0 : float(trailLayer.r) / 32767.0;
+	return max(storedTrail - trailDissipationPerFrame * float(age), 0.0);
+}
+
+// a restamped cell has no ants at the new stamp, so this only stores the trail
+uvec4 encodeTrailLayer(float trail, uint tick) {
+	return uvec4(uint(floor(clamp(trail, 0.0, 1.0) * 32767.0 + 0.5)), tick & WORLD_CELL_TICK_MASK, 0u, 0u);
+}
+
+void main()
+{
+	uvec4 trailLayer = texelFetch(worldTrailTexture, ivec3(vec3(gl_FragCoord.xy, volumeLayer) - 0.5), 0);
+
+	// a cell with no trail and no ants reads the same under any stamp
+	uint age = (worldTick - trailLayer.g) & WORLD_CELL_TICK_MASK;
+	if (age < WORLD_CELL_RESTAMP_INTERVAL || trailLayer.r == 0u) {
+		restampedTrailCell = trailLayer;
+	} else {
+		restampedTrailCell = encodeTrailLayer(trailStrengthInTrailLayer(trailLayer, worldTick), worldTick);
+	}
+}
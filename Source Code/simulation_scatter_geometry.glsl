@@ -0,0 +1,49 @@
+#version 150 compatibility
+
+layout(points) in;
+layout(points, max_vertices = 1) out;
+
+const int WORLD_BRICK_SIZE = 8;	// same brick layout as BrickedWorld.h
+
+uniform isampler3D worldPageTexture;	// atlas slot of every brick of the world, -1 if the brick isn't resident; offset by the halo
+uniform ivec3 worldAtlasSizeInBricks;	// how the slots are laid out in the atlas textures
+
+flat in ivec3 scatterVoxel[1];
+flat in int scatterIsAntVoxel[1];
+
+flat out int isAntVoxel;
+out float volumeLayer;	// same as simulation_geometry.glsl, so the world fragment shader can run on these points
+
+ivec3 worldAtlasVoxel(int slot, ivec3 worldVolumeCoord) {
+	ivec3 atlasBrick = ivec3(
+		slot % worldAtlasSizeInBricks.x,
+		(slot / worldAtlasSizeInBricks.x) % worldAtlasSizeInBricks.y,
+		slot / (worldAtlasSizeInBricks.x * worldAtlasSizeInBricks.y));
+	return atlasBrick * WORLD_BRICK_SIZE + (worldVolumeCoord & (WORLD_BRICK_SIZE - 1));
+}
+
+void main()
+{
+	ivec3 voxel = scatterVoxel[0];
+
+	// the host makes the bricks around the ants resident before these passes, so this only fails if the pool is full,
+	// or in the halo of wall bricks: ants can stand one voxel past the edge of the world, so part of their
+	// neighbourhood is outside it
+	int slot = texelFetch(worldPageTexture, (voxel + WORLD_BRICK_SIZE) / WORLD_BRICK_SIZE, 0).r;
+	if (slot < 0) {
+		return;
+	}
+
+	ivec3 atlasVoxel = worldAtlasVoxel(slot, voxel);
+	vec2 atlasLayerSize = vec2(worldAtlasSizeInBricks.xy * WORLD_BRICK_SIZE);
+
+	gl_Layer = atlasVoxel.z;
+
+	isAntVoxel = scatterIsAntVoxel[0];
+	volumeLayer = float(gl_Layer) + 0.5;
+
+	// centre of texel (x,y) in the atlas layer
+	gl_Position = vec4((vec2(atlasVoxel.xy) + 0.5) / atlasLayerSize * 2.0 - 1.0, 0.0, 1.0);
+	EmitVertex();
+	EndPrimitive();
+}
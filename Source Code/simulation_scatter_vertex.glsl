@@ -0,0 +1,35 @@
+#version 330
+
+// one vertex per (ant, neighbour offset): gl_VertexID is the ant index, laid out row by row in the ant texture like
+// getAntIndex() in simulation_ant_fragment.glsl; gl_InstanceID picks one of the 27 voxels around the ant (instance 13 is
+// the ant's own voxel)
+// used by every pass that only touches the voxels around the ants: deposit, trail and food updates, and their commits;
+// also by the brick requests, which only need the ants' own voxels
+
+uniform sampler3D antTexture;
+
+uniform bool antVoxelsOnly;	// for the passes over the food layer, which draw a single instance of just the ants' own voxels
+
+uniform vec3 inverseWorldTextureSize;
+
+flat out ivec3 scatterVoxel;
+flat out int scatterIsAntVoxel;
+
+vec3 getAntPositionInWorldFromColor(vec4 antCellColor) {
+	return (antCellColor.rgb / inverseWorldTextureSize) - 0.5;
+}
+
+void main()
+{
+	int antTextureWidth = textureSize(antTexture, 0).x;
+	vec4 antCellColor = texelFetch(antTexture, ivec3(gl_VertexID % antTextureWidth, gl_VertexID / antTextureWidth, 0), 0);
+
+	ivec3 antPositionInWorld = ivec3(round(getAntPositionInWorldFromColor(antCellColor)));	// in values [-1,0,1,...,16]
+
+	ivec3 offset = antVoxelsOnly ? ivec3(0, 0, 0) : ivec3(gl_InstanceID % 3, (gl_InstanceID / 3) % 3, gl_InstanceID / 9) - 1;
+
+	scatterVoxel = antPositionInWorld + offset;
+	scatterIsAntVoxel = (offset == ivec3(0, 0, 0)) ? 1 : 0;
+
+	gl_Position = vec4(0.0, 0.0, 0.0, 1.0);	// the geometry shader places the point
+}
@@ -0,0 +1,89 @@
+#version 430
+
+// one workgroup per resident brick of the atlas: updates the voxels the deposit pass counted ants in or around,
+// in place, and clears their counts for the next tick; every other voxel keeps decaying lazily
+
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 8) in;	// one brick, WORLD_BRICK_SIZE in BrickedWorld.h
+
+uniform float trailDissipationPerFrame;
+uniform float foodPickupRate;
+uniform uint worldTick;	// the tick that the world image currently holds; this pass writes tick worldTick+1
+
+uniform ivec3 worldAtlasSizeInBricks;
+uniform int numSlotsInUse;	// slots past this one have never been handed out
+
+layout(rg16ui, binding = 0) uniform uimage3D worldTrailImage;	// the dynamic layers of the packed cells, the brick atlas of BrickedWorld.h
+layout(r32ui, binding = 1) uniform uimage3D antCountImage;	// written by simulation_ant_compute.glsl
+layout(r32ui, binding = 2) uniform uimage3D nearbyAntCountImage;
+layout(r16ui, binding = 3) uniform uimage3D worldFoodImage;
+
+// every cell is packed into three layers, same layout as WorldCell.h and simulation_world_fragment.glsl /
+// simulation_food_fragment.glsl:
+// trail layer: red = bit 15 clear: trail strength when the cell was last reinforced, 15-bit unorm; bit 15 set: ants
+// stood in the cell at that tick, leaving the trail at full strength, and bits 0-6 count them; green = low 16 bits of that tick
+// food layer: red = food, signed 8.8 fixed point
+// the trail layer is stored in every voxel in or around an ant, which also drops the count of a voxel an ant just left;
+// the food layer only where an ant stands. The terrain layer (the nest) never changes, so this pass doesn't bind it
+const uint WORLD_CELL_TICK_MASK = 0xFFFFu;
+const uint WORLD_CELL_MAX_ANTS = 127u;
+const uint WORLD_CELL_ANTS = 0x8000u;
+
+float foodInFoodLayer(uvec4 foodLayer) {
+	return float((int(foodLayer.r) << 16) >> 16) / 256.0;	// sign-extend the low 16 bits
+}
+
+float trailStrengthInTrailLayer(uvec4 trailLayer, uint tick) {
+	uint age = (tick - trailLayer.g) & WORLD_CELL_TICK_MASK;
+	float storedTrail = ((trailLayer.r & WORLD_CELL_ANTS) != 0u) ? 1.0 : float(trailLayer.r) / 32767.0;
+	return max(storedTrail - trailDissipationPerFrame * float(age), 0.0);
+}
+
+// saturates the trail and the count to what the channel can hold, like packTrailLayer
+uvec4 encodeTrailLayer(float trail, uint ants, uint tick) {
+	uint trailAnts = (ants > 0u) ? (WORLD_CELL_ANTS | min(ants, WORLD_CELL_MAX_ANTS)) : uint(floor(clamp(trail, 0.0, 1.0) * 32767.0 + 0.5));
+	return uvec4(trailAnts, tick & WORLD_CELL_TICK_MASK, 0u, 0u);
+}
+
+// saturates the food to what the channel can hold, like packFoodLayer
+uvec4 encodeFoodLayer(float food) {
+	return uvec4(uint(int(clamp(floor(food * 256.0 + 0.5), -32767.0, 32767.0))) & 0xFFFFu, 0u, 0u, 0u);
+}
+
+void main()
+{
+	int slot = int(gl_WorkGroupID.x + worldAtlasSizeInBricks.x * (gl_WorkGroupID.y + worldAtlasSizeInBricks.y * gl_WorkGroupID.z));
+	if (slot >= numSlotsInUse) {
+		return;	// the last layer of workgroups is only partly filled
+	}
+
+	ivec3 atlasVoxel = ivec3(gl_GlobalInvocationID);
+
+	uint antCount = imageLoad(antCountImage, atlasVoxel).r;
+	uint nearbyAntCount = imageLoad(nearbyAntCountImage, atlasVoxel).r;
+	if (antCount == 0u && nearbyAntCount == 0u) {
+		return;	// no ant in or around this voxel
+	}
+
+	uvec4 trailLayer = imageLoad(worldTrailImage, atlasVoxel);
+
+	float trailStrength = trailStrengthInTrailLayer(trailLayer, worldTick);
+
+	if (antCount > 0u) {
+		// ant is right on this location
+		trailStrength = 1.0;	// turn trail up to full strength
+
+		float food = foodInFoodLayer(imageLoad(worldFoodImage, atlasVoxel)) - foodPickupRate;	// assume ant has picked up some food
+		imageStore(worldFoodImage, atlasVoxel, encodeFoodLayer(food));
+	} else {
+		// each nearby ant adds 0.1, clamped to [0,1] after every addition
+		trailStrength = min(max(trailStrength + 0.1, 0.0) + 0.1 * (float(nearbyAntCount) - 1.0), 1.0);
+
+		// dissipate trail for this tick right away, as it would have been for an untouched cell
+		trailStrength = max(trailStrength - trailDissipationPerFrame, 0.0);
+	}
+
+	imageStore(worldTrailImage, atlasVoxel, encodeTrailLayer(trailStrength, antCount, worldTick + 1u));	// and count the ants present
+
+	imageStore(antCountImage, atlasVoxel, uvec4(0u));
+	imageStore(nearbyAntCountImage, atlasVoxel, uvec4(0u));
+}
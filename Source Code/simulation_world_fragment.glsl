@@ -3,182 +3,71 @@
 #extension GL_EXT_geometry_shader4 : enable 
 #extension GL_EXT_gpu_shader4 : enable 
 
-uniform int initialized;
-
-uniform float randomSeed;
-uniform float initialFoodRatio;
 uniform float trailDissipationPerFrame;
-uniform float foodPickupRate;
-
-uniform sampler3D worldTexture;
-uniform sampler3D antTexture;
+uniform uint worldTick;	// the tick that worldTrailTexture currently holds; this pass writes tick worldTick+1
 
-uniform vec3 inverseWorldTextureSize;
-uniform vec3 inverseAntTextureSize;
+// both are brick atlases (see BrickedWorld.h), and this pass runs on the atlas voxels of the world voxels around the ants
+uniform usampler3D worldTrailTexture;
+uniform sampler3D depositTexture;	// written by the deposit pass from the new ant positions
 
 in float volumeLayer;
 
-// pseudorandom seed
-// http://byteblacksmith.com/improvements-to-the-canonical-one-liner-glsl-rand-for-opengl-es-2-0/
-float rand(vec2 co)
-{
-    float a = 12.9898;
-    float b = 78.233;
-    float c = 43758.5453;
-    float dt= dot(co.xy ,vec2(a,b));
-    float sn= mod(dt,3.14);
-    return fract(sin(sn) * c);
-}
-
-vec3 getWorldVolumeCoord() {
-	return vec3(gl_FragCoord.xy, volumeLayer)-0.5;
-}
-
-vec3 lookupWorldTextureCoord() {
-	// this represents which world voxel we're dealing with here
-	vec3 worldVolumeCoord = getWorldVolumeCoord();		// in values [0,1,2,...,15]
-
-	// this represents where to look in the world texture to find this world voxel
-	vec3 worldTextureCoord = inverseWorldTextureSize*(worldVolumeCoord+0.5);	 // in values [0.5/16,1.5/16,2.5/16,...,15.5/16]
-	return worldTextureCoord;
-}
-
-float getSeed() {
-	vec3 worldTextureCoord = lookupWorldTextureCoord();
-
-	// based on combo of frag coord and current color
-	float fragCoordSeedXY = rand(worldTextureCoord.xy);
-	float fragCoordSeedYZ = rand(worldTextureCoord.yz);
-
-	float fragCoordSeedXYZ = rand(vec2(fragCoordSeedXY, fragCoordSeedYZ));
+layout(location = 0) out uvec4 updatedTrailCell;
 
-	return rand(vec2(fragCoordSeedXYZ, randomSeed));
+ivec3 getWorldAtlasVoxel() {
+	return ivec3(vec3(gl_FragCoord.xy, volumeLayer) - 0.5);
 }
 
-float getRandBetween(float low, float high, float seed) {
-	return mix(low,high,rand(vec2(seed,seed+1)));
+// every cell is packed into three layers, same layout as WorldCell.h. This pass only writes the trail layer, which is
+// the only part of a cell that changes in every voxel around an ant:
+// red = bit 15 clear: trail strength when the cell was last reinforced, 15-bit unorm
+//       bit 15 set: ants stood in the cell at that tick, leaving the trail at full strength; bits 0-6 count them
+// green = low 16 bits of the tick the cell was last reinforced
+// the trail decays lazily: its strength at any later tick is computed from the stamp, so only touched cells are ever
+// written. Restamping the voxel an ant just left drops its count along with it. The food layer only changes where the
+// ants are, see simulation_food_fragment.glsl, and the terrain layer (the nest) never does
+const uint WORLD_CELL_TICK_MASK = 0xFFFFu;
+const uint WORLD_CELL_MAX_ANTS = 127u;
+const uint WORLD_CELL_ANTS = 0x8000u;
+
+float trailStrengthInTrailLayer(uvec4 trailLayer, uint tick) {
+	uint age = (tick - trailLayer.g) & WORLD_CELL_TICK_MASK;
+	float storedTrail = ((trailLayer.r & WORLD_CELL_ANTS) != 0u) ? 1.0 : float(trailLayer.r) / 32767.0;
+	return max(storedTrail - trailDissipationPerFrame * float(age), 0.0);
 }
 
-vec4 getBaseWorldColor(vec4 lastFrameColor) {
-	// red = nest
-	// green = food
-	// blue = trail
-	// we don't want to persist info about the ant (alpha) if it's moved away
-	return vec4(lastFrameColor.r, lastFrameColor.g, lastFrameColor.b, 0.0);
-}
-
-bool locationsOverlapOnWorld(vec3 queryLocation, vec3 targetLocation)
-{
-	vec3 distance = abs(targetLocation - queryLocation);
-
-	return	(distance.x < 0.5) &&
-			(distance.y < 0.5) &&
-			(distance.z < 0.5);
-}
-
-float getDistanceBetweenLocations(vec3 a, vec3 b) {
-	vec3 d = abs(a - b);
-	return sqrt(pow(d.x,2) + pow(d.y,2) + pow(d.z,2));
-}
-
-void init()
-{
-	float seed = getSeed();
-
-	vec3 worldVolumeCoord = getWorldVolumeCoord();	// in form [0, 1, ..., 15]
-
-	vec3 centerOfWorld = 1.0 / inverseWorldTextureSize / 2.0;	// if texture size is 16x16x16, this gets element 8,8,8
-
-	if (getDistanceBetweenLocations(centerOfWorld, worldVolumeCoord) < 2.0) {
-		gl_FragColor = vec4(1.0, 0.0, 0.0, 0.0);	// establish the nest at the center of the world
-	} else if (getRandBetween(0.0, 1.0, ++seed) < initialFoodRatio) {
-		gl_FragColor = vec4(0.0, 1.0, 0.0, 0.0);	// put food here
-	} else {
-		gl_FragColor = vec4(0.0, 0.0, 0.0, 0.0);	// default; nothing here
-	}
-}
-
-vec4 lookupWorldCellColorInTexture() {
-	// this represents which world voxel we're dealing with here
-	vec3 worldVolumeCoord = getWorldVolumeCoord();	// in values [0,1,2,...,15]
-
-	// this represents where to look in the world texture to find this world voxel
-	vec3 worldTextureCoord = inverseWorldTextureSize*(worldVolumeCoord+0.5); // in values [0.5/16,1.5/16,2.5/16,...,15.5/16]
-
-	// this represents the current world state at this voxel
-	vec4 worldCellColor = texture(worldTexture, worldTextureCoord);
-
-	return worldCellColor;
-}
-
-// alpha defines ant state (direction, has-food)
-// 32-bit float
-const uint BITMASK_HAS_FOOD = 1u << 0;
-const uint BITMASK_X_POS = 1u << 1;
-const uint BITMASK_X_NEG = 1u << 2;
-const uint BITMASK_Y_POS = 1u << 3;
-const uint BITMASK_Y_NEG = 1u << 4;
-const uint BITMASK_Z_POS = 1u << 5;
-const uint BITMASK_Z_NEG = 1u << 6;
-
-highp uint getAntStateFromColor(vec4 antCellColor) {
-	highp uint antState = uint(antCellColor.a);
-	return antState;
-}
-
-bool getHasFoodFromState(highp uint antState) {
-	return ((antState & BITMASK_HAS_FOOD) > 0u);
-}
-
-vec3 getAntPositionInWorldFromColor(vec4 antCellColor) {
-	return (antCellColor.xyz / inverseWorldTextureSize) - 0.5;
+// saturates the trail and the count to what the channel can hold, like packTrailLayer
+uvec4 encodeTrailLayer(float trail, uint ants, uint tick) {
+	uint trailAnts = (ants > 0u) ? (WORLD_CELL_ANTS | min(ants, WORLD_CELL_MAX_ANTS)) : uint(floor(clamp(trail, 0.0, 1.0) * 32767.0 + 0.5));
+	return uvec4(trailAnts, tick & WORLD_CELL_TICK_MASK, 0u, 0u);
 }
 
+// only runs on the voxels in and around the ants (see simulation_scatter_*.glsl), everything else keeps decaying lazily
 void update()
 {
-	vec4 worldCellColor = getBaseWorldColor(lookupWorldCellColorInTexture());
-
-	vec3 worldVolumeCoord = getWorldVolumeCoord();
-
-	vec3 worldTextureCoord = lookupWorldTextureCoord();
-
-	for (int i = 0; i < 1.0/inverseAntTextureSize.x; i++) {
-		vec3 antTextureCoordinate = (vec3(i, 0, 0) + 0.5) * inverseAntTextureSize;
-
-		vec4 antCellColor = texture(antTexture, antTextureCoordinate);
-
-		highp uint antState = getAntStateFromColor(antCellColor);
+	uvec4 trailLayer = texelFetch(worldTrailTexture, getWorldAtlasVoxel(), 0);
 
-		vec3 antPosition = getAntPositionInWorldFromColor(antCellColor);
+	float trailStrength = trailStrengthInTrailLayer(trailLayer, worldTick);
 
-		float antDistance = getDistanceBetweenLocations(antPosition, worldVolumeCoord);
+	// red = ants in this voxel, green = ants in the 26 voxels around it
+	vec4 deposit = texelFetch(depositTexture, getWorldAtlasVoxel(), 0);
 
-		if (antDistance < 1) {
-			// ant is right on this location
-			worldCellColor.a = 1.0;	// add ant to voxel
-			
-			worldCellColor.b = clamp(worldCellColor.b + 1.0, 0, 1);	// turn trail up to full strength
-
-			worldCellColor.g -= foodPickupRate;	// assume ant has picked up some food
+	if (deposit.r > 0.0) {
+		// ant is right on this location
+		trailStrength = 1.0;	// turn trail up to full strength
+	} else {
+		// each nearby ant adds 0.1, clamped to [0,1] after every addition
+		trailStrength = min(max(trailStrength + 0.1, 0.0) + 0.1 * (deposit.g - 1.0), 1.0);
 
-			gl_FragColor = worldCellColor;
-			return;
-		} else if (antDistance < 2) {
-			worldCellColor.b = clamp(worldCellColor.b + 0.1, 0, 1);
-		}
+		// dissipate trail for this tick right away, as it would have been for an untouched cell
+		trailStrength = max(trailStrength - trailDissipationPerFrame, 0.0);
 	}
 
-	// dissipate trail
-	worldCellColor.b -= trailDissipationPerFrame;
-
-	gl_FragColor = worldCellColor;
+	updatedTrailCell = encodeTrailLayer(trailStrength, uint(deposit.r), worldTick + 1u);
 }
 
 void main()
 {
-	if (initialized == 0) {
-		init();
-	} else {
-		update();
-	}
+	// the initial nest and food are uploaded brick by brick, see BrickedWorld::initialBrickCells
+	update();
 }
\ No newline at end of file
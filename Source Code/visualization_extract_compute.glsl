@@ -0,0 +1,354 @@
+#version 430
+
+// one workgroup per listed 8x8x8 block of the cubes the marching-cubes visualization extracts, cube v having its lowest
+// corner at voxel v like the vertices of visualization_vertex.glsl: runs marching cubes on the block the way
+// visualization_geometry.glsl does, but writes an indexed mesh instead of separate triangles. Every corner of the block
+// owns the edges leading from it along +x, +y and +z, and each edge a surface crosses gets one vertex, which all the
+// triangles around the edge share; its normal is the gradient of the surface's field, interpolated from central
+// differences at the two corners, so the surfaces are shaded smoothly. The cells the block reads, with a ring around
+// them for the differences, are fetched into shared memory once. Prefix sums in shared memory number the vertices of the
+// block and place its triangles, a single atomic add per buffer reserves room for them, and the workgroup writes the draw
+// command of the block, whose indices count from its first vertex (see SurfaceMesh.h)
+
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 8) in;
+
+const int WORLD_BRICK_SIZE = 8;	// same brick layout as BrickedWorld.h; the blocks of cubes line up with the bricks
+const int CUBES_PER_WORKGROUP = 512;
+const int CORNERS_PER_AXIS = WORLD_BRICK_SIZE + 1;	// the last cubes reach the first corners of the next block
+const int CELLS_PER_AXIS = WORLD_BRICK_SIZE + 3;	// and one more on each side for the central differences
+const int NUM_CORNERS = CORNERS_PER_AXIS * CORNERS_PER_AXIS * CORNERS_PER_AXIS;
+const int NUM_CELLS = CELLS_PER_AXIS * CELLS_PER_AXIS * CELLS_PER_AXIS;
+
+const int NUM_SURFACES = 4;	// trail, food, nest and ants, in the components of the cell values, emitted in that order
+const int VERTEX_FLOATS = 10;	// position, normal and colour, the vertex layout of SurfaceMesh
+const int DRAW_COMMAND_WORDS = 5;	// DrawElementsIndirectCommand
+
+uniform usampler3D worldTrailTexture;	// the three layers of the packed cells, see WorldCell.h
+uniform usampler3D worldFoodTexture;
+uniform usampler3D worldTerrainTexture;
+uniform isampler3D worldPageTexture;	// atlas slot of every brick of the world, -1 if the brick isn't resident; offset by the halo
+uniform ivec3 worldAtlasSizeInBricks;	// how the slots are laid out in the world textures
+
+uniform isampler2D triangleTableTexture;	// same table as the geometry shader
+
+uniform ivec3 worldSize;
+uniform vec3 voxelSize;	// the mesh spans [-1,1] like the grid of visualization_vertex.glsl
+uniform uint worldTick;	// the tick that the world textures currently hold
+uniform float trailDissipationPerFrame;
+uniform float trailOpacity;
+
+uniform uint firstBlock;	// of this dispatch; there can be more blocks than a dispatch holds workgroups
+uniform uint vertexBase;	// vertices already in the mesh, in front of this update's
+uniform uint indexBase;
+uniform uint vertexCapacity;	// what the buffers hold; a block that doesn't fit is counted but left out
+uniform uint indexCapacity;
+
+layout(std430, binding = 0) buffer MeshCount {
+	uint requestedVertices;	// all of this update's, whether they fit or not
+	uint requestedIndices;
+};
+
+layout(std430, binding = 1) readonly buffer Blocks {
+	uint blocks[];	// the blocks to extract, x fastest over the world's bricks
+};
+
+layout(std430, binding = 2) writeonly buffer MeshDraws {
+	uint meshDraws[];	// DrawElementsIndirectCommand of every block of the world
+};
+
+layout(std430, binding = 3) writeonly buffer MeshVertices {
+	float meshVertices[];
+};
+
+layout(std430, binding = 4) writeonly buffer MeshIndices {
+	uint meshIndices[];	// from the first vertex of the block
+};
+
+// same thresholds as visualization_geometry.glsl, in the order of NUM_SURFACES
+const vec4 SURFACE_THRESHOLDS = vec4(0.0, 0.0, 0.0, 0.5);
+
+const float ANTS_FOR_LARGEST_GLYPH = 8.0;
+
+// the corners in the order of the cubeVertexDecals of visualization_geometry.glsl, which the triangle table is made for
+const ivec3 CUBE_CORNERS[8] = ivec3[8](
+	ivec3(0, 0, 0), ivec3(1, 0, 0), ivec3(1, 1, 0), ivec3(0, 1, 0),
+	ivec3(0, 0, 1), ivec3(1, 0, 1), ivec3(1, 1, 1), ivec3(0, 1, 1));
+
+// the corner of the cube that owns each edge of the triangle table, and the axis the edge runs along from it
+const ivec4 EDGE_OWNERS[12] = ivec4[12](
+	ivec4(0, 0, 0, 0), ivec4(1, 0, 0, 1), ivec4(0, 1, 0, 0), ivec4(0, 0, 0, 1),
+	ivec4(0, 0, 1, 0), ivec4(1, 0, 1, 1), ivec4(0, 1, 1, 0), ivec4(0, 0, 1, 1),
+	ivec4(0, 0, 0, 2), ivec4(1, 0, 0, 2), ivec4(1, 1, 0, 2), ivec4(0, 1, 0, 2));
+
+const ivec3 AXES[3] = ivec3[3](ivec3(1, 0, 0), ivec3(0, 1, 0), ivec3(0, 0, 1));
+
+shared vec4 cellValues[NUM_CELLS];	// of the four surfaces, at the voxels from one before the block to two past it
+shared uint cornerEdges[NUM_CORNERS];	// the first vertex of the corner's edges, above a bit per crossed edge (surface * 3 + axis)
+shared uint scan[2 * CUBES_PER_WORKGROUP];	// ping-ponged halves of the prefix sum
+shared uint blockVertexBase;
+shared uint blockIndexBase;
+shared bool blockFits;
+
+ivec3 worldAtlasVoxel(int slot, ivec3 worldVolumeCoord) {
+	ivec3 atlasBrick = ivec3(
+		slot % worldAtlasSizeInBricks.x,
+		(slot / worldAtlasSizeInBricks.x) % worldAtlasSizeInBricks.y,
+		slot / (worldAtlasSizeInBricks.x * worldAtlasSizeInBricks.y));
+	return atlasBrick * WORLD_BRICK_SIZE + (worldVolumeCoord & (WORLD_BRICK_SIZE - 1));
+}
+
+// same decoding as visualization_geometry.glsl, in the order of NUM_SURFACES: trail strength at worldTick, food, nest,
+// and the ants in the cell at worldTick, crowds counting as big as the largest glyph
+vec4 decodeWorldCell(uvec4 worldCell) {
+	float nest = ((worldCell.a & 1u) != 0u) ? 1.0 : 0.0;
+	float food = float((int(worldCell.b) << 16) >> 16) / 256.0;
+
+	// bit 15 set: ants stood in the cell at its stamp, and left the trail at full strength
+	bool antsStamped = (worldCell.r & 0x8000u) != 0u;
+	uint age = (worldTick - worldCell.g) & 0xFFFFu;
+	float storedTrail = antsStamped ? 1.0 : float(worldCell.r) / 32767.0;
+	float trail = max(storedTrail - trailDissipationPerFrame * float(age), 0.0);
+
+	float ants = (antsStamped && age == 0u) ? float(worldCell.r & 127u) : 0.0;
+
+	return vec4(trail, food, nest, min(ants, ANTS_FOR_LARGEST_GLYPH));
+}
+
+vec4 lookupWorldCell(ivec3 voxel) {
+	int slot = texelFetch(worldPageTexture, (voxel + WORLD_BRICK_SIZE) / WORLD_BRICK_SIZE, 0).r;
+	if (slot < 0) {
+		return vec4(0.0, 0.0, 0.0, 0.0);	// empty space
+	}
+
+	ivec3 atlasVoxel = worldAtlasVoxel(slot, voxel);
+	return decodeWorldCell(uvec4(texelFetch(worldTrailTexture, atlasVoxel, 0).rg, texelFetch(worldFoodTexture, atlasVoxel, 0).r, texelFetch(worldTerrainTexture, atlasVoxel, 0).r));
+}
+
+int triangleTableValue(int edgeTableIndex, int triangleVertexNumber) {
+	return texelFetch(triangleTableTexture, ivec2(triangleVertexNumber, edgeTableIndex), 0).a;
+}
+
+int cellIndex(ivec3 corner) {	// corner relative to the block, from -1
+	ivec3 cell = corner + 1;
+	return cell.x + CELLS_PER_AXIS * (cell.y + CELLS_PER_AXIS * cell.z);
+}
+
+int cornerIndex(ivec3 corner) {
+	return corner.x + CORNERS_PER_AXIS * (corner.y + CORNERS_PER_AXIS * corner.z);
+}
+
+ivec3 cornerOfIndex(int index, int perAxis) {
+	return ivec3(index % perAxis, (index / perAxis) % perAxis, index / (perAxis * perAxis));
+}
+
+// the edges from the corner that a surface crosses, as bits surface * 3 + axis. Corners past the far edge of the world
+// read the last voxel, as in the geometry shader, but only the edges of the cubes inside the world count
+uint crossedEdges(ivec3 corner, ivec3 cornersInWorld) {
+	if (any(greaterThanEqual(corner, cornersInWorld))) {
+		return 0u;
+	}
+
+	bvec4 inside = greaterThan(cellValues[cellIndex(corner)], SURFACE_THRESHOLDS);
+	uint edges = 0u;
+	for (int axis = 0; axis < 3; axis++) {
+		ivec3 next = corner + AXES[axis];
+		if (next[axis] >= cornersInWorld[axis]) {
+			continue;
+		}
+
+		bvec4 nextInside = greaterThan(cellValues[cellIndex(next)], SURFACE_THRESHOLDS);
+		for (int surface = 0; surface < NUM_SURFACES; surface++) {
+			if (inside[surface] != nextInside[surface]) {
+				edges |= 1u << uint(surface * 3 + axis);
+			}
+		}
+	}
+	return edges;
+}
+
+// the case of each surface in the cube, a bit per corner inside it
+ivec4 cubeCases(ivec3 cube) {
+	ivec4 cases = ivec4(0);
+	for (int cubeVertexIndex = 0; cubeVertexIndex < 8; cubeVertexIndex++) {
+		bvec4 inside = greaterThan(cellValues[cellIndex(cube + CUBE_CORNERS[cubeVertexIndex])], SURFACE_THRESHOLDS);
+		cases |= ivec4(inside) << cubeVertexIndex;
+	}
+	return cases;
+}
+
+int caseTriangles(int edgeTableIndex) {
+	int triangleTableIndex = 0;
+	while (triangleTableValue(edgeTableIndex, triangleTableIndex) != -1) {	// cases 0 and 255 have none
+		triangleTableIndex += 3;
+	}
+	return triangleTableIndex / 3;
+}
+
+// central differences of the surface's field, scaled to the mesh; it grows towards the inside
+vec3 fieldGradient(ivec3 corner, int surface) {
+	return vec3(
+		cellValues[cellIndex(corner + AXES[0])][surface] - cellValues[cellIndex(corner - AXES[0])][surface],
+		cellValues[cellIndex(corner + AXES[1])][surface] - cellValues[cellIndex(corner - AXES[1])][surface],
+		cellValues[cellIndex(corner + AXES[2])][surface] - cellValues[cellIndex(corner - AXES[2])][surface]) / (2.0 * voxelSize);
+}
+
+// same colours as visualization_geometry.glsl; the food darkens as it's eaten and crowds of ants turn orange, by the
+// highest value along the edge
+vec4 surfaceColor(int surface, float highestValue) {
+	if (surface == 0) {
+		return vec4(0.0, 0.0, 1.0, trailOpacity);
+	} else if (surface == 1) {
+		return mix(vec4(0.0, 0.0, 0.0, 1.0), vec4(0.0, 1.0, 0.0, 1.0), highestValue);
+	} else if (surface == 2) {
+		return vec4(1.0, 0.0, 0.0, 1.0);
+	}
+	return mix(vec4(1.0, 1.0, 1.0, 1.0), vec4(1.0, 0.5, 0.0, 1.0), (highestValue - 1.0) / (ANTS_FOR_LARGEST_GLYPH - 1.0));
+}
+
+void writeEdgeVertex(uint vertex, ivec3 blockOrigin, ivec3 corner, int surface, int axis) {
+	ivec3 next = corner + AXES[axis];
+	float value0 = cellValues[cellIndex(corner)][surface];
+	float value1 = cellValues[cellIndex(next)][surface];
+	float t = (SURFACE_THRESHOLDS[surface] - value0) / (value1 - value0);
+
+	vec3 position = mix(vec3(blockOrigin + corner), vec3(blockOrigin + next), t) * voxelSize - 1.0;
+
+	// the field grows towards the inside, so the surface faces down the gradient; where the differences cancel out, the
+	// edge itself tells which way is out
+	vec3 gradient = mix(fieldGradient(corner, surface), fieldGradient(next, surface), t);
+	vec3 normal = (dot(gradient, gradient) > 0.0) ? -normalize(gradient) : vec3(AXES[axis]) * sign(value0 - value1);
+
+	vec4 color = surfaceColor(surface, max(value0, value1));
+
+	uint first = vertex * uint(VERTEX_FLOATS);
+	meshVertices[first + 0u] = position.x;
+	meshVertices[first + 1u] = position.y;
+	meshVertices[first + 2u] = position.z;
+	meshVertices[first + 3u] = normal.x;
+	meshVertices[first + 4u] = normal.y;
+	meshVertices[first + 5u] = normal.z;
+	meshVertices[first + 6u] = color.r;
+	meshVertices[first + 7u] = color.g;
+	meshVertices[first + 8u] = color.b;
+	meshVertices[first + 9u] = color.a;
+}
+
+// the vertex of an edge of the cube, from the first vertex of the block
+uint edgeVertex(ivec3 cube, int surface, int edge) {
+	ivec4 owner = EDGE_OWNERS[edge];
+	uint edges = cornerEdges[cornerIndex(cube + owner.xyz)];
+	uint bit = uint(surface * 3 + owner.w);
+	return (edges >> 12u) + uint(bitCount(edges & ((1u << bit) - 1u)));
+}
+
+// inclusive prefix sum over the workgroup (Hillis-Steele); returns the half of scan that holds it
+uint prefixSum(uint localIndex, uint value) {
+	scan[localIndex] = value;
+	barrier();
+
+	uint source = 0u;
+	for (uint stride = 1u; stride < uint(CUBES_PER_WORKGROUP); stride *= 2u) {
+		uint destination = uint(CUBES_PER_WORKGROUP) - source;
+		uint sum = scan[source + localIndex];
+		if (localIndex >= stride) {
+			sum += scan[source + localIndex - stride];
+		}
+		scan[destination + localIndex] = sum;
+		barrier();
+		source = destination;
+	}
+	return source;
+}
+
+void main()
+{
+	uint blockListIndex = firstBlock + gl_WorkGroupID.x;
+	ivec3 sizeInBricks = (worldSize + WORLD_BRICK_SIZE - 1) / WORLD_BRICK_SIZE;
+	uint blockIndex = blocks[blockListIndex];
+	ivec3 blockOrigin = WORLD_BRICK_SIZE * ivec3(
+		int(blockIndex) % sizeInBricks.x,
+		(int(blockIndex) / sizeInBricks.x) % sizeInBricks.y,
+		int(blockIndex) / (sizeInBricks.x * sizeInBricks.y));
+	uint localIndex = gl_LocalInvocationIndex;
+
+	// the cells, clamped to the world like the corners of the geometry shader
+	for (int cell = int(localIndex); cell < NUM_CELLS; cell += CUBES_PER_WORKGROUP) {
+		ivec3 voxel = clamp(blockOrigin - 1 + cornerOfIndex(cell, CELLS_PER_AXIS), ivec3(0), worldSize - 1);
+		cellValues[cell] = lookupWorldCell(voxel);
+	}
+	barrier();
+
+	// each invocation takes a corner and, while there are more corners than invocations, a second one
+	ivec3 cornersInWorld = min(ivec3(CORNERS_PER_AXIS), worldSize + 1 - blockOrigin);
+	ivec3 corner0 = cornerOfIndex(int(localIndex), CORNERS_PER_AXIS);
+	ivec3 corner1 = cornerOfIndex(int(localIndex) + CUBES_PER_WORKGROUP, CORNERS_PER_AXIS);
+	uint edges0 = crossedEdges(corner0, cornersInWorld);
+	uint edges1 = (int(localIndex) + CUBES_PER_WORKGROUP < NUM_CORNERS) ? crossedEdges(corner1, cornersInWorld) : 0u;
+	uint vertices0 = uint(bitCount(edges0));
+	uint vertices = vertices0 + uint(bitCount(edges1));
+
+	ivec3 cube = ivec3(gl_LocalInvocationID);
+	bool inWorld = all(lessThan(blockOrigin + cube, worldSize));
+	ivec4 cases = inWorld ? cubeCases(cube) : ivec4(0);
+	uint triangles = 0u;
+	for (int surface = 0; surface < NUM_SURFACES; surface++) {
+		triangles += uint(caseTriangles(cases[surface]));
+	}
+
+	// both counts in one sum, vertices in the high half; a block has fewer than 2^16 of either
+	uint sum = prefixSum(localIndex, (vertices << 16u) | triangles);
+	uint before = scan[sum + localIndex] - ((vertices << 16u) | triangles);
+	uint total = scan[sum + uint(CUBES_PER_WORKGROUP) - 1u];
+	uint blockVertices = total >> 16u;
+	uint blockIndices = 3u * (total & 0xFFFFu);
+
+	if (localIndex == 0u) {
+		blockVertexBase = (blockVertices > 0u) ? vertexBase + atomicAdd(requestedVertices, blockVertices) : 0u;
+		blockIndexBase = (blockIndices > 0u) ? indexBase + atomicAdd(requestedIndices, blockIndices) : 0u;
+		blockFits = blockVertexBase + blockVertices <= vertexCapacity && blockIndexBase + blockIndices <= indexCapacity;
+
+		// a block that didn't fit is drawn empty until the whole surface is extracted again
+		uint command = DRAW_COMMAND_WORDS * blockIndex;
+		meshDraws[command + 0u] = blockFits ? blockIndices : 0u;
+		meshDraws[command + 1u] = 1u;
+		meshDraws[command + 2u] = blockIndexBase;
+		meshDraws[command + 3u] = blockVertexBase;
+		meshDraws[command + 4u] = 0u;
+	}
+
+	uint firstVertex = before >> 16u;
+	cornerEdges[cornerIndex(corner0)] = (firstVertex << 12u) | edges0;
+	if (int(localIndex) + CUBES_PER_WORKGROUP < NUM_CORNERS) {
+		cornerEdges[cornerIndex(corner1)] = ((firstVertex + vertices0) << 12u) | edges1;
+	}
+	barrier();
+
+	if (!blockFits) {
+		return;
+	}
+
+	// the vertices of the corners' edges, in the order of their bits, one at a time
+	uint vertex = blockVertexBase + firstVertex;
+	uint edges = edges0;
+	ivec3 corner = corner0;
+	while (edges != 0u || edges1 != 0u) {
+		if (edges == 0u) {
+			edges = edges1;
+			corner = corner1;
+			edges1 = 0u;
+		}
+
+		int bit = findLSB(edges);
+		edges &= edges - 1u;
+		writeEdgeVertex(vertex++, blockOrigin, corner, bit / 3, bit % 3);
+	}
+
+	// the triangles of the cube, surface after surface in the order of the triangle table, as the geometry shader emits them
+	uint index = blockIndexBase + 3u * (before & 0xFFFFu);
+	for (int surface = 0; surface < NUM_SURFACES; surface++) {
+		int edgeTableIndex = cases[surface];
+		for (int triangleTableIndex = 0; triangleTableValue(edgeTableIndex, triangleTableIndex) != -1; triangleTableIndex++) {
+			meshIndices[index++] = edgeVertex(cube, surface, triangleTableValue(edgeTableIndex, triangleTableIndex));
+		}
+	}
+}
@@ -10,7 +10,8 @@ void main()
 {
 	vec3 lightVector = normalize(gl_LightSource[0].position.xyz - v);
 
-	vec4 Idiff = diffuse * max(dot(normal, lightVector), 0.0);
+	// interpolated between the smooth normals of the mesh's vertices, so no longer of unit length
+	vec4 Idiff = diffuse * max(dot(normalize(normal), lightVector), 0.0);
 	Idiff = clamp(Idiff, 0.0, 1.0);
 	gl_FragColor = Idiff;
 }
\ No newline at end of file
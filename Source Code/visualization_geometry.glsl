@@ -1,4 +1,3 @@
-// using compatibility mode here because gl_ModelViewProjectionMatrix is deprecated
 #version 150 compatibility
 
 #extension GL_EXT_geometry_shader4 : enable 
@@ -7,45 +6,107 @@
 // Based on: "OpenGL Geometry Shader Marching Cubes": http://www.icare3d.org/codes-and-projects/codes/opengl_geometry_shader_marching_cubes.html
 // and "Polygonising a scalar field": http://paulbourke.net/geometry/polygonise/
 
+// Extracts the surface mesh where OpenGL 4.3 isn't available for visualization_extract_compute.glsl. The triangles
+// aren't rasterized here: they are captured with transform feedback into the surface mesh, in the same space as the
+// vertex positions, and drawn from there by visualization_mesh_vertex.glsl (see SurfaceMesh.h)
+
 layout(points) in;
-layout(triangle_strip, max_vertices = 16) out;
+layout(triangle_strip, max_vertices = 60) out;	// up to 5 triangles for each of the 4 surfaces, so nothing is ever dropped
 
 uniform vec3 voxelSize;
-uniform sampler3D worldTexture;
+uniform usampler3D worldTrailTexture;	// the three layers of the packed cells, see WorldCell.h
+uniform usampler3D worldFoodTexture;
+uniform usampler3D worldTerrainTexture;
 uniform isampler2D triangleTableTexture;
 
 uniform vec3 inverseWorldTextureSize;
 
+const int WORLD_BRICK_SIZE = 8;	// same brick layout as BrickedWorld.h
+
+uniform isampler3D worldPageTexture;	// atlas slot of every brick of the world, -1 if the brick isn't resident; offset by the halo
+uniform ivec3 worldAtlasSizeInBricks;	// how the slots are laid out in the world textures
+
 uniform vec3 cubeVertexDecals[8];
 
 uniform float trailOpacity;
 
-// will be used in fragment shader
-out vec4 position;
-out vec3 normal;
-out vec3 v;
-out vec4 diffuse;
+uniform uint worldTick;	// the tick that the world textures currently hold
+uniform float trailDissipationPerFrame;
+
+// the captured vertex, see SurfaceMesh.h
+out vec3 meshPosition;
+out vec3 meshNormal;
+out vec4 meshColor;
 
 const int NUM_CUBE_VERTICES = 8;
 
 const float TRAIL_THRESHOLD = 0.0;	// if it's above this amount, it should display
 const float NEST_THRESHOLD = 0.0;
 const float FOOD_THRESHOLD = 0.0;
-const float ANT_THRESHOLD = 0.0;
+const float ANT_THRESHOLD = 0.5;	// one ant reaches halfway to the next voxel, a crowd of them almost all the way
+
+const float ANTS_FOR_LARGEST_GLYPH = 8.0;	// crowds bigger than this look the same
+
+// the two corners each edge of the cube runs between, numbered like the edges in the triangle table
+const ivec2 EDGE_CORNERS[12] = ivec2[12](
+	ivec2(0, 1), ivec2(1, 2), ivec2(2, 3), ivec2(3, 0),
+	ivec2(4, 5), ivec2(5, 6), ivec2(6, 7), ivec2(7, 4),
+	ivec2(0, 4), ivec2(1, 5), ivec2(2, 6), ivec2(3, 7));
 
 vec3 cubeVertexPosition(int vertexIndex) {
 	return gl_in[0].gl_Position.xyz + cubeVertexDecals[vertexIndex];
 }
 
+ivec3 worldAtlasVoxel(int slot, ivec3 worldVolumeCoord) {
+	ivec3 atlasBrick = ivec3(
+		slot % worldAtlasSizeInBricks.x,
+		(slot / worldAtlasSizeInBricks.x) % worldAtlasSizeInBricks.y,
+		slot / (worldAtlasSizeInBricks.x * worldAtlasSizeInBricks.y));
+	return atlasBrick * WORLD_BRICK_SIZE + (worldVolumeCoord & (WORLD_BRICK_SIZE - 1));
+}
+
+// all three layers of a cell, in the order of WorldCell.h: red = trail or ants, green = tick stamp, blue = food, alpha = terrain
+uvec4 fetchWorldCell(ivec3 atlasVoxel) {
+	return uvec4(texelFetch(worldTrailTexture, atlasVoxel, 0).rg, texelFetch(worldFoodTexture, atlasVoxel, 0).r, texelFetch(worldTerrainTexture, atlasVoxel, 0).r);
+}
+
+// same packing as encodeTrailLayer in simulation_world_fragment.glsl and encodeFoodLayer in simulation_food_fragment.glsl;
+// decoded into red = nest, green = food, blue = trail strength at worldTick, alpha = ants in the cell at worldTick
+vec4 decodeWorldCell(uvec4 worldCell) {
+	float nest = ((worldCell.a & 1u) != 0u) ? 1.0 : 0.0;
+	float food = float((int(worldCell.b) << 16) >> 16) / 256.0;
+
+	// bit 15 set: ants stood in the cell at its stamp, and left the trail at full strength
+	bool antsStamped = (worldCell.r & 0x8000u) != 0u;
+	uint age = (worldTick - worldCell.g) & 0xFFFFu;
+	float storedTrail = antsStamped ? 1.0 : float(worldCell.r) / 32767.0;
+	float trail = max(storedTrail - trailDissipationPerFrame * float(age), 0.0);
+
+	float ants = (antsStamped && age == 0u) ? float(worldCell.r & 127u) : 0.0;
+
+	return vec4(nest, food, trail, ants);
+}
+
 vec4 lookupWorldCellColorAtCubeVertexPosition(vec3 cubeVertexPosition) {
 	// the vertex index tells which offset to use (each offset is in the range (0,0,0) to (voxelSize.x, voxelSize.y, vozelSize.z))
 	// meaning it either adds or doesn't add that voxel size value to the original position
 	vec3 cubeVertexPositionInWorldTexture = (cubeVertexPosition + 1.0)/2.0 + (0.5 * inverseWorldTextureSize);
-	vec4 worldCellColorAtCubeVertexPosition = texture3D(worldTexture, cubeVertexPositionInWorldTexture);
+
+	// the texture coordinate is at a texel center, so this is the voxel it would have sampled (clamped to the edge)
+	ivec3 worldSize = ivec3(round(1.0 / inverseWorldTextureSize));
+	ivec3 voxel = clamp(ivec3(floor(cubeVertexPositionInWorldTexture * vec3(worldSize))), ivec3(0), worldSize - 1);
+
+	int slot = texelFetch(worldPageTexture, (voxel + WORLD_BRICK_SIZE) / WORLD_BRICK_SIZE, 0).r;
+	if (slot < 0) {
+		return vec4(0.0, 0.0, 0.0, 0.0);	// empty space
+	}
+
+	vec4 worldCellColorAtCubeVertexPosition = decodeWorldCell(fetchWorldCell(worldAtlasVoxel(slot, voxel)));
 	return worldCellColorAtCubeVertexPosition;
 }
 
 // return value from 0.0 to 1.0
+// the trail decays lazily from the cell's tick stamp, decodeWorldCell already applied it
 float trailValueInWorldCell(vec4 worldCellColor) {
 	return worldCellColor.b;
 }
@@ -58,42 +119,37 @@ float foodValueInWorldCell(vec4 worldCellColor) {
 	return worldCellColor.g;
 }
 
+// number of ants in the cell (decodeWorldCell only counts them if the cell was marked in the latest tick), so the
+// surface around denser voxels lies further out
 float antValueInWorldCell(vec4 worldCellColor) {
-	return worldCellColor.a;
+	return min(worldCellColor.a, ANTS_FOR_LARGEST_GLYPH);
 }
 
 bool worldCellContainsObject(vec4 worldCellColor) {
-	if (worldCellColor.r > 0.0 || worldCellColor.g > 0.0 || worldCellColor.b > 0.0) {
+	if (worldCellColor.r > 0.0 || worldCellColor.g > 0.0 || trailValueInWorldCell(worldCellColor) > 0.0) {
 		return true;	// nest, food, or trail
 	}
-	if (worldCellColor.a > 0.0) {
+	if (antValueInWorldCell(worldCellColor) > 0.0) {
 		return true;	// ant is present here
 	}
 	return false;
 }
 
-void emitTriangle(const vec4 v1, const vec4 v2, const vec4 v3, vec4 color) {
-	diffuse = color;
+void emitTriangle(vec3 v1, vec3 v2, vec3 v3, vec4 color) {
+	meshColor = color;
 
-	// calculating normals
-	vec3 A = v3.xyz - v1.xyz;
-	vec3 B = v2.xyz - v1.xyz;
-	mat4 normalMatrix = transpose(inverse(gl_ModelViewMatrix));
-	normal = mat3(normalMatrix) * normalize(cross(A,B));
+	// calculating normals; the mesh vertex shader takes them to eye space
+	vec3 A = v3 - v1;
+	vec3 B = v2 - v1;
+	meshNormal = normalize(cross(A,B));
 
-	position = v1;
-	v = vec3(gl_ModelViewMatrix * position);
-	gl_Position = gl_ModelViewProjectionMatrix * position;
+	meshPosition = v1;
 	EmitVertex();
 			
-	position = v2;
-	v = vec3(gl_ModelViewMatrix * position);
-	gl_Position = gl_ModelViewProjectionMatrix * position;
+	meshPosition = v2;
 	EmitVertex();
 
-	position = v3;
-	v = vec3(gl_ModelViewMatrix * position);
-	gl_Position = gl_ModelViewProjectionMatrix * position;
+	meshPosition = v3;
 	EmitVertex();
 
 	EndPrimitive();
@@ -108,172 +164,28 @@ int triangleTableValue(int edgeNumber, int triangleVertexNumber) {
 	return texelFetch(triangleTableTexture, ivec2(triangleVertexNumber, edgeNumber), 0).a;
 }
 
-void doMarchingCubesTrail(float thresholdValue, vec3 cubeVertexPositions[NUM_CUBE_VERTICES], float surfaceValues[NUM_CUBE_VERTICES], int edgeTableIndex, vec4 displayColor) {
-	if (edgeTableIndex != 0 && edgeTableIndex != 255) {	// only continue if we're not completely in/out of the surface
-		
-		vec3 vertexList[12];
-
-		vertexList[0] =		vertexInterp(thresholdValue, cubeVertexPositions[0], surfaceValues[0], cubeVertexPositions[1], surfaceValues[1]);
-		vertexList[1] =		vertexInterp(thresholdValue, cubeVertexPositions[1], surfaceValues[1], cubeVertexPositions[2], surfaceValues[2]);
-		vertexList[2] =		vertexInterp(thresholdValue, cubeVertexPositions[2], surfaceValues[2], cubeVertexPositions[3], surfaceValues[3]);
-		vertexList[3] =		vertexInterp(thresholdValue, cubeVertexPositions[3], surfaceValues[3], cubeVertexPositions[0], surfaceValues[0]);
-		vertexList[4] =		vertexInterp(thresholdValue, cubeVertexPositions[4], surfaceValues[4], cubeVertexPositions[5], surfaceValues[5]);
-		vertexList[5] =		vertexInterp(thresholdValue, cubeVertexPositions[5], surfaceValues[5], cubeVertexPositions[6], surfaceValues[6]);
-		vertexList[6] =		vertexInterp(thresholdValue, cubeVertexPositions[6], surfaceValues[6], cubeVertexPositions[7], surfaceValues[7]);
-		vertexList[7] =		vertexInterp(thresholdValue, cubeVertexPositions[7], surfaceValues[7], cubeVertexPositions[4], surfaceValues[4]);
-		vertexList[8] =		vertexInterp(thresholdValue, cubeVertexPositions[0], surfaceValues[0], cubeVertexPositions[4], surfaceValues[4]);
-		vertexList[9] =		vertexInterp(thresholdValue, cubeVertexPositions[1], surfaceValues[1], cubeVertexPositions[5], surfaceValues[5]);
-		vertexList[10] =	vertexInterp(thresholdValue, cubeVertexPositions[2], surfaceValues[2], cubeVertexPositions[6], surfaceValues[6]);
-		vertexList[11] =	vertexInterp(thresholdValue, cubeVertexPositions[3], surfaceValues[3], cubeVertexPositions[7], surfaceValues[7]);
-	
-		// now actually do lookups on the triangles and create some geometry
-		int triangleTableIndex = 0;
-		while(true) {
-			int triangleTableValue_First = triangleTableValue(edgeTableIndex, triangleTableIndex+0);
-
-			if (triangleTableValue_First != -1) {	// once we hit -1's, we're done, don't make more triangles
-
-				emitTriangle(	vec4(vertexList[triangleTableValue_First], 1), 
-								vec4(vertexList[triangleTableValue(edgeTableIndex, triangleTableIndex+1)], 1), 
-								vec4(vertexList[triangleTableValue(edgeTableIndex, triangleTableIndex+2)], 1),
-								displayColor);
-
-			} else {
-				break;
-			}
-
-			triangleTableIndex += 3;	// advance to next triangle in table
-		}
-	}
+// where the surface crosses the edge; only the edges the triangles use are interpolated
+vec3 edgeVertex(int edge, float thresholdValue, vec3 cubeVertexPositions[NUM_CUBE_VERTICES], float surfaceValues[NUM_CUBE_VERTICES]) {
+	ivec2 corners = EDGE_CORNERS[edge];
+	return vertexInterp(thresholdValue, cubeVertexPositions[corners.x], surfaceValues[corners.x], cubeVertexPositions[corners.y], surfaceValues[corners.y]);
 }
 
-
-void doMarchingCubesFood(float thresholdValue, vec3 cubeVertexPositions[NUM_CUBE_VERTICES], float surfaceValues[NUM_CUBE_VERTICES], int edgeTableIndex, vec4 displayColor) {
-	if (edgeTableIndex != 0 && edgeTableIndex != 255) {	// only continue if we're not completely in/out of the surface
-		
-		vec3 vertexList[12];
-	
-		// this is to darken the food as it's eaten
-		float highestFoodValue = max(surfaceValues[0], surfaceValues[1]);
-		highestFoodValue = max(highestFoodValue, surfaceValues[2]);
-		highestFoodValue = max(highestFoodValue, surfaceValues[3]);
-		highestFoodValue = max(highestFoodValue, surfaceValues[4]);
-		highestFoodValue = max(highestFoodValue, surfaceValues[5]);
-		highestFoodValue = max(highestFoodValue, surfaceValues[6]);
-		highestFoodValue = max(highestFoodValue, surfaceValues[7]);
-
-		displayColor = mix(vec4(0.0, 0.0, 0.0, 1.0), displayColor, highestFoodValue);
-
-		vertexList[0] =		vertexInterp(thresholdValue, cubeVertexPositions[0], surfaceValues[0], cubeVertexPositions[1], surfaceValues[1]);
-		vertexList[1] =		vertexInterp(thresholdValue, cubeVertexPositions[1], surfaceValues[1], cubeVertexPositions[2], surfaceValues[2]);
-		vertexList[2] =		vertexInterp(thresholdValue, cubeVertexPositions[2], surfaceValues[2], cubeVertexPositions[3], surfaceValues[3]);
-		vertexList[3] =		vertexInterp(thresholdValue, cubeVertexPositions[3], surfaceValues[3], cubeVertexPositions[0], surfaceValues[0]);
-		vertexList[4] =		vertexInterp(thresholdValue, cubeVertexPositions[4], surfaceValues[4], cubeVertexPositions[5], surfaceValues[5]);
-		vertexList[5] =		vertexInterp(thresholdValue, cubeVertexPositions[5], surfaceValues[5], cubeVertexPositions[6], surfaceValues[6]);
-		vertexList[6] =		vertexInterp(thresholdValue, cubeVertexPositions[6], surfaceValues[6], cubeVertexPositions[7], surfaceValues[7]);
-		vertexList[7] =		vertexInterp(thresholdValue, cubeVertexPositions[7], surfaceValues[7], cubeVertexPositions[4], surfaceValues[4]);
-		vertexList[8] =		vertexInterp(thresholdValue, cubeVertexPositions[0], surfaceValues[0], cubeVertexPositions[4], surfaceValues[4]);
-		vertexList[9] =		vertexInterp(thresholdValue, cubeVertexPositions[1], surfaceValues[1], cubeVertexPositions[5], surfaceValues[5]);
-		vertexList[10] =	vertexInterp(thresholdValue, cubeVertexPositions[2], surfaceValues[2], cubeVertexPositions[6], surfaceValues[6]);
-		vertexList[11] =	vertexInterp(thresholdValue, cubeVertexPositions[3], surfaceValues[3], cubeVertexPositions[7], surfaceValues[7]);
-
-		// now actually do lookups on the triangles and create some geometry
-		int triangleTableIndex = 0;
-		while(true) {
-			int triangleTableValue_First = triangleTableValue(edgeTableIndex, triangleTableIndex+0);
-
-			if (triangleTableValue_First != -1) {	// once we hit -1's, we're done, don't make more triangles
-
-				emitTriangle(	vec4(vertexList[triangleTableValue_First], 1), 
-								vec4(vertexList[triangleTableValue(edgeTableIndex, triangleTableIndex+1)], 1), 
-								vec4(vertexList[triangleTableValue(edgeTableIndex, triangleTableIndex+2)], 1),
-								displayColor);
-
-			} else {
-				break;
-			}
-
-			triangleTableIndex += 3;	// advance to next triangle in table
-		}
-	}
+bool cubeOnSurface(int edgeTableIndex) {
+	return edgeTableIndex != 0 && edgeTableIndex != 255;	// not completely in or out of the surface
 }
 
-
-void doMarchingCubesNest(float thresholdValue, vec3 cubeVertexPositions[NUM_CUBE_VERTICES], float surfaceValues[NUM_CUBE_VERTICES], int edgeTableIndex, vec4 displayColor) {
-	if (edgeTableIndex != 0 && edgeTableIndex != 255) {	// only continue if we're not completely in/out of the surface
-		
-		vec3 vertexList[12];
-	
-		vertexList[0] =		vertexInterp(thresholdValue, cubeVertexPositions[0], surfaceValues[0], cubeVertexPositions[1], surfaceValues[1]);
-		vertexList[1] =		vertexInterp(thresholdValue, cubeVertexPositions[1], surfaceValues[1], cubeVertexPositions[2], surfaceValues[2]);
-		vertexList[2] =		vertexInterp(thresholdValue, cubeVertexPositions[2], surfaceValues[2], cubeVertexPositions[3], surfaceValues[3]);
-		vertexList[3] =		vertexInterp(thresholdValue, cubeVertexPositions[3], surfaceValues[3], cubeVertexPositions[0], surfaceValues[0]);
-		vertexList[4] =		vertexInterp(thresholdValue, cubeVertexPositions[4], surfaceValues[4], cubeVertexPositions[5], surfaceValues[5]);
-		vertexList[5] =		vertexInterp(thresholdValue, cubeVertexPositions[5], surfaceValues[5], cubeVertexPositions[6], surfaceValues[6]);
-		vertexList[6] =		vertexInterp(thresholdValue, cubeVertexPositions[6], surfaceValues[6], cubeVertexPositions[7], surfaceValues[7]);
-		vertexList[7] =		vertexInterp(thresholdValue, cubeVertexPositions[7], surfaceValues[7], cubeVertexPositions[4], surfaceValues[4]);
-		vertexList[8] =		vertexInterp(thresholdValue, cubeVertexPositions[0], surfaceValues[0], cubeVertexPositions[4], surfaceValues[4]);
-		vertexList[9] =		vertexInterp(thresholdValue, cubeVertexPositions[1], surfaceValues[1], cubeVertexPositions[5], surfaceValues[5]);
-		vertexList[10] =	vertexInterp(thresholdValue, cubeVertexPositions[2], surfaceValues[2], cubeVertexPositions[6], surfaceValues[6]);
-		vertexList[11] =	vertexInterp(thresholdValue, cubeVertexPositions[3], surfaceValues[3], cubeVertexPositions[7], surfaceValues[7]);
-
-		// now actually do lookups on the triangles and create some geometry
-		int triangleTableIndex = 0;
-		while(true) {
-			int triangleTableValue_First = triangleTableValue(edgeTableIndex, triangleTableIndex+0);
-
-			if (triangleTableValue_First != -1) {	// once we hit -1's, we're done, don't make more triangles
-
-				emitTriangle(	vec4(vertexList[triangleTableValue_First], 1), 
-								vec4(vertexList[triangleTableValue(edgeTableIndex, triangleTableIndex+1)], 1), 
-								vec4(vertexList[triangleTableValue(edgeTableIndex, triangleTableIndex+2)], 1),
-								displayColor);
-
-			} else {
-				break;
-			}
-
-			triangleTableIndex += 3;	// advance to next triangle in table
-		}
+// one surface of the cube, any of the four
+void doMarchingCubes(float thresholdValue, vec3 cubeVertexPositions[NUM_CUBE_VERTICES], float surfaceValues[NUM_CUBE_VERTICES], int edgeTableIndex, vec4 displayColor) {
+	if (!cubeOnSurface(edgeTableIndex)) {
+		return;
 	}
-}
 
-void doMarchingCubesAnt(float thresholdValue, vec3 cubeVertexPositions[NUM_CUBE_VERTICES], float surfaceValues[NUM_CUBE_VERTICES], int edgeTableIndex, vec4 displayColor) {
-	if (edgeTableIndex != 0 && edgeTableIndex != 255) {	// only continue if we're not completely in/out of the surface
-		
-		vec3 vertexList[12];
-	
-		vertexList[0] =		vertexInterp(thresholdValue, cubeVertexPositions[0], surfaceValues[0], cubeVertexPositions[1], surfaceValues[1]);
-		vertexList[1] =		vertexInterp(thresholdValue, cubeVertexPositions[1], surfaceValues[1], cubeVertexPositions[2], surfaceValues[2]);
-		vertexList[2] =		vertexInterp(thresholdValue, cubeVertexPositions[2], surfaceValues[2], cubeVertexPositions[3], surfaceValues[3]);
-		vertexList[3] =		vertexInterp(thresholdValue, cubeVertexPositions[3], surfaceValues[3], cubeVertexPositions[0], surfaceValues[0]);
-		vertexList[4] =		vertexInterp(thresholdValue, cubeVertexPositions[4], surfaceValues[4], cubeVertexPositions[5], surfaceValues[5]);
-		vertexList[5] =		vertexInterp(thresholdValue, cubeVertexPositions[5], surfaceValues[5], cubeVertexPositions[6], surfaceValues[6]);
-		vertexList[6] =		vertexInterp(thresholdValue, cubeVertexPositions[6], surfaceValues[6], cubeVertexPositions[7], surfaceValues[7]);
-		vertexList[7] =		vertexInterp(thresholdValue, cubeVertexPositions[7], surfaceValues[7], cubeVertexPositions[4], surfaceValues[4]);
-		vertexList[8] =		vertexInterp(thresholdValue, cubeVertexPositions[0], surfaceValues[0], cubeVertexPositions[4], surfaceValues[4]);
-		vertexList[9] =		vertexInterp(thresholdValue, cubeVertexPositions[1], surfaceValues[1], cubeVertexPositions[5], surfaceValues[5]);
-		vertexList[10] =	vertexInterp(thresholdValue, cubeVertexPositions[2], surfaceValues[2], cubeVertexPositions[6], surfaceValues[6]);
-		vertexList[11] =	vertexInterp(thresholdValue, cubeVertexPositions[3], surfaceValues[3], cubeVertexPositions[7], surfaceValues[7]);
-
-		// now actually do lookups on the triangles and create some geometry
-		int triangleTableIndex = 0;
-		while(true) {
-			int triangleTableValue_First = triangleTableValue(edgeTableIndex, triangleTableIndex+0);
-
-			if (triangleTableValue_First != -1) {	// once we hit -1's, we're done, don't make more triangles
-
-				emitTriangle(	vec4(vertexList[triangleTableValue_First], 1), 
-								vec4(vertexList[triangleTableValue(edgeTableIndex, triangleTableIndex+1)], 1), 
-								vec4(vertexList[triangleTableValue(edgeTableIndex, triangleTableIndex+2)], 1),
-								displayColor);
-
-			} else {
-				break;
-			}
-
-			triangleTableIndex += 3;	// advance to next triangle in table
-		}
+	// the table row lists the edges of the triangles three at a time, and always ends with a -1
+	for (int triangleTableIndex = 0; triangleTableValue(edgeTableIndex, triangleTableIndex) != -1; triangleTableIndex += 3) {
+		emitTriangle(	edgeVertex(triangleTableValue(edgeTableIndex, triangleTableIndex+0), thresholdValue, cubeVertexPositions, surfaceValues),
+						edgeVertex(triangleTableValue(edgeTableIndex, triangleTableIndex+1), thresholdValue, cubeVertexPositions, surfaceValues),
+						edgeVertex(triangleTableValue(edgeTableIndex, triangleTableIndex+2), thresholdValue, cubeVertexPositions, surfaceValues),
+						displayColor);
 	}
 }
 
@@ -288,10 +200,13 @@ void main()
 
 	vec3 cubeVertexPositions[NUM_CUBE_VERTICES];
 
+	// the corners are looked up once for all four surfaces
 	float trailValues[NUM_CUBE_VERTICES];
 	float nestValues[NUM_CUBE_VERTICES];
 	float foodValues[NUM_CUBE_VERTICES];
 	float antValues[NUM_CUBE_VERTICES];
+	float highestFoodValue = 0.0;
+	float highestAntValue = 0.0;
 	int cubeVertexIndex;
 	for (cubeVertexIndex = 0; cubeVertexIndex < NUM_CUBE_VERTICES; cubeVertexIndex++) {
 		cubeVertexPositions[cubeVertexIndex] = cubeVertexPosition(cubeVertexIndex);
@@ -301,6 +216,9 @@ void main()
 		foodValues[cubeVertexIndex] = foodValueInWorldCell(worldCellColor);
 		antValues[cubeVertexIndex] = antValueInWorldCell(worldCellColor);
 
+		highestFoodValue = max(highestFoodValue, foodValues[cubeVertexIndex]);
+		highestAntValue = max(highestAntValue, antValues[cubeVertexIndex]);
+
 		if (trailValues[cubeVertexIndex] > TRAIL_THRESHOLD) {
 			trailEdgeTableIndex += (1 << cubeVertexIndex);
 		}
@@ -315,14 +233,18 @@ void main()
 		}
 	}
 
-	// not entirely sure why, but having these call the same function leads to bad results
+	// most cubes are nowhere near a surface
+	if (!cubeOnSurface(trailEdgeTableIndex) && !cubeOnSurface(foodEdgeTableIndex) && !cubeOnSurface(nestEdgeTableIndex) && !cubeOnSurface(antEdgeTableIndex)) {
+		return;
+	}
 
-	doMarchingCubesTrail(TRAIL_THRESHOLD, cubeVertexPositions, trailValues, trailEdgeTableIndex, vec4(0.0, 0.0, 1.0, trailOpacity));
+	doMarchingCubes(TRAIL_THRESHOLD, cubeVertexPositions, trailValues, trailEdgeTableIndex, vec4(0.0, 0.0, 1.0, trailOpacity));
 
-	doMarchingCubesFood(FOOD_THRESHOLD, cubeVertexPositions, foodValues, foodEdgeTableIndex, vec4(0.0, 1.0, 0.0, 1.0));
+	// the food darkens as it's eaten
+	doMarchingCubes(FOOD_THRESHOLD, cubeVertexPositions, foodValues, foodEdgeTableIndex, mix(vec4(0.0, 0.0, 0.0, 1.0), vec4(0.0, 1.0, 0.0, 1.0), highestFoodValue));
 
-	doMarchingCubesNest(NEST_THRESHOLD, cubeVertexPositions, nestValues, nestEdgeTableIndex, vec4(1.0, 0.0, 0.0, 1.0));
+	doMarchingCubes(NEST_THRESHOLD, cubeVertexPositions, nestValues, nestEdgeTableIndex, vec4(1.0, 0.0, 0.0, 1.0));
 
-	doMarchingCubesAnt(ANT_THRESHOLD, cubeVertexPositions, antValues, antEdgeTableIndex, vec4(1.0, 1.0, 1.0, 1.0));
-	
+	// crowds of ants turn orange
+	doMarchingCubes(ANT_THRESHOLD, cubeVertexPositions, antValues, antEdgeTableIndex, mix(vec4(1.0, 1.0, 1.0, 1.0), vec4(1.0, 0.5, 0.0, 1.0), (highestAntValue - 1.0) / (ANTS_FOR_LARGEST_GLYPH - 1.0)));
 }
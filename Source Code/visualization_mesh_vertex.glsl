@@ -0,0 +1,26 @@
+// using compatibility mode here because gl_ModelViewProjectionMatrix is deprecated
+#version 150 compatibility
+
+// one vertex of the surface mesh that visualization_extract_compute.glsl (or, without OpenGL 4.3,
+// visualization_geometry.glsl) extracted and SurfaceMesh keeps between frames; only the view transform happens here, so
+// turning the camera doesn't extract anything again
+
+in vec3 meshPosition;
+in vec3 meshNormal;
+in vec4 meshColor;
+
+// will be used in fragment shader
+out vec4 position;
+out vec3 normal;
+out vec3 v;
+out vec4 diffuse;
+
+void main()
+{
+	diffuse = meshColor;
+	normal = gl_NormalMatrix * meshNormal;
+
+	position = vec4(meshPosition, 1.0);
+	v = vec3(gl_ModelViewMatrix * position);
+	gl_Position = gl_ModelViewProjectionMatrix * position;
+}
@@ -1,10 +1,20 @@
 #version 150 compatibility
 
+// one vertex per voxel of the world, drawn without any vertex attributes: gl_VertexID is the voxel index, x fastest,
+// decoded to integer voxel coordinates so that the grid lines up with the voxels exactly at any world size; the
+// geometry shader runs marching cubes on the cube whose lowest corner this vertex is
+
+uniform vec3 voxelSize;
+uniform vec3 inverseWorldTextureSize;
+
 void main()
 {
-	gl_TexCoord[0]=gl_MultiTexCoord0;
+	ivec3 worldSize = ivec3(round(1.0 / inverseWorldTextureSize));	// same as visualization_geometry.glsl
 
-	gl_Position = gl_Vertex;
+	ivec3 voxel = ivec3(
+		gl_VertexID % worldSize.x,
+		(gl_VertexID / worldSize.x) % worldSize.y,
+		gl_VertexID / (worldSize.x * worldSize.y));
 
-	gl_FrontColor = gl_Color;
-}
\ No newline at end of file
+	gl_Position = vec4(vec3(voxel) * voxelSize - 1.0, 1.0);	// in [-1,1), like the mesh the geometry shader extracts
+}